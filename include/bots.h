@@ -0,0 +1,26 @@
+#ifndef BOTS_H
+#define BOTS_H
+
+#include "common.h"
+
+// Computer-controlled players. Bots exist only where the game is decided
+// (the host, or an offline game); clients see them as ordinary players.
+// Each tick a bot picks a target, steers along the shared flow fields and
+// drives its player through ApplyPlayerInput(), like the keyboard does.
+
+#define BOT_THINK_INTERVAL 0.25f    // Seconds between target searches
+#define BOT_STRAFE_RANGE 200.0f     // Closer than this a bot circles instead of closing in
+#define BOT_STRAFE_TIME 1.5f        // Seconds before switching strafe direction
+#define BOT_AIM_TOLERANCE 0.15f     // Radians off target still worth a shot
+
+Player* AddBot(void);
+bool RemoveBot(void);
+int GetBotCount(void);
+
+// Keep the game at this many players by adding or removing bots (0 = off)
+void SetBotFill(int playerCount);
+
+// Once per tick, before players move
+void UpdateBots(float dt);
+
+#endif // BOTS_H
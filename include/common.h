@@ -29,6 +29,13 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+#define CACHE_LINE_SIZE 64
+#ifdef _MSC_VER
+#define CACHE_ALIGNED __declspec(align(CACHE_LINE_SIZE))
+#else
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+#endif
+
 // Game constants
 #define SCREEN_WIDTH 1280
 #define SCREEN_HEIGHT 720
@@ -39,7 +46,7 @@
 #define PLAYER_ACCELERATION 1000.0f
 #define PLAYER_FRICTION 10.0f
 #define BULLET_SIZE 5.0f
-#define BULLET_SPEED 800.0f
+#define BULLET_SPEED 800.0f  // For weapons that set no bullet_speed
 #define BULLET_LIFETIME 2.0f
 #define GUN_LENGTH 20.0f
 #define SCREEN_SHAKE_DECAY 0.95f
@@ -50,10 +57,46 @@
 #define PARTICLE_LIFETIME 0.5f
 #define MUZZLE_FLASH_LIFETIME 0.1f
 #define HIT_EFFECT_LIFETIME 0.3f
+#define MAX_TRACERS 64
+#define MAX_WEAPONS 16  // Built-ins plus extra types from the weapons file
+#define TRACER_LIFETIME 0.15f
 #define FOV_ANGLE 60.0f
 #define FOV_RANGE 500.0f
+#define VISIBILITY_RAYS 128          // Points in a visibility polygon
 #define MAX_MESSAGE_SIZE 1024
 #define DEFAULT_PORT 7777
+#define SESSION_TIMEOUT 5.0f
+#define HEARTBEAT_INTERVAL 1.0f
+#define SEND_INTERVAL_MIN 0.033f     // 30 Hz snapshots on a healthy link
+#define SEND_INTERVAL_MAX 0.1f       // Never slower than 10 Hz
+#define LINK_MIN_BUDGET 8000.0f      // Bytes per second
+#define LINK_MAX_BUDGET 256000.0f
+#define LINK_START_BUDGET 128000.0f
+#define LINK_BUDGET_STEP 8000.0f     // Additive increase per clean ping
+#define LINK_LOSS_THRESHOLD 0.02f
+#define LINK_LOSS_WINDOW 64          // Packets per loss sample
+#define PRIORITY_DISTANCE_SCALE 300.0f
+#define HIDDEN_PLAYER_INTERVAL 0.5f   // Out-of-sight enemies are refreshed this often, not every snapshot
+#define TICK_RATE 60                 // Simulation ticks per second of host time
+#define SIM_DT (1.0f / TICK_RATE)
+#define MAX_SIM_STEPS 5              // Per frame; a longer hitch drops time instead of spiralling
+#define TICK_RESYNC_THRESHOLD 3      // Ticks of error before re-anchoring to host time
+#define MAX_CHAT_MESSAGES 10
+#define TILE_SIZE 40.0f
+#define DEFAULT_MAP_PATH "maps/arena.lmap"
+#define CULL_MARGIN 96.0f           // Covers entity size, a tick of motion and screen shake
+#define MODE_INSTRUCTION_TIME 5.0f
+#define CLOCK_SAMPLE_COUNT 16        // Ping exchanges kept for clock estimation
+#define CLOCK_MAX_DRIFT 0.0005       // 500 ppm, anything beyond is noise
+#define SNAPSHOT_FRAGMENT_SIZE 960   // Keeps each datagram under a typical MTU
+#define SNAPSHOT_MAX_FRAGMENTS 16
+#define SNAPSHOT_MAX_SIZE (SNAPSHOT_FRAGMENT_SIZE * SNAPSHOT_MAX_FRAGMENTS)
+#define MAX_NETWORK_EVENTS 16        // Per event message, still under a typical MTU
+#define EVENT_PLAYER_ID_SIZE 16      // Generated ids are 15 characters
+#define EVENT_LOG_SIZE 1024          // Host events kept until every client acks them
+#define EVENT_RESEND_INTERVAL 0.1f   // Floor on the wait before resending unacked events
+#define EVENT_RESEND_MESSAGES 4      // Per resend, so a long backlog doesn't burst
+#define MAX_SHOT_PELLETS 16          // Pellets one shoot message can carry
 
 // Game state enum
 typedef enum {
@@ -72,7 +115,7 @@ typedef enum {
     MODE_TOTAL
 } GameMode;
 
-// Weapon types
+// Built-in weapon types; the weapons file can add more slots after these
 typedef enum {
     WEAPON_PISTOL,
     WEAPON_RIFLE,
@@ -95,10 +138,12 @@ typedef enum {
 typedef struct Particle Particle;
 typedef struct MuzzleFlash MuzzleFlash;
 typedef struct HitEffect HitEffect;
+typedef struct Tracer Tracer;
 typedef struct WeaponStats WeaponStats;
 typedef struct Player Player;
 typedef struct Bullet Bullet;
 typedef struct Game Game;
+typedef struct RenderSnapshot RenderSnapshot;
 
 // Particle structure
 struct Particle {
@@ -119,7 +164,7 @@ struct Particle {
 // Muzzle flash structure
 struct MuzzleFlash {
     Vector2 position;
-    float rotation;
+    Vector2 direction;      // Unit vector the flash points along
     float size;
     float lifetime;
     float maxLifetime;
@@ -138,23 +183,38 @@ struct HitEffect {
     bool active;
 };
 
-// Weapon stats structure
-struct WeaponStats {
-    char name[32];
+// Streak left by a hitscan shot
+struct Tracer {
+    Vector2 start;
+    Vector2 end;
+    float lifetime;
+    Color color;
+    bool active;
+};
+
+// Weapon stats structure. Fields FireWeapon() reads come first so a shot
+// touches one cache line; the rest is only read for effects and the HUD.
+struct CACHE_ALIGNED WeaponStats {
     int damage;
-    float fireRate;  // Shots per second
-    float reloadTime;
+    float fireInterval;     // Derived from fireRate at load
+    float spread;
+    float range;            // Hitscan reach
+    int bulletsPerShot;
     int magazineSize;
+    float reloadTime;
+    bool hitscan;           // Resolved with one ray instead of a bullet
+    bool automatic;
+    bool enabled;
+    
+    char name[32];
+    WeaponType style;       // Built-in look for sprites, icons and bullets
+    float fireRate;         // Shots per second
     int maxAmmo;
-    float spread;
     float bulletSpeed;
-    int bulletsPerShot;
     float screenShakeIntensity;
     int particlesPerShot;
     Color muzzleFlashColor;
     float muzzleFlashSize;
-    bool automatic;
-    bool enabled;
 };
 
 // Player structure
@@ -164,11 +224,13 @@ struct Player {
     Vector2 position;
     Vector2 velocity;
     float rotation;
+    Vector2 direction;      // Unit vector along rotation, refreshed once per tick
     float targetRotation;
     float health;
     float maxHealth;
     Color color;
     bool isLocal;
+    bool isBot;             // Local, but driven by the bot controller
     bool active;
     
     // Team information
@@ -179,11 +241,17 @@ struct Player {
     
     // Weapons
     WeaponType currentWeapon;
-    int ammo[WEAPON_TOTAL];
-    int magazineAmmo[WEAPON_TOTAL];
+    int ammo[MAX_WEAPONS];
+    int magazineAmmo[MAX_WEAPONS];
     float fireTimer;
     float reloadTimer;
     bool isReloading;
+    
+    unsigned int lastUpdateTick;  // Host tick of the newest state we have
+    
+    // State at the start of the current tick, for render interpolation
+    Vector2 prevPosition;
+    float prevRotation;
 };
 
 // Bullet structure
@@ -191,11 +259,13 @@ struct Bullet {
     Vector2 position;
     Vector2 velocity;
     float rotation;
+    Vector2 direction;      // Unit vector along rotation
     float lifetime;
     int damage;
     char ownerId[32];
     bool active;
     Color color;
+    Vector2 prevPosition;  // Position at the start of the current tick
 };
 
 // Network message types
@@ -207,9 +277,13 @@ typedef enum {
     MSG_PING,
     MSG_PONG,
     MSG_GAME_MODE,
-    MSG_TEAM_SCORE,
+    MSG_GAME_EVENTS,
     MSG_FLAG_UPDATE,
-    MSG_CHAT
+    MSG_CHAT,
+    MSG_CONNECT_ACCEPT,
+    MSG_HEARTBEAT,
+    MSG_STATE_SNAPSHOT,
+    MSG_EVENT_ACK
 } MessageType;
 
 // Flag structure for Capture the Flag mode
@@ -221,16 +295,112 @@ typedef struct {
     char carrierId[32];  // ID of player carrying the flag
 } Flag;
 
+// Tile map. Both grids point into the loaded file image (memory-mapped
+// where the platform allows), so loading does no per-tile work.
+typedef struct {
+    int width;                      // In tiles
+    int height;
+    float tileSize;
+    const unsigned char* solid;     // 1 = wall
+    const unsigned char* distance;  // Chebyshev distance in tiles to the nearest wall
+    const void* data;               // Whole file image
+    size_t dataSize;
+    bool mapped;                    // data is an mmap rather than a heap block
+} Map;
+
+// Chat line shown in the overlay
+typedef struct {
+    char message[256];
+    char senderName[32];
+    float displayTime;
+} ChatMessage;
+
+// Link quality estimate and send budget for one peer
+typedef struct {
+    float rtt;                  // Smoothed round trip time (ms)
+    float minRtt;               // Lowest RTT seen, baseline for queueing delay
+    float lossRate;             // Smoothed loss of our packets, as reported by the peer
+    float measuredLoss;         // Loss we measure on the peer's packets
+    float sendBudget;           // Bytes per second we allow ourselves
+    float sendInterval;         // Seconds between snapshots
+    float sendTimer;
+    unsigned short sendSequence;
+    unsigned short recvSequence;
+    int recvCount;
+    int recvExpected;
+} LinkStats;
+
+// NTP-style estimate of the host clock relative to ours
+typedef struct {
+    double sampleTime[CLOCK_SAMPLE_COUNT];    // Local time the sample completed
+    double sampleOffset[CLOCK_SAMPLE_COUNT];  // Host clock minus local clock
+    double sampleDelay[CLOCK_SAMPLE_COUNT];   // Round trip minus host processing time
+    int sampleCount;
+    int nextSample;
+    double offset;      // Offset at baseTime
+    double drift;       // Offset change per local second
+    double baseTime;
+    bool synced;
+} ClockSync;
+
+// Host-side record of a connected client
+typedef struct {
+    struct sockaddr_in addr;
+    unsigned int connectionId;
+    char playerId[32];
+    double lastHeardTime;
+    bool active;
+    
+    // Adaptive snapshot state
+    LinkStats link;
+    unsigned int dirtyPlayers;          // Player slots with state this client hasn't seen
+    double lastSentTime[MAX_PLAYERS];   // Per player slot, for staleness priority
+    
+    // Reliable events: everything from eventAck on is resent until acked
+    unsigned int eventAck;              // First event sequence the client hasn't confirmed
+    float eventResendTimer;
+} ClientSession;
+
+// Gameplay event as the host sends it; players go by id since slots differ
+// between peers
+typedef struct {
+    unsigned char type;
+    unsigned char team;
+    short damage;
+    Vector2 position;
+    Vector2 direction;
+    char attackerId[EVENT_PLAYER_ID_SIZE];
+    char victimId[EVENT_PLAYER_ID_SIZE];
+} NetworkEvent;
+
 // Network message structure
 typedef struct {
     MessageType type;
     char playerId[32];
+    unsigned int connectionId;  // Assigned by the host on join, 0 until accepted
+    unsigned short sequence;    // Per-link send counter, used for loss estimation
+    unsigned int tick;          // Sender's tick on the shared host time base
     union {
         Player player;
-        Bullet bullet;
-        float ping;
+        struct {
+            Vector2 origin;             // Gun tip
+            unsigned char pelletCount;
+            float angles[MAX_SHOT_PELLETS]; // As the shooter aimed them, spread included
+        } shot;
+        struct {
+            double sentTime;    // Pinger's clock, echoed back in the pong
+            double receiveTime; // Responder's clock when the ping arrived
+            double replyTime;   // Responder's clock when the pong left
+            float lossRate;     // Loss the sender measured on packets from the receiver
+        } pingInfo;
+        unsigned int assignedConnectionId;
         GameMode gameMode;
-        int teamScores[2];
+        struct {
+            unsigned int firstSequence; // Sequence of list[0]; the rest follow on
+            unsigned char count;
+            NetworkEvent list[MAX_NETWORK_EVENTS];
+        } events;
+        unsigned int eventAck;          // Next event sequence the client expects
         struct {
             Flag flag;
             int flagIndex;
@@ -239,6 +409,13 @@ typedef struct {
             char chatMessage[256];
             char senderName[32];
         };
+        struct {
+            unsigned int snapshotId;
+            unsigned char fragmentIndex;
+            unsigned char fragmentCount;
+            unsigned short fragmentSize;
+            unsigned char bytes[SNAPSHOT_FRAGMENT_SIZE];
+        } snapshot;
     } data;
 } NetworkMessage;
 
@@ -258,13 +435,25 @@ struct Game {
     // Capture the Flag specific
     Flag flags[2];      // 0 = red flag, 1 = blue flag
     
+    // Arena
+    Map map;
+    
     // Network
     int socket_fd;
     bool isHost;
     bool isConnected;
     struct sockaddr_in serverAddr;
-    struct sockaddr_in clientAddrs[MAX_PLAYERS];
+    ClientSession sessions[MAX_PLAYERS];
     int clientCount;
+    unsigned int connectionId;      // Our id as a client, 0 while joining
+    double lastServerHeardTime;     // Client: last packet from the host
+    double lastSendTime;            // Last outgoing packet, drives heartbeats
+    LinkStats serverLink;           // Client: link to the host
+    ClockSync clock;                // Client: host clock estimate
+    bool hasInitialState;           // Client: full snapshot applied since joining
+    unsigned int eventSequence;     // Host: next event to send; client: next event to apply
+    unsigned int tick;              // Current tick, derived from host time
+    int listenerShards;  // Receive threads/sockets used when hosting
     char hostIP[16];
     int hostPort;
     char joinIP[16];
@@ -285,17 +474,15 @@ struct Game {
     char chatInput[256];
     
     // Chat system
-    struct {
-        char message[256];
-        char senderName[32];
-        float displayTime;
-    } chatMessages[10];
+    ChatMessage chatMessages[MAX_CHAT_MESSAGES];
     int chatMessageCount;
     
+    // Fixed timestep
+    float simAccumulator;   // Unsimulated time carried to the next frame
+    
     // Performance metrics
     float ping;
     double lastPingTime;
-    double pingStartTime;
     int packetsSent;
     int packetsReceived;
     
@@ -312,7 +499,7 @@ struct Game {
     // Game mode settings
     float modeTimer;           // Timer for game modes
     float modeMaxTime;         // Maximum time for current game mode
-    bool showModeInstructions; // Whether to show mode instructions
+    float modeInstructionTimer; // Seconds left to show the mode instructions
     
     // Visual effects
     Vector2 screenShake;
@@ -326,14 +513,87 @@ struct Game {
     Particle particles[MAX_PARTICLES];
     MuzzleFlash muzzleFlashes[MAX_MUZZLE_FLASHES];
     HitEffect hitEffects[MAX_HIT_EFFECTS];
+    Tracer tracers[MAX_TRACERS];
     int particleCount;
     int muzzleFlashCount;
     int hitEffectCount;
     bool visualEffectsEnabled;
+    bool fogOfWarEnabled;
+    float effectQuality;        // 0.25-1, set from the frame time governor
     float damageFlashTimer;
     Color damageFlashColor;
 };
 
+// Everything the renderer needs while in game, copied out of Game once per
+// tick. The render thread only ever reads these, never the live Game.
+struct RenderSnapshot {
+    GameState state;
+    GameMode mode;
+    char localPlayerId[32];
+    const Map* map;         // Only replaced from the main thread
+    double tickTime;        // When the newest tick was simulated
+    float renderAlpha;      // Set by the reader: fraction of a tick since tickTime
+    unsigned int tick;
+    
+    // Camera: cullBounds is what the publisher kept, the rest is set by the reader
+    Rectangle cullBounds;
+    Camera2D camera;
+    Rectangle viewBounds;
+    
+    Player players[MAX_PLAYERS];
+    int playerCount;
+    int visiblePlayers[MAX_PLAYERS];    // Indices into players inside cullBounds and not fogged
+    int visiblePlayerCount;
+    
+    // Fog of war: what the local player can see from their tick position,
+    // no points when it's off
+    Vector2 fogOrigin;
+    Vector2 fogPolygon[VISIBILITY_RAYS];
+    int fogPointCount;
+    
+    // Weapon table as of this tick; hot reload replaces the live one
+    WeaponStats weapons[MAX_WEAPONS];
+    int weaponCount;
+    Flag flags[2];
+    int teamScores[2];
+    float modeTimer;
+    float modeMaxTime;
+    float modeInstructionTimer;
+    
+    // Compacted: only the active entries inside cullBounds
+    Bullet bullets[MAX_BULLETS];
+    int bulletCount;
+    Particle particles[MAX_PARTICLES];
+    int particleCount;
+    MuzzleFlash muzzleFlashes[MAX_MUZZLE_FLASHES];
+    int muzzleFlashCount;
+    HitEffect hitEffects[MAX_HIT_EFFECTS];
+    int hitEffectCount;
+    Tracer tracers[MAX_TRACERS];
+    int tracerCount;
+    bool visualEffectsEnabled;
+    float effectQuality;
+    
+    // Screen effects
+    Vector2 screenShake;
+    float screenShakeIntensity;
+    bool screenShakeEnabled;
+    float damageFlashTimer;
+    Color damageFlashColor;
+    
+    // Overlay
+    ChatMessage chatMessages[MAX_CHAT_MESSAGES];
+    int chatMessageCount;
+    char statusMessage[256];
+    float statusTimer;
+    bool isHost;
+    bool isConnected;
+    float ping;
+    int packetsSent;
+    int packetsReceived;
+    ClockSync clock;
+};
+
 // Global game instance
 extern Game game;
 
@@ -5,26 +5,47 @@
 
 // Core game functions
 void InitGame(void);
-void UpdateGame(void);
-void DrawGame(void);
-void DrawGameBackground(void);
+void UpdateGame(float dt);
+void DrawGame(const RenderSnapshot* view);
+void DrawGameBackground(const RenderSnapshot* view);
+void UnloadGameBackground(void);
 void HandleInput(void);
+void StepSimulation(float dt);
+
+// Parts of a tick, for timing tools
+typedef enum {
+    TICK_STAGE_SCRIPT,      // Demo playback and bots
+    TICK_STAGE_PLAYERS,
+    TICK_STAGE_BULLETS,
+    TICK_STAGE_PARTICLES,
+    TICK_STAGE_EFFECTS,
+    TICK_STAGE_NETWORK,
+    TICK_STAGE_MODE,
+    TICK_STAGE_EVENTS,
+    TICK_STAGE_COUNT
+} TickStage;
+
+// Called as each stage begins and ends. Stages in the job graph report from
+// whichever thread runs them, once per range, so only a serial job system
+// gives clean numbers
+typedef void (*TickStageHook)(TickStage stage, bool begin);
+void SetTickStageHook(TickStageHook hook);
 
 // Game mode functions
 void InitGameMode(GameMode mode);
-void UpdateGameMode(void);
-void DrawGameMode(void);
+void UpdateGameMode(float dt);
+void DrawGameMode(const RenderSnapshot* view);
 const char* GetGameModeName(GameMode mode);
 void SwitchGameMode(GameMode mode);
 void ResetGameMode(void);
 
 // UI functions
-void DrawMenu(void);
+void DrawMenu(const RenderSnapshot* view);
 void DrawNameInput(void);
-void DrawHostSetup(void);
-void DrawJoinSetup(void);
+void DrawHostSetup(const RenderSnapshot* view);
+void DrawJoinSetup(const RenderSnapshot* view);
 void DrawGameModeMenu(void);
-void DrawUI(void);
+void DrawUI(const RenderSnapshot* view);
 
 // Utility functions
 void SetStatusMessage(const char* format, ...);
@@ -0,0 +1,55 @@
+#ifndef DEMO_H
+#define DEMO_H
+
+#include "common.h"
+
+// Demo file ("LDEM", native endian): header, then records appended in tick
+// order. A record is a keyframe (EncodeGameState output) or a gameplay
+// message as it went over the wire. Keyframes are written every few seconds,
+// so seeking restores the nearest earlier one and re-simulates from there.
+
+#define DEMO_MAGIC "LDEM"
+#define DEMO_VERSION 4
+#define DEMO_KEYFRAME_INTERVAL (TICK_RATE * 5)
+#define DEMO_PLAYER_INTERVAL 2          // Ticks between records of the host's own player
+#define DEMO_BUFFER_SIZE (512 * 1024)   // Per buffer; the writer thread drains one while the other fills
+#define DEMO_FLUSH_SIZE (64 * 1024)
+#define DEMO_SEEK_STEP 5.0f             // Seconds per seek key press
+
+typedef struct {
+    char magic[4];
+    unsigned short version;
+    unsigned short tickRate;
+    unsigned int startTick;
+    unsigned int snapshotVersion;
+} DemoFileHeader;
+
+typedef enum {
+    DEMO_RECORD_KEYFRAME,
+    DEMO_RECORD_MESSAGE
+} DemoRecordType;
+
+typedef struct {
+    unsigned char type;
+    unsigned char reserved;
+    unsigned short size;    // Payload bytes following the header
+    unsigned int tick;
+} DemoRecordHeader;
+
+// Recording (host, with the game lock held)
+bool StartDemoRecording(const char* path);
+void StopDemoRecording(void);
+bool IsDemoRecording(void);
+void RecordDemoMessage(const NetworkMessage* message);
+void RecordDemoTick(void);
+
+// Playback
+bool OpenDemo(const char* path);
+void CloseDemo(void);
+bool IsDemoPlaying(void);
+bool IsDemoPaused(void);
+void PlayDemoTick(void);
+void SeekDemo(float seconds);
+void HandleDemoInput(void);
+
+#endif // DEMO_H
@@ -0,0 +1,47 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "common.h"
+
+// Per-tick gameplay event queue. Collision and mode code only records what
+// happened; ProcessGameEvents() applies damage, scoring, effects and status
+// lines afterwards, in the order the events were pushed. Push with the game
+// lock held and from one job at a time (the tick graph orders the emitters).
+//
+// Only the authority (see HasAuthority()) emits events. A host sends each
+// tick's events to its clients, which queue and apply them the same way.
+
+#define MAX_GAME_EVENTS 512
+#define NO_PLAYER -1
+
+typedef enum {
+    EVENT_HIT,
+    EVENT_KILL,
+    EVENT_FLAG_PICKUP,
+    EVENT_FLAG_DROP,
+    EVENT_FLAG_CAPTURE,
+    EVENT_RESPAWN           // position: where the victim comes back
+} GameEventType;
+
+// Players are referred to by slot, so consumers skip the id lookups
+typedef struct {
+    unsigned char type;
+    signed char attacker;   // Shooter or flag carrier, NO_PLAYER if unknown
+    signed char victim;
+    unsigned char team;     // Flag events: the flag's team
+    short damage;
+    Vector2 position;
+    Vector2 direction;      // Hits: back toward the shooter
+} GameEvent;
+
+// Emitting
+void PushGameEvent(const GameEvent* event);
+void EmitHitEvent(int attacker, int victim, int damage, Vector2 position, Vector2 direction);
+void EmitFlagEvent(GameEventType type, int carrier, int team);
+void EmitRespawnEvent(int victim, Vector2 position);
+
+// Consuming
+void ProcessGameEvents(void);
+void ClearGameEvents(void);
+
+#endif // EVENTS_H
@@ -0,0 +1,31 @@
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include "common.h"
+
+// Flow fields over the map grid for bot navigation. A field stores, for
+// every open tile, the steps to the nearest target tile and which neighbour
+// is one step closer, so any number of bots read a heading in O(1). There is
+// one field per team and goal, except in deathmatch, where a single enemies
+// field targets every player and leads each bot past its own tile. A field
+// is rebuilt only when one of its targets moves to another tile, and only
+// once someone asks for it.
+
+#define FLOW_UNREACHABLE 0xFFFF
+
+typedef enum {
+    FLOW_ENEMIES,           // Live players of the other team, or everyone else without teams
+    FLOW_ENEMY_FLAG,        // The other team's flag, wherever it is
+    FLOW_HOME,              // Own flag base
+    FLOW_GOAL_COUNT
+} FlowGoal;
+
+// Once per tick, before any queries
+void UpdateFlowFields(void);
+
+// Unit vector toward the next tile on the way, or zero at a target or
+// where no target can be reached
+Vector2 GetFlowDirection(int team, FlowGoal goal, Vector2 position);
+int GetFlowDistance(int team, FlowGoal goal, Vector2 position);
+
+#endif // FLOWFIELD_H
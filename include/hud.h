@@ -0,0 +1,16 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include "common.h"
+
+// Retained HUD: each panel is rendered into its own texture and keyed by the
+// values it shows. A panel is re-formatted, re-measured and re-drawn only when
+// its key changes; otherwise drawing it is a single blit. Main thread only.
+
+#define HUD_MAX_KEY 24
+
+// HUD functions
+void DrawHud(const RenderSnapshot* view);
+void UnloadHud(void);
+
+#endif // HUD_H
@@ -0,0 +1,31 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "common.h"
+
+// Work-stealing job system. A caller builds a small graph of jobs with
+// AddJob()/AddParallelJob() and AddJobDependency(), then RunJobs() executes
+// it and returns once every job has finished. Parallel jobs are cut into
+// ranges that idle workers steal. The calling thread works alongside the
+// workers; without thread support, or before StartJobSystem(), it runs the
+// whole graph by itself in dependency order.
+
+#define MAX_JOB_WORKERS 8
+#define MAX_JOBS 32                 // Per graph
+#define JOB_QUEUE_SIZE 256          // Ranges per worker queue; overflow runs inline
+
+typedef void (*JobFunction)(void* data, int begin, int end);
+typedef int JobHandle;
+
+// Worker threads
+void StartJobSystem(void);
+void StopJobSystem(void);
+int GetJobWorkerCount(void);
+
+// Graph building and execution; one graph at a time (hold the game lock)
+JobHandle AddJob(JobFunction function, void* data);
+JobHandle AddParallelJob(JobFunction function, void* data, int count, int grain);
+void AddJobDependency(JobHandle job, JobHandle prerequisite);
+void RunJobs(void);
+
+#endif // JOBS_H
@@ -0,0 +1,27 @@
+#ifndef LISTENER_H
+#define LISTENER_H
+
+#include "common.h"
+
+// Sharded host ingress: several UDP sockets bound to the same port with
+// SO_REUSEPORT, each drained by its own receive thread. The kernel hashes
+// clients across the sockets, so a given client always lands on the same shard.
+// Received packets are queued per shard and processed on the game thread.
+
+#define MAX_LISTENER_SHARDS 8
+#define DEFAULT_LISTENER_SHARDS 4
+#define SHARD_QUEUE_SIZE 128
+
+// Listener shard functions
+int StartListenerShards(int port, int shardCount);
+void StopListenerShards(void);
+int DrainListenerShards(void);
+int GetListenerShardCount(void);
+int GetListenerSocket(int shard);
+int GetDefaultShardCount(void);
+
+// Connection routing
+int FindClientShard(struct sockaddr_in* addr);
+void ForgetClientRoute(struct sockaddr_in* addr);
+
+#endif // LISTENER_H
@@ -0,0 +1,39 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include "common.h"
+
+// Map file ("LMAP", little endian): header, then width*height occupancy
+// bytes, then width*height distance bytes. The distance grid is computed
+// when the map is built so queries can skip open space without touching tiles.
+
+#define MAP_MAGIC "LMAP"
+#define MAP_VERSION 1
+
+typedef struct {
+    char magic[4];
+    unsigned int version;
+    unsigned int width;
+    unsigned int height;
+    unsigned int tileSize;
+    unsigned int solidOffset;
+    unsigned int distanceOffset;
+} MapFileHeader;
+
+// Loading
+bool LoadMap(const char* path);
+bool LoadMapFromRows(const char** rows, int width, int height);
+bool SaveMap(const char* path);
+void UnloadMap(void);
+void LoadArenaMap(void);
+bool BuildArenaMap(void);
+
+// Queries
+bool IsWallAt(Vector2 position);
+float GetWallClearance(Vector2 position);
+bool MapRaycast(Vector2 from, Vector2 to, Vector2* hitPoint, Vector2* hitNormal);
+Vector2 MoveCircle(Vector2 position, Vector2 delta, float radius);
+Vector2 FindSpawnPoint(float minX, float maxX);
+Vector2 GetMapSize(void);
+
+#endif // MAP_H
@@ -2,17 +2,33 @@
 #define NETWORK_H
 
 #include "common.h"
+#include "events.h"
 // Socket headers are already included in common.h
 
 // Network message types and functions
 int StartHost(int port);
 int ConnectToServer(const char* ip, int port);
 void CloseNetwork(void);
-void UpdateNetwork(void);
+void UpdateNetwork(float dt);
 void SendMessage(NetworkMessage* message, struct sockaddr_in* destAddr);
+void BroadcastMessage(NetworkMessage* message, struct sockaddr_in* exceptAddr);
+void SendToPeers(NetworkMessage* message);
+void SendJoinRequest(void);
 void ProcessMessage(NetworkMessage* message, struct sockaddr_in* senderAddr);
 
+// Host authority: only it resolves hits, deaths and scores
+bool HasAuthority(void);
+void SendGameEvents(const GameEvent* events, int count);
+void ResendGameEvents(float dt);
+
+// Client sessions (host only)
+ClientSession* FindSession(struct sockaddr_in* addr);
+void UpdateSessions(void);
+void MarkPlayerDirty(int slot, ClientSession* except);
+void SendSessionSnapshots(float dt);
+
 // Network utility functions
 void GeneratePlayerId(char* playerId);
+size_t GetMessageSize(const NetworkMessage* message);
 
 #endif // NETWORK_H
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef PACING_H
+#define PACING_H
+
+#include "common.h"
+
+// Frame pacing. raylib's own limiter is off; after each frame the main thread
+// sleeps until shortly before the next deadline and spins the rest of the
+// way, so frames land on time without burning a core. The rate follows the
+// display or the user's cap in game and drops in menus and when unfocused.
+
+#define PACING_MENU_FPS 30
+#define PACING_BACKGROUND_FPS 10
+#define PACING_UNCAPPED -1              // game.targetFPS value for no limit
+#define PACING_SPIN_MIN 0.0005          // Seconds of spinning before a deadline
+#define PACING_SPIN_MAX 0.004
+#define PACING_SAMPLE_COUNT 120
+
+// Pacing functions
+void PaceFrame(bool inGame);
+int GetPacingTargetFPS(bool inGame);
+void GetFramePacingStats(float* meanMs, float* deviationMs);
+
+#endif // PACING_H
@@ -3,19 +3,26 @@
 
 #include "common.h"
 
+// Bursts draw their random numbers in one batch, so they are capped
+#define MAX_BURST_PARTICLES 64
+
 // Particle system functions
-void UpdateParticles(void);
-void UpdateMuzzleFlashes(void);
-void UpdateHitEffects(void);
-void DrawParticles(void);
-void DrawMuzzleFlashes(void);
-void DrawHitEffects(void);
+void UpdateParticles(float dt);
+int UpdateParticleRange(int begin, int end, float dt);   // Returns how many expired
+void UpdateMuzzleFlashes(float dt);
+void UpdateHitEffects(float dt);
+void UpdateTracers(float dt);
+void DrawParticles(const RenderSnapshot* view);
+void DrawMuzzleFlashes(const RenderSnapshot* view);
+void DrawHitEffects(const RenderSnapshot* view);
+void DrawTracers(const RenderSnapshot* view);
 
 // Particle creation functions
 void CreateParticle(Vector2 position, Vector2 velocity, float rotation, float rotationSpeed, 
                     float size, float lifetime, Color startColor, Color endColor, ParticleType type);
-void CreateMuzzleFlash(Vector2 position, float rotation, float size, Color color, const char* ownerId);
+void CreateMuzzleFlash(Vector2 position, Vector2 direction, float size, Color color, const char* ownerId);
 void CreateHitEffect(Vector2 position, float size, Color color);
+void CreateTracer(Vector2 start, Vector2 end, Color color);
 void CreateBloodSplatter(Vector2 position, Vector2 direction, int count);
 void CreateSparkEffect(Vector2 position, Vector2 direction, int count);
 
@@ -3,11 +3,25 @@
 
 #include "common.h"
 
+// One frame or tick of control, from the keyboard and mouse or from a bot
+typedef struct {
+    Vector2 move;           // -1..1 on each axis
+    Vector2 aimTarget;      // World point to face
+    int selectWeapon;       // Weapon slot, or -1 to keep the current one
+    int weaponStep;         // +1 next weapon, -1 previous
+    bool reload;
+    bool fireHeld;          // Automatic weapons fire while held
+    bool firePressed;       // Others fire once per press
+} PlayerInput;
+
 // Player management functions
 Player* FindPlayer(const char* playerId);
 Player* CreatePlayer(const char* playerId, const char* playerName, bool isLocal);
 void RemovePlayer(const char* playerId);
-void UpdatePlayers(void);
-void DrawPlayers(void);
+void UpdatePlayers(float dt);
+void ApplyPlayerInput(Player* player, const PlayerInput* input);
+Vector2 FindTeamSpawnPoint(const Player* player);
+bool AreTeammates(const Player* a, const Player* b);
+void DrawPlayers(const RenderSnapshot* view);
 
 #endif // PLAYER_H
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#include "common.h"
+
+// Adaptive effect quality. The main thread reports how long each frame took
+// to build; a smoothed time over the pacing target's budget steps quality
+// down quickly, a wide margin steps it back up slowly. Emitters scale their
+// counts, lifetimes and particle budget by the level, draw passes drop glow
+// and shadow layers.
+
+#define QUALITY_BUDGET_SHARE 0.8f   // Of the frame interval; leave room for the GPU and swap
+#define QUALITY_FALLBACK_FPS 60     // Budget rate when frames aren't capped
+#define QUALITY_MIN 0.25f
+#define QUALITY_STEP_DOWN 0.1f
+#define QUALITY_STEP_UP 0.05f
+#define QUALITY_SMOOTHING 0.1f
+#define QUALITY_COOLDOWN 0.5f       // Seconds between adjustments
+#define QUALITY_GLOW_LEVEL 0.6f     // Glow passes below this are skipped
+#define QUALITY_SHADOW_LEVEL 0.5f   // Layered shadows collapse to one below this
+
+// Governor (main thread)
+void UpdateEffectQuality(float frameWorkTime, float frameDelta, int targetFPS);
+float GetEffectQuality(void);
+
+// Scaling (with the game lock held)
+int ScaleEffectCount(int count);
+float ScaleEffectLifetime(float lifetime);
+int GetParticleBudget(void);
+
+#endif // QUALITY_H
@@ -0,0 +1,19 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "common.h"
+
+// Render snapshots in a triple buffer: the simulation always has a free
+// buffer to write the next tick into, and the renderer always has the newest
+// complete one, so neither side ever waits for the other.
+
+// Snapshot exchange
+void PublishRenderSnapshot(void);
+const RenderSnapshot* AcquireRenderSnapshot(void);
+
+// Lookups into a snapshot
+const Player* FindViewPlayer(const RenderSnapshot* view, const char* playerId);
+const WeaponStats* GetViewWeaponStats(const RenderSnapshot* view, int weapon);
+Camera2D GetViewCamera(void);
+
+#endif // RENDER_H
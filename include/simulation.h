@@ -0,0 +1,20 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "common.h"
+
+// Simulation thread: runs UpdateGame() and networking at the tick rate and
+// publishes render snapshots. The main thread keeps the window, input and
+// drawing. Game is only touched with the game lock held; the renderer reads
+// snapshots instead. Without thread support the main thread runs both.
+
+// Simulation thread functions
+void StartSimulation(void);
+void StopSimulation(void);
+void UpdateFrameInput(void);
+
+// Game state lock
+void LockGame(void);
+void UnlockGame(void);
+
+#endif // SIMULATION_H
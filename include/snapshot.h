@@ -0,0 +1,20 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "common.h"
+
+// Compact full-state snapshots. Positions and velocities are quantized to a
+// quarter pixel, angles to 16 bits and counters are varint coded, so a full
+// lobby with bullets in flight fits in a handful of fragments.
+
+#define SNAPSHOT_VERSION 3
+
+// Encoding
+int EncodeGameState(unsigned char* buffer, int capacity);
+bool DecodeGameState(const unsigned char* buffer, int size);
+
+// Transport
+void SendStateSnapshot(struct sockaddr_in* destAddr);
+void ReceiveSnapshotFragment(NetworkMessage* message);
+
+#endif // SNAPSHOT_H
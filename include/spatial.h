@@ -0,0 +1,29 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include "common.h"
+
+// Uniform grid over the map, one bucket list per entity kind. Each entity is
+// filed under the cell holding its centre, so a query must pad its area by
+// the entity's radius. Owned by the simulation: rebuild and query only with
+// the game lock held.
+
+#define SPATIAL_CELL_SIZE 128.0f
+#define SPATIAL_MAX_COLUMNS 64
+#define SPATIAL_MAX_CELLS (SPATIAL_MAX_COLUMNS * SPATIAL_MAX_COLUMNS)
+
+typedef enum {
+    SPATIAL_PLAYERS,
+    SPATIAL_BULLETS,
+    SPATIAL_PARTICLES,
+    SPATIAL_MUZZLE_FLASHES,
+    SPATIAL_HIT_EFFECTS,
+    SPATIAL_LAYER_COUNT
+} SpatialLayer;
+
+// Spatial index functions
+void RebuildSpatialLayer(SpatialLayer layer);
+int QuerySpatialLayer(SpatialLayer layer, Rectangle area, int* results, int maxResults);
+Rectangle GetSweptBounds(Vector2 from, Vector2 to, float radius);
+
+#endif // SPATIAL_H
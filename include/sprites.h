@@ -0,0 +1,20 @@
+#ifndef SPRITES_H
+#define SPRITES_H
+
+#include "common.h"
+
+// Player sprite atlas: one row per player slot with a cell per weapon, drawn
+// facing +x so a player is a single rotated quad. A row is keyed by the body
+// and outline colours it was baked with. The last row holds the team badges.
+// Touches GL textures, so main thread only.
+
+#define SPRITE_CELL_SIZE 64
+
+// Sprite functions
+void UpdatePlayerSprites(const RenderSnapshot* view);
+void DrawPlayerSprite(const RenderSnapshot* view, int slot, WeaponType weapon, Vector2 center, float rotation);
+void DrawTeamBadge(int team, Vector2 center);
+void GetPlayerColors(const RenderSnapshot* view, const Player* player, Color* body, Color* outline);
+void UnloadPlayerSprites(void);
+
+#endif // SPRITES_H
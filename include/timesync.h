@@ -0,0 +1,17 @@
+#ifndef TIMESYNC_H
+#define TIMESYNC_H
+
+#include "common.h"
+
+// Clock synchronization against the host. Each ping/pong exchange yields an
+// NTP-style sample; offset comes from the lowest-delay sample in the window
+// and drift from a least-squares fit over the rest. The host is the time base.
+
+// Clock sync functions
+void ResetClockSync(void);
+void AddClockSample(double sentTime, double receiveTime, double replyTime, double arrivalTime);
+double GetServerTime(void);
+unsigned int GetServerTick(void);
+void AdvanceTick(void);
+
+#endif // TIMESYNC_H
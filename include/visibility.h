@@ -0,0 +1,24 @@
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+#include "common.h"
+
+// Who can see whom, shared by bots, fog of war and replication. Rays go
+// through MapRaycast's grid walk. Player-to-player results are cached per
+// pair and kept until either player moves, so consumers asking the same
+// question in one tick pay for one raycast. Simulation thread only.
+
+// Nothing solid between the two players; symmetric
+bool HasLineOfSight(int viewer, int target);
+
+// Within FOV_RANGE and unoccluded, whichever way the viewer faces
+bool IsInSight(int viewer, int target);
+
+// In sight and inside the FOV_ANGLE cone the viewer is aiming along
+bool IsInFieldOfView(int viewer, int target);
+
+// What a player can see out to FOV_RANGE, clipped by walls: one point per
+// ray, evenly spaced around the player. Valid until the next call
+const Vector2* GetVisibilityPolygon(int viewer, int* count);
+
+#endif // VISIBILITY_H
@@ -3,16 +3,36 @@
 
 #include "common.h"
 
+#define WEAPONS_CONFIG_PATH "weapons.cfg"
+#define WEAPONS_RELOAD_INTERVAL 1.0     // Seconds between checks for an edited file
+
+// Weapon table. The file holds one "[Name]" section per weapon with
+// "key = value" lines; sections named after a built-in override it, any
+// other name adds a weapon in the next free slot.
+bool LoadWeapons(const char* path);
+void CheckWeaponsReload(void);
+int GetWeaponCount(void);
+WeaponStats* GetWeaponStats(int weapon);
+
 // Weapon functions
-WeaponStats* GetCurrentWeaponStats(Player* player);
+WeaponStats* GetCurrentWeaponStats(const Player* player);
 void SwitchWeapon(Player* player, WeaponType weapon);
 void ReloadWeapon(Player* player);
 bool CanShoot(Player* player);
 void FireWeapon(Player* player);
+void FireRemoteShot(Player* shooter, Vector2 origin, const float* angles, int count);
 
 // Bullet functions
-void CreateBullet(const char* ownerId, Vector2 position, float rotation, int damage, Color color);
-void UpdateBullets(void);
-void DrawBullets(void);
+void CreateBullet(const char* ownerId, Vector2 position, float rotation, int damage, float speed, Color color);
+void FireHitscan(const char* ownerId, Vector2 origin, float rotation, int damage, float range, Color color);
+void RetireBulletNear(int ownerSlot, Vector2 point);
+void UpdateBullets(float dt);
+
+// UpdateBullets() in stages, for the job graph: prepare, then move any split
+// of the slots in parallel, then resolve hits on one thread
+void PrepareBullets(void);
+void MoveBulletRange(int begin, int end, float dt);
+void ResolveBullets(void);
+void DrawBullets(const RenderSnapshot* view);
 
 #endif // WEAPONS_H
\ No newline at end of file
@@ -10,7 +10,7 @@ mkdir -p $DIST_DIR
 
 # Copy source files
 echo "📁 Copying source files..."
-cp -r src/ include/ Makefile README.md $DIST_DIR/
+cp -r src/ include/ maps/ tools/ Makefile README.md weapons.cfg $DIST_DIR/
 
 # Create Windows-specific files
 cp Makefile.windows build-windows.sh $DIST_DIR/
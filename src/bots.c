@@ -0,0 +1,306 @@
+#include "../include/common.h"
+#include "../include/bots.h"
+#include "../include/player.h"
+#include "../include/weapons.h"
+#include "../include/flowfield.h"
+#include "../include/network.h"
+#include "../include/events.h"
+#include "../include/map.h"
+#include "../include/visibility.h"
+#include "../include/core.h"
+
+typedef struct {
+    int target;             // Slot of the enemy being fought, or NO_PLAYER
+    float thinkTimer;
+    float strafeTimer;
+    float strafeSign;
+    Vector2 roamPoint;      // Where to wander when nothing leads anywhere
+} BotBrain;
+
+static BotBrain brains[MAX_PLAYERS];
+static int botFill = 0;
+static int botSerial = 0;
+
+static bool IsBotSlot(int slot)
+{
+    const Player* player = &game.players[slot];
+    return player->active && player->isBot && player->isLocal;
+}
+
+int GetBotCount(void)
+{
+    int count = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (IsBotSlot(i)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Tell the clients, who only learn of players through the host
+static void AnnounceBot(Player* bot, MessageType type)
+{
+    if (!game.isHost || !game.isConnected) {
+        return;
+    }
+    
+    NetworkMessage message;
+    message.type = type;
+    strcpy(message.playerId, bot->id);
+    message.data.player = *bot;
+    BroadcastMessage(&message, NULL);
+}
+
+Player* AddBot(void)
+{
+    if (!HasAuthority()) {
+        return NULL;
+    }
+    
+    // Under EVENT_PLAYER_ID_SIZE for the event wire format, unique per host
+    char id[32];
+    char name[32];
+    int serial = botSerial++ % 100;
+    snprintf(id, sizeof(id), "bot%02d%.10s", serial, game.localPlayerId);
+    snprintf(name, sizeof(name), "Bot %d", serial + 1);
+    
+    Player* bot = CreatePlayer(id, name, true);
+    if (!bot) {
+        return NULL;
+    }
+    bot->isBot = true;
+    
+    // Join the smaller team
+    int teamSizes[2] = {0, 0};
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (game.players[i].active && &game.players[i] != bot) {
+            teamSizes[game.players[i].team == 0 ? 0 : 1]++;
+        }
+    }
+    bot->team = teamSizes[0] <= teamSizes[1] ? 0 : 1;
+    if (game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG) {
+        bot->color = bot->team == 0 ? (Color){220, 50, 50, 255} : (Color){50, 50, 220, 255};
+    }
+    
+    bot->position = FindTeamSpawnPoint(bot);
+    bot->prevPosition = bot->position;
+    
+    int slot = (int)(bot - game.players);
+    brains[slot] = (BotBrain){ .target = NO_PLAYER, .strafeSign = 1.0f, .roamPoint = bot->position };
+    
+    AnnounceBot(bot, MSG_PLAYER_JOIN);
+    return bot;
+}
+
+// The most recently filled bot slot goes first
+bool RemoveBot(void)
+{
+    for (int i = MAX_PLAYERS - 1; i >= 0; i--) {
+        if (IsBotSlot(i)) {
+            Player* bot = &game.players[i];
+            AnnounceBot(bot, MSG_PLAYER_LEAVE);
+            RemovePlayer(bot->id);
+            return true;
+        }
+    }
+    return false;
+}
+
+void SetBotFill(int playerCount)
+{
+    botFill = playerCount < 0 ? 0 : playerCount > MAX_PLAYERS ? MAX_PLAYERS : playerCount;
+}
+
+static bool IsEnemy(const Player* bot, const Player* other)
+{
+    if (!other->active || other->health <= 0 || other == bot) {
+        return false;
+    }
+    return !AreTeammates(bot, other);
+}
+
+// Keep fighting whoever is still in sight; otherwise the nearest enemy the
+// bot is facing, or NO_PLAYER
+static int FindTarget(int slot, int current)
+{
+    const Player* bot = &game.players[slot];
+    if (current != NO_PLAYER && IsEnemy(bot, &game.players[current]) && IsInSight(slot, current)) {
+        return current;
+    }
+    
+    int target = NO_PLAYER;
+    float nearest = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        const Player* other = &game.players[i];
+        if (!IsEnemy(bot, other)) {
+            continue;
+        }
+        float distance = Vector2Distance(bot->position, other->position);
+        if ((target == NO_PLAYER || distance < nearest) && IsInFieldOfView(slot, i)) {
+            target = i;
+            nearest = distance;
+        }
+    }
+    return target;
+}
+
+static bool IsCarryingFlag(const Player* bot)
+{
+    for (int i = 0; i < 2; i++) {
+        if (game.flags[i].isCaptured && strcmp(game.flags[i].carrierId, bot->id) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Where the bot wants to be, and the flow field that leads there
+static FlowGoal ChooseGoal(const Player* bot, Vector2* goalPoint)
+{
+    if (game.mode == MODE_CAPTURE_FLAG) {
+        if (IsCarryingFlag(bot)) {
+            *goalPoint = game.flags[bot->team].basePosition;
+            return FLOW_HOME;
+        }
+        *goalPoint = game.flags[1 - bot->team].position;
+        return FLOW_ENEMY_FLAG;
+    }
+    *goalPoint = bot->position;
+    return FLOW_ENEMIES;
+}
+
+// A weapon with something left to shoot, or -1 to keep the current one
+static int ChooseWeapon(const Player* bot)
+{
+    int current = (int)bot->currentWeapon;
+    if (bot->magazineAmmo[current] > 0 || bot->ammo[current] > 0) {
+        return -1;
+    }
+    for (int i = 0; i < GetWeaponCount(); i++) {
+        WeaponStats* stats = GetWeaponStats(i);
+        if (stats && stats->enabled && (bot->magazineAmmo[i] > 0 || bot->ammo[i] > 0)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void DriveBot(int slot, float dt)
+{
+    Player* bot = &game.players[slot];
+    BotBrain* brain = &brains[slot];
+    
+    // Targets are reviewed a few times a second, staggered across bots
+    brain->thinkTimer -= dt;
+    if (brain->thinkTimer <= 0) {
+        brain->thinkTimer = BOT_THINK_INTERVAL + slot * 0.01f;
+        brain->target = FindTarget(slot, brain->target);
+    }
+    Player* target = brain->target != NO_PLAYER ? &game.players[brain->target] : NULL;
+    if (target && !IsEnemy(bot, target)) {
+        target = NULL;
+        brain->target = NO_PLAYER;
+    }
+    
+    PlayerInput input = { .selectWeapon = ChooseWeapon(bot) };
+    
+    // Follow the field; on the goal tile itself, head straight for the point
+    Vector2 goalPoint;
+    FlowGoal goal = ChooseGoal(bot, &goalPoint);
+    input.move = GetFlowDirection(bot->team, goal, bot->position);
+    if (input.move.x == 0 && input.move.y == 0) {
+        if (goal == FLOW_ENEMIES && !target) {
+            // Nobody to hunt: wander between spawn points
+            if (Vector2Distance(bot->position, brain->roamPoint) < TILE_SIZE) {
+                Vector2 mapSize = GetMapSize();
+                brain->roamPoint = FindSpawnPoint(PLAYER_SIZE, mapSize.x - PLAYER_SIZE);
+            }
+            goalPoint = brain->roamPoint;
+        } else if (target && goal == FLOW_ENEMIES) {
+            goalPoint = target->position;
+        }
+        
+        Vector2 toGoal = Vector2Subtract(goalPoint, bot->position);
+        if (Vector2Length(toGoal) > PLAYER_SIZE / 2) {
+            input.move = Vector2Normalize(toGoal);
+        }
+    }
+    
+    if (target) {
+        Vector2 toTarget = Vector2Subtract(target->position, bot->position);
+        
+        // Hunting and already close: circle the target rather than walk into it
+        if (goal == FLOW_ENEMIES && Vector2Length(toTarget) < BOT_STRAFE_RANGE) {
+            brain->strafeTimer -= dt;
+            if (brain->strafeTimer <= 0) {
+                brain->strafeTimer = BOT_STRAFE_TIME;
+                brain->strafeSign = -brain->strafeSign;
+            }
+            Vector2 across = Vector2Normalize((Vector2){ -toTarget.y, toTarget.x });
+            input.move = Vector2Scale(across, brain->strafeSign);
+        }
+        
+        input.aimTarget = target->position;
+        
+        // Only shoot once the smoothed rotation has come round
+        float error = atan2f(toTarget.y, toTarget.x) - bot->rotation;
+        while (error > M_PI) error -= 2 * M_PI;
+        while (error < -M_PI) error += 2 * M_PI;
+        input.fireHeld = fabsf(error) < BOT_AIM_TOLERANCE;
+        input.firePressed = input.fireHeld;
+    } else {
+        // Look where we're going
+        input.aimTarget = Vector2Add(bot->position, Vector2Scale(input.move, 100.0f));
+        if (input.move.x == 0 && input.move.y == 0) {
+            input.aimTarget = Vector2Add(bot->position, bot->direction);
+        }
+        input.reload = bot->magazineAmmo[bot->currentWeapon] < GetCurrentWeaponStats(bot)->magazineSize &&
+                       !bot->isReloading;
+    }
+    
+    ApplyPlayerInput(bot, &input);
+    
+    // The host relays bots like its own player
+    if (game.isHost) {
+        MarkPlayerDirty(slot, NULL);
+    }
+}
+
+// Top up or trim bots to the fill target; one change per tick
+static void UpdateBotFill(void)
+{
+    if (botFill == 0) {
+        return;
+    }
+    if (game.playerCount < botFill) {
+        AddBot();
+    } else if (game.playerCount > botFill) {
+        RemoveBot();
+    }
+}
+
+void UpdateBots(float dt)
+{
+    if (!HasAuthority()) {
+        return;
+    }
+    
+    UpdateBotFill();
+    
+    bool anyBots = false;
+    for (int i = 0; i < MAX_PLAYERS && !anyBots; i++) {
+        anyBots = IsBotSlot(i);
+    }
+    if (!anyBots) {
+        return;
+    }
+    
+    UpdateFlowFields();
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        // Dead bots wait for their respawn
+        if (IsBotSlot(i) && game.players[i].health > 0) {
+            DriveBot(i, dt);
+        }
+    }
+}
@@ -4,12 +4,25 @@
 #include "../include/weapons.h"
 #include "../include/particles.h"
 #include "../include/network.h"
+#include "../include/listener.h"
+#include "../include/timesync.h"
+#include "../include/render.h"
+#include "../include/map.h"
+#include "../include/sprites.h"
+#include "../include/hud.h"
+#include "../include/quality.h"
+#include "../include/pacing.h"
+#include "../include/rng.h"
+#include "../include/demo.h"
+#include "../include/jobs.h"
+#include "../include/events.h"
+#include "../include/bots.h"
 #include <errno.h>
 #include <stdarg.h>
 
 void InitGame(void)
 {
-    srand(time(NULL));
+    SeedRandomStreams((uint64_t)time(NULL));
     
     game.state = GAME_MENU;
     game.mode = MODE_DEATHMATCH;
@@ -18,8 +31,9 @@ void InitGame(void)
     game.isHost = false;
     game.isConnected = false;
     game.socket_fd = -1;
+    game.listenerShards = GetDefaultShardCount();
     game.debugMode = false;
-    game.targetFPS = 0; // Uncapped by default
+    game.targetFPS = 0; // Follow the display refresh rate
     game.vsyncEnabled = false;
     game.showAdvancedStats = false;
     game.screenShake = (Vector2){0, 0};
@@ -27,12 +41,23 @@ void InitGame(void)
     game.screenShakeEnabled = true;
     game.smoothMovement = true;
     game.visualEffectsEnabled = true;
+    game.fogOfWarEnabled = true;
+    game.effectQuality = 1.0f;
     game.particleCount = 0;
     game.muzzleFlashCount = 0;
     game.hitEffectCount = 0;
     game.damageFlashTimer = 0;
     game.damageFlashColor = (Color){255, 0, 0, 0};
     
+    // Load the arena once; returning to the menu keeps it
+    if (!game.map.data) {
+        LoadArenaMap();
+    }
+    
+    // Built-in weapons unless weapons.cfg overrides them
+    LoadWeapons(WEAPONS_CONFIG_PATH);
+    ClearGameEvents();
+    
     // Initialize player name
     strcpy(game.playerName, "Player");
     strcpy(game.playerNameInput, "Player");
@@ -43,7 +68,7 @@ void InitGame(void)
     game.editingChat = false;
     strcpy(game.chatInput, "");
     game.chatMessageCount = 0;
-    for (int i = 0; i < 10; i++) {
+    for (int i = 0; i < MAX_CHAT_MESSAGES; i++) {
         strcpy(game.chatMessages[i].message, "");
         strcpy(game.chatMessages[i].senderName, "");
         game.chatMessages[i].displayTime = 0;
@@ -53,15 +78,16 @@ void InitGame(void)
     game.teamScores[0] = 0;
     game.teamScores[1] = 0;
     
-    // Initialize flags for Capture the Flag mode
-    game.flags[0].position = (Vector2){100, SCREEN_HEIGHT/2};
-    game.flags[0].basePosition = (Vector2){100, SCREEN_HEIGHT/2};
+    // Initialize flags for Capture the Flag mode, one at each end of the map
+    Vector2 mapSize = GetMapSize();
+    game.flags[0].position = (Vector2){100, mapSize.y/2};
+    game.flags[0].basePosition = (Vector2){100, mapSize.y/2};
     game.flags[0].isCaptured = false;
     game.flags[0].team = 0;
     strcpy(game.flags[0].carrierId, "");
     
-    game.flags[1].position = (Vector2){SCREEN_WIDTH - 100, SCREEN_HEIGHT/2};
-    game.flags[1].basePosition = (Vector2){SCREEN_WIDTH - 100, SCREEN_HEIGHT/2};
+    game.flags[1].position = (Vector2){mapSize.x - 100, mapSize.y/2};
+    game.flags[1].basePosition = (Vector2){mapSize.x - 100, mapSize.y/2};
     game.flags[1].isCaptured = false;
     game.flags[1].team = 1;
     strcpy(game.flags[1].carrierId, "");
@@ -69,7 +95,7 @@ void InitGame(void)
     // Game mode settings
     game.modeTimer = 0;
     game.modeMaxTime = 300.0f; // 5 minutes by default
-    game.showModeInstructions = true;
+    game.modeInstructionTimer = MODE_INSTRUCTION_TIME;
     
     // Initialize all particles as inactive
     for (int i = 0; i < MAX_PARTICLES; i++) {
@@ -81,6 +107,9 @@ void InitGame(void)
     for (int i = 0; i < MAX_HIT_EFFECTS; i++) {
         game.hitEffects[i].active = false;
     }
+    for (int i = 0; i < MAX_TRACERS; i++) {
+        game.tracers[i].active = false;
+    }
     
     // Initialize input fields
     strcpy(game.hostPortStr, "12345");
@@ -100,20 +129,25 @@ void InitGame(void)
     }
 }
 
-void UpdateGame(void)
+void UpdateGame(float dt)
 {
-    float dt = GetFrameTime();
-    
-    HandleInput();
-    
-    if (game.state == GAME_PLAYING) {
-        UpdatePlayers();
-        UpdateBullets();
-        UpdateParticles();
-        UpdateMuzzleFlashes();
-        UpdateHitEffects();
-        UpdateNetwork();
-        UpdateGameMode();
+    if (game.state == GAME_PLAYING && !IsDemoPaused()) {
+        // Balance edits apply between ticks, never halfway through one
+        CheckWeaponsReload();
+        
+        // Run the simulation at a fixed rate, however fast we render
+        game.simAccumulator += dt;
+        int steps = 0;
+        while (game.simAccumulator >= SIM_DT && steps < MAX_SIM_STEPS) {
+            StepSimulation(SIM_DT);
+            game.simAccumulator -= SIM_DT;
+            steps++;
+        }
+        
+        // Long hitch: drop the backlog rather than fall further behind
+        if (game.simAccumulator >= SIM_DT) {
+            game.simAccumulator = 0;
+        }
     }
     
     // Update status message timer
@@ -121,6 +155,16 @@ void UpdateGame(void)
         game.statusTimer -= dt;
     }
     
+    // Mode instructions and chat lines fade out on their own
+    if (game.modeInstructionTimer > 0) {
+        game.modeInstructionTimer -= dt;
+    }
+    for (int i = 0; i < game.chatMessageCount; i++) {
+        if (game.chatMessages[i].displayTime > 0) {
+            game.chatMessages[i].displayTime -= dt;
+        }
+    }
+    
     // Update damage flash
     if (game.damageFlashTimer > 0) {
         game.damageFlashTimer -= dt;
@@ -132,8 +176,8 @@ void UpdateGame(void)
     if (game.screenShakeEnabled && game.screenShakeIntensity > 0) {
         // Reduce intensity by 75% and apply a smoother curve
         float dampenedIntensity = game.screenShakeIntensity * 0.05f;
-        game.screenShake.x = ((float)rand() / RAND_MAX - 0.5f) * 2.0f * dampenedIntensity;
-        game.screenShake.y = ((float)rand() / RAND_MAX - 0.5f) * 2.0f * dampenedIntensity;
+        game.screenShake.x = RandomRange(RNG_COSMETIC, -1.0f, 1.0f) * dampenedIntensity;
+        game.screenShake.y = RandomRange(RNG_COSMETIC, -1.0f, 1.0f) * dampenedIntensity;
         // Faster decay for less lingering shake
         game.screenShakeIntensity -= (SCREEN_SHAKE_DECAY * 1.5f) * dt;
         if (game.screenShakeIntensity < 0) game.screenShakeIntensity = 0;
@@ -143,120 +187,413 @@ void UpdateGame(void)
     }
 }
 
-void DrawGame(void)
+// Stage timing for tools/perfcheck; a null check when nobody is listening
+static TickStageHook stageHook = NULL;
+
+void SetTickStageHook(TickStageHook hook)
 {
-    // Apply screen shake offset
-    if (game.screenShakeEnabled && game.screenShakeIntensity > 0) {
-        rlPushMatrix();
-        rlTranslatef(game.screenShake.x, game.screenShake.y, 0);
+    stageHook = hook;
+}
+
+static void MarkStage(TickStage stage, bool begin)
+{
+    if (stageHook) {
+        stageHook(stage, begin);
     }
+}
+
+// Work per parallel range; smaller pieces cost more to hand out than they save
+#define PARTICLE_JOB_GRAIN 512
+#define BULLET_JOB_GRAIN 64
+
+static float jobDt;
+static int particlesExpired[(MAX_PARTICLES + PARTICLE_JOB_GRAIN - 1) / PARTICLE_JOB_GRAIN];
+
+static void PlayersJob(void* data, int begin, int end)
+{
+    (void)data; (void)begin; (void)end;
+    MarkStage(TICK_STAGE_PLAYERS, true);
+    UpdatePlayers(jobDt);
+    MarkStage(TICK_STAGE_PLAYERS, false);
+}
+
+static void ParticlesJob(void* data, int begin, int end)
+{
+    (void)data;
+    MarkStage(TICK_STAGE_PARTICLES, true);
+    particlesExpired[begin / PARTICLE_JOB_GRAIN] = UpdateParticleRange(begin, end, jobDt);
+    MarkStage(TICK_STAGE_PARTICLES, false);
+}
+
+static void ParticleCountJob(void* data, int begin, int end)
+{
+    (void)data; (void)begin; (void)end;
+    MarkStage(TICK_STAGE_PARTICLES, true);
+    for (int i = 0; i < (int)(sizeof(particlesExpired) / sizeof(particlesExpired[0])); i++) {
+        game.particleCount -= particlesExpired[i];
+    }
+    MarkStage(TICK_STAGE_PARTICLES, false);
+}
+
+static void EffectsJob(void* data, int begin, int end)
+{
+    (void)data; (void)begin; (void)end;
+    MarkStage(TICK_STAGE_EFFECTS, true);
+    UpdateHitEffects(jobDt);
+    UpdateTracers(jobDt);
+    MarkStage(TICK_STAGE_EFFECTS, false);
+}
+
+static void MuzzleFlashesJob(void* data, int begin, int end)
+{
+    (void)data; (void)begin; (void)end;
+    MarkStage(TICK_STAGE_EFFECTS, true);
+    UpdateMuzzleFlashes(jobDt);
+    MarkStage(TICK_STAGE_EFFECTS, false);
+}
+
+static void PrepareBulletsJob(void* data, int begin, int end)
+{
+    (void)data; (void)begin; (void)end;
+    MarkStage(TICK_STAGE_BULLETS, true);
+    PrepareBullets();
+    MarkStage(TICK_STAGE_BULLETS, false);
+}
+
+static void MoveBulletsJob(void* data, int begin, int end)
+{
+    (void)data;
+    MarkStage(TICK_STAGE_BULLETS, true);
+    MoveBulletRange(begin, end, jobDt);
+    MarkStage(TICK_STAGE_BULLETS, false);
+}
+
+static void ResolveBulletsJob(void* data, int begin, int end)
+{
+    (void)data; (void)begin; (void)end;
+    MarkStage(TICK_STAGE_BULLETS, true);
+    ResolveBullets();
+    MarkStage(TICK_STAGE_BULLETS, false);
+}
+
+// Entity updates as a job graph. Edges are the data each stage shares:
+// bullets read where players moved to, and resolving bullet hits spawns
+// particles and hit effects, so those updates finish first. Cosmetic work
+// overlaps with players and bullet movement.
+static void RunTickJobs(float dt)
+{
+    jobDt = dt;
+    
+    JobHandle players = AddJob(PlayersJob, NULL);
+    JobHandle particles = AddParallelJob(ParticlesJob, NULL, MAX_PARTICLES, PARTICLE_JOB_GRAIN);
+    JobHandle particleCount = AddJob(ParticleCountJob, NULL);
+    JobHandle effects = AddJob(EffectsJob, NULL);
+    JobHandle muzzleFlashes = AddJob(MuzzleFlashesJob, NULL);
+    JobHandle prepareBullets = AddJob(PrepareBulletsJob, NULL);
+    JobHandle moveBullets = AddParallelJob(MoveBulletsJob, NULL, MAX_BULLETS, BULLET_JOB_GRAIN);
+    JobHandle resolveBullets = AddJob(ResolveBulletsJob, NULL);
+    
+    AddJobDependency(particleCount, particles);
+    AddJobDependency(muzzleFlashes, players);
+    AddJobDependency(prepareBullets, players);
+    AddJobDependency(moveBullets, prepareBullets);
+    AddJobDependency(resolveBullets, moveBullets);
+    AddJobDependency(resolveBullets, particleCount);
+    AddJobDependency(resolveBullets, effects);
+    
+    RunJobs();
+}
+
+void StepSimulation(float dt)
+{
+    AdvanceTick();
     
-    switch (game.state) {
+    // A replay feeds recorded events in where the network would
+    MarkStage(TICK_STAGE_SCRIPT, true);
+    PlayDemoTick();
+    
+    // Bots pick their input before anyone moves
+    UpdateBots(dt);
+    MarkStage(TICK_STAGE_SCRIPT, false);
+    
+    // Remember where everything was so rendering can blend toward the new state
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        game.players[i].prevPosition = game.players[i].position;
+        game.players[i].prevRotation = game.players[i].rotation;
+    }
+    for (int i = 0; i < MAX_BULLETS; i++) {
+        game.bullets[i].prevPosition = game.bullets[i].position;
+    }
+    
+    RunTickJobs(dt);
+    
+    MarkStage(TICK_STAGE_NETWORK, true);
+    UpdateNetwork(dt);
+    MarkStage(TICK_STAGE_NETWORK, false);
+    
+    MarkStage(TICK_STAGE_MODE, true);
+    UpdateGameMode(dt);
+    MarkStage(TICK_STAGE_MODE, false);
+    
+    // Hits, kills and flag changes queued above take effect here, in order
+    MarkStage(TICK_STAGE_EVENTS, true);
+    ProcessGameEvents();
+    RecordDemoTick();
+    MarkStage(TICK_STAGE_EVENTS, false);
+}
+
+// Static background: baked once per map and mode, then drawn as a single quad
+#define BACKGROUND_MAX_SIZE 4096
+#define BACKGROUND_COLOR (Color){25, 30, 35, 255}
+
+static RenderTexture2D backgroundLayer;
+static bool backgroundBaked = false;
+static bool backgroundChecked = false;
+static const unsigned char* backgroundMapData = NULL;
+static GameMode backgroundMode;
+
+static void RefreshBackgroundLayer(const RenderSnapshot* view);
+
+#define FOG_COLOR (Color){10, 12, 16, 170}
+#define FOG_REACH (SCREEN_WIDTH * 2.0f)     // Past any screen corner from anywhere on screen
+
+// raylib culls clockwise triangles, so wind each one the same way
+static void DrawFogTriangle(Vector2 a, Vector2 b, Vector2 c)
+{
+    float cross = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (cross > 0) {
+        DrawTriangle(a, c, b, FOG_COLOR);
+    } else {
+        DrawTriangle(a, b, c, FOG_COLOR);
+    }
+}
+
+// Shade everything outside the visibility polygon: one quad per pair of
+// neighbouring rays, from the wall out past the edge of the screen
+static void DrawFogOfWar(const RenderSnapshot* view)
+{
+    // The polygon was cast from the tick position; carry it along with the
+    // player as drawn, between ticks, so it doesn't run ahead of the camera
+    const Player* local = FindViewPlayer(view, view->localPlayerId);
+    Vector2 shift = { 0, 0 };
+    if (local) {
+        shift = Vector2Subtract(Vector2Lerp(local->prevPosition, local->position, view->renderAlpha), local->position);
+    }
+    Vector2 origin = Vector2Add(view->fogOrigin, shift);
+    
+    int count = view->fogPointCount;
+    for (int i = 0; i < count; i++) {
+        Vector2 near0 = Vector2Add(view->fogPolygon[i], shift);
+        Vector2 near1 = Vector2Add(view->fogPolygon[(i + 1) % count], shift);
+        Vector2 far0 = Vector2Add(origin, Vector2Scale(Vector2Normalize(Vector2Subtract(near0, origin)), FOG_REACH));
+        Vector2 far1 = Vector2Add(origin, Vector2Scale(Vector2Normalize(Vector2Subtract(near1, origin)), FOG_REACH));
+        DrawFogTriangle(near0, near1, far1);
+        DrawFogTriangle(near0, far1, far0);
+    }
+}
+
+void DrawGame(const RenderSnapshot* view)
+{
+    switch (view->state) {
         case GAME_MENU:
-            DrawMenu();
+            DrawMenu(view);
             break;
         case GAME_NAME_INPUT:
             DrawNameInput();
             break;
         case GAME_HOST_SETUP:
-            DrawHostSetup();
+            DrawHostSetup(view);
             break;
         case GAME_JOIN_SETUP:
-            DrawJoinSetup();
+            DrawJoinSetup(view);
             break;
-        case GAME_PLAYING:
+        case GAME_PLAYING: {
+            // Screen shake moves the camera rather than the world
+            Camera2D camera = view->camera;
+            if (view->screenShakeEnabled && view->screenShakeIntensity > 0) {
+                camera.offset.x += view->screenShake.x;
+                camera.offset.y += view->screenShake.y;
+            }
+            
+            // Re-bake cached layers outside camera mode: texture mode resets the transform
+            RefreshBackgroundLayer(view);
+            UpdatePlayerSprites(view);
+            ClearBackground(BACKGROUND_COLOR);
+            
+            BeginMode2D(camera);
+            
             // Draw enhanced background
-            DrawGameBackground();
+            DrawGameBackground(view);
             
             // Draw game mode specific elements
-            DrawGameMode();
+            DrawGameMode(view);
             
-            DrawPlayers();
-            DrawBullets();
-            if (game.visualEffectsEnabled) {
-                DrawParticles();
-                DrawMuzzleFlashes();
-                DrawHitEffects();
+            DrawPlayers(view);
+            DrawBullets(view);
+            if (view->visualEffectsEnabled) {
+                DrawTracers(view);
+                DrawParticles(view);
+                DrawMuzzleFlashes(view);
+                DrawHitEffects(view);
             }
+            DrawFogOfWar(view);
+            
+            EndMode2D();
             
-            DrawUI();
+            DrawUI(view);
             
             // Draw damage flash overlay
-            if (game.damageFlashTimer > 0) {
-                DrawRectangle(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, game.damageFlashColor);
+            if (view->damageFlashTimer > 0) {
+                DrawRectangle(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, view->damageFlashColor);
             }
             break;
-    }
-    
-    // Remove screen shake offset
-    if (game.screenShakeEnabled && game.screenShakeIntensity > 0) {
-        rlPopMatrix();
+        }
     }
 }
 
-void DrawGameBackground(void)
+// Everything in the backdrop that only changes with the map or mode
+static void DrawBackgroundLayer(const RenderSnapshot* view, Rectangle bounds)
 {
-    // Enhanced background with grid pattern
-    Color bgColor = (Color){25, 30, 35, 255};
-    ClearBackground(bgColor);
+    const Map* map = view->map;
     
     // Draw grid pattern for better visual reference
     Color gridColor = (Color){40, 45, 50, 255};
     int gridSize = 50;
+    int gridLeft = (int)floorf(bounds.x / gridSize) * gridSize;
+    int gridTop = (int)floorf(bounds.y / gridSize) * gridSize;
     
     // Vertical lines
-    for (int x = 0; x < SCREEN_WIDTH; x += gridSize) {
-        DrawLineEx((Vector2){x, 0}, (Vector2){x, SCREEN_HEIGHT}, 1, gridColor);
+    for (int x = gridLeft; x <= bounds.x + bounds.width; x += gridSize) {
+        DrawLineEx((Vector2){x, bounds.y}, (Vector2){x, bounds.y + bounds.height}, 1, gridColor);
     }
     
     // Horizontal lines
-    for (int y = 0; y < SCREEN_HEIGHT; y += gridSize) {
-        DrawLineEx((Vector2){0, y}, (Vector2){SCREEN_WIDTH, y}, 1, gridColor);
+    for (int y = gridTop; y <= bounds.y + bounds.height; y += gridSize) {
+        DrawLineEx((Vector2){bounds.x, y}, (Vector2){bounds.x + bounds.width, y}, 1, gridColor);
     }
     
-    // Draw border walls
+    // Draw map walls
     Color wallColor = (Color){60, 70, 80, 255};
     Color wallHighlight = (Color){80, 90, 100, 255};
     
-    // Top wall
-    DrawRectangle(0, 0, SCREEN_WIDTH, 20, wallColor);
-    DrawRectangle(0, 18, SCREEN_WIDTH, 2, wallHighlight);
-    
-    // Bottom wall
-    DrawRectangle(0, SCREEN_HEIGHT - 20, SCREEN_WIDTH, 20, wallColor);
-    DrawRectangle(0, SCREEN_HEIGHT - 20, SCREEN_WIDTH, 2, wallHighlight);
-    
-    // Left wall
-    DrawRectangle(0, 0, 20, SCREEN_HEIGHT, wallColor);
-    DrawRectangle(18, 0, 2, SCREEN_HEIGHT, wallHighlight);
-    
-    // Right wall
-    DrawRectangle(SCREEN_WIDTH - 20, 0, 20, SCREEN_HEIGHT, wallColor);
-    DrawRectangle(SCREEN_WIDTH - 20, 0, 2, SCREEN_HEIGHT, wallHighlight);
+    if (map && map->data) {
+        int tileSize = (int)map->tileSize;
+        int minX = (int)floorf(bounds.x / tileSize);
+        int minY = (int)floorf(bounds.y / tileSize);
+        int maxX = (int)floorf((bounds.x + bounds.width) / tileSize);
+        int maxY = (int)floorf((bounds.y + bounds.height) / tileSize);
+        if (minX < 0) minX = 0;
+        if (minY < 0) minY = 0;
+        if (maxX >= map->width) maxX = map->width - 1;
+        if (maxY >= map->height) maxY = map->height - 1;
+        
+        for (int y = minY; y <= maxY; y++) {
+            for (int x = minX; x <= maxX; x++) {
+                if (!map->solid[y * map->width + x]) {
+                    continue;
+                }
+                DrawRectangle(x * tileSize, y * tileSize, tileSize, tileSize, wallColor);
+                
+                // Highlight the edges that face open floor
+                if (y + 1 < map->height && !map->solid[(y + 1) * map->width + x]) {
+                    DrawRectangle(x * tileSize, (y + 1) * tileSize - 2, tileSize, 2, wallHighlight);
+                }
+                if (x + 1 < map->width && !map->solid[y * map->width + x + 1]) {
+                    DrawRectangle((x + 1) * tileSize - 2, y * tileSize, 2, tileSize, wallHighlight);
+                }
+                if (y > 0 && !map->solid[(y - 1) * map->width + x]) {
+                    DrawRectangle(x * tileSize, y * tileSize, tileSize, 2, wallHighlight);
+                }
+                if (x > 0 && !map->solid[y * map->width + x - 1]) {
+                    DrawRectangle(x * tileSize, y * tileSize, 2, tileSize, wallHighlight);
+                }
+            }
+        }
+    }
     
     // Add some decorative elements
-    if (game.mode == MODE_CAPTURE_FLAG) {
+    if (view->mode == MODE_CAPTURE_FLAG) {
         // Draw flag bases
         Color redBaseColor = (Color){100, 30, 30, 150};
         Color blueBaseColor = (Color){30, 30, 100, 150};
         
         // Red base (left)
-        DrawRectangle(30, SCREEN_HEIGHT/2 - 60, 80, 120, redBaseColor);
-        DrawRectangleLines(30, SCREEN_HEIGHT/2 - 60, 80, 120, RED);
-        DrawText("RED BASE", 35, SCREEN_HEIGHT/2 - 5, 12, WHITE);
+        Vector2 mapSize = GetMapSize();
+        DrawRectangle(30, mapSize.y/2 - 60, 80, 120, redBaseColor);
+        DrawRectangleLines(30, mapSize.y/2 - 60, 80, 120, RED);
+        DrawText("RED BASE", 35, mapSize.y/2 - 5, 12, WHITE);
         
         // Blue base (right)
-        DrawRectangle(SCREEN_WIDTH - 110, SCREEN_HEIGHT/2 - 60, 80, 120, blueBaseColor);
-        DrawRectangleLines(SCREEN_WIDTH - 110, SCREEN_HEIGHT/2 - 60, 80, 120, BLUE);
-        DrawText("BLUE BASE", SCREEN_WIDTH - 105, SCREEN_HEIGHT/2 - 5, 12, WHITE);
+        DrawRectangle(mapSize.x - 110, mapSize.y/2 - 60, 80, 120, blueBaseColor);
+        DrawRectangleLines(mapSize.x - 110, mapSize.y/2 - 60, 80, 120, BLUE);
+        DrawText("BLUE BASE", mapSize.x - 105, mapSize.y/2 - 5, 12, WHITE);
     }
     
     // Add some ambient lighting effects
-    Vector2 lightPos = {SCREEN_WIDTH/2, SCREEN_HEIGHT/4};
+    Vector2 lightPos = {GetMapSize().x/2, GetMapSize().y/4};
     Color lightColor = (Color){255, 255, 200, 20};
     DrawCircleGradient(lightPos.x, lightPos.y, 200, lightColor, (Color){0, 0, 0, 0});
 }
 
+static bool BakeBackground(const RenderSnapshot* view)
+{
+    Vector2 size = GetMapSize();
+    
+    UnloadGameBackground();
+    
+    // Huge maps would blow the texture budget; they keep drawing per frame
+    if (size.x > BACKGROUND_MAX_SIZE || size.y > BACKGROUND_MAX_SIZE) {
+        return false;
+    }
+    
+    backgroundLayer = LoadRenderTexture((int)size.x, (int)size.y);
+    if (backgroundLayer.id == 0) {
+        return false;
+    }
+    
+    BeginTextureMode(backgroundLayer);
+    ClearBackground(BACKGROUND_COLOR);
+    DrawBackgroundLayer(view, (Rectangle){0, 0, size.x, size.y});
+    EndTextureMode();
+    
+    backgroundBaked = true;
+    return true;
+}
+
+static void RefreshBackgroundLayer(const RenderSnapshot* view)
+{
+    const unsigned char* mapData = view->map ? view->map->data : NULL;
+    
+    // A failed bake is not retried until the map or mode changes
+    if (!backgroundChecked || backgroundMapData != mapData || backgroundMode != view->mode) {
+        backgroundChecked = true;
+        backgroundMapData = mapData;
+        backgroundMode = view->mode;
+        BakeBackground(view);
+    }
+}
+
+void DrawGameBackground(const RenderSnapshot* view)
+{
+    if (!backgroundBaked) {
+        DrawBackgroundLayer(view, view->viewBounds);
+        return;
+    }
+    
+    // Render textures come out upside down
+    Texture2D texture = backgroundLayer.texture;
+    DrawTextureRec(texture, (Rectangle){0, 0, texture.width, -texture.height}, (Vector2){0, 0}, WHITE);
+}
+
+// Called before the window closes, while the GL context still exists
+void UnloadGameBackground(void)
+{
+    if (backgroundBaked) {
+        UnloadRenderTexture(backgroundLayer);
+        backgroundBaked = false;
+    }
+}
+
 void HandleInput(void)
 {
     switch (game.state) {
@@ -390,8 +727,8 @@ void HandleInput(void)
                         Player* player = CreatePlayer(game.localPlayerId, game.playerName, true);
                         if (player) {
                             // Set player at a better starting position
-                            player->position.x = SCREEN_WIDTH/2;
-                            player->position.y = SCREEN_HEIGHT/2;
+                            player->position.x = GetMapSize().x/2;
+                            player->position.y = GetMapSize().y/2;
                         }
                         
                         SetStatusMessage("Hosting game on port %d", game.hostPort);
@@ -507,16 +844,12 @@ void HandleInput(void)
                         Player* player = CreatePlayer(game.localPlayerId, game.playerName, true);
                         if (player) {
                             // Set player at a better starting position
-                            player->position.x = SCREEN_WIDTH/2;
-                            player->position.y = SCREEN_HEIGHT/2;
+                            player->position.x = GetMapSize().x/2;
+                            player->position.y = GetMapSize().y/2;
                         }
                         
-                        // Send join message
-                        NetworkMessage joinMsg;
-                        joinMsg.type = MSG_PLAYER_JOIN;
-                        strcpy(joinMsg.playerId, game.localPlayerId);
-                        joinMsg.data.player = *FindPlayer(game.localPlayerId);
-                        SendMessage(&joinMsg, &game.serverAddr);
+                        // Send join message; UpdateNetwork() repeats it until the host accepts
+                        SendJoinRequest();
                         
                         SetStatusMessage("Connected to %s:%d", game.joinIPStr, game.joinPort);
                     } else {
@@ -530,6 +863,12 @@ void HandleInput(void)
         }
             
         case GAME_PLAYING: {
+            // Replays only take playback controls
+            if (IsDemoPlaying()) {
+                HandleDemoInput();
+                break;
+            }
+            
             // Chat system
             if (IsKeyPressed(KEY_ENTER) && !game.editingChat) {
                 game.editingChat = true;
@@ -547,16 +886,7 @@ void HandleInput(void)
                         strcpy(chatMsg.playerId, game.localPlayerId);
                         strcpy(chatMsg.data.chatMessage, game.chatInput);
                         strcpy(chatMsg.data.senderName, game.playerName);
-                        
-                        if (game.isHost) {
-                            // Host sends to all clients
-                            for (int i = 0; i < game.clientCount; i++) {
-                                SendMessage(&chatMsg, &game.clientAddrs[i]);
-                            }
-                        } else {
-                            // Client sends to host
-                            SendMessage(&chatMsg, &game.serverAddr);
-                        }
+                        SendToPeers(&chatMsg);
                     }
                 }
                 game.editingChat = false;
@@ -613,17 +943,13 @@ void HandleInput(void)
                     game.debugMode = !game.debugMode;
                 }
                 
-                // Toggle vsync
+                // Toggle vsync (pace to the display regardless of the cap)
                 if (IsKeyPressed(KEY_F2)) {
                     game.vsyncEnabled = !game.vsyncEnabled;
-                    if (game.vsyncEnabled) {
-                        SetTargetFPS(GetMonitorRefreshRate(GetCurrentMonitor()));
-                    } else {
-                        SetTargetFPS(game.targetFPS); // Restore previous FPS setting
-                    }
+                    SetStatusMessage("Sync to display: %s", game.vsyncEnabled ? "on" : "off");
                 }
                 
-                // Toggle FPS limit
+                // Toggle FPS limit; the frame pacer picks it up next frame
                 if (IsKeyPressed(KEY_F3)) {
                     if (game.targetFPS == 0) {
                         game.targetFPS = 60;
@@ -631,12 +957,18 @@ void HandleInput(void)
                         game.targetFPS = 144;
                     } else if (game.targetFPS == 144) {
                         game.targetFPS = 240;
+                    } else if (game.targetFPS == 240) {
+                        game.targetFPS = PACING_UNCAPPED;
                     } else {
-                        game.targetFPS = 0; // Uncapped
+                        game.targetFPS = 0; // Display refresh
                     }
                     
-                    if (!game.vsyncEnabled) {
-                        SetTargetFPS(game.targetFPS);
+                    if (game.targetFPS == 0) {
+                        SetStatusMessage("Frame limit: display refresh");
+                    } else if (game.targetFPS == PACING_UNCAPPED) {
+                        SetStatusMessage("Frame limit: uncapped");
+                    } else {
+                        SetStatusMessage("Frame limit: %d FPS", game.targetFPS);
                     }
                 }
                 
@@ -660,86 +992,74 @@ void HandleInput(void)
                     game.visualEffectsEnabled = !game.visualEffectsEnabled;
                 }
                 
-                // Player movement controls
-                float horizontalInput = 0;
-                float verticalInput = 0;
-                
-                if (IsKeyDown(KEY_W) || IsKeyDown(KEY_UP)) verticalInput -= 1.0f;
-                if (IsKeyDown(KEY_S) || IsKeyDown(KEY_DOWN)) verticalInput += 1.0f;
-                if (IsKeyDown(KEY_A) || IsKeyDown(KEY_LEFT)) horizontalInput -= 1.0f;
-                if (IsKeyDown(KEY_D) || IsKeyDown(KEY_RIGHT)) horizontalInput += 1.0f;
+                // Toggle fog of war
+                if (IsKeyPressed(KEY_F11)) {
+                    game.fogOfWarEnabled = !game.fogOfWarEnabled;
+                    SetStatusMessage("Fog of war: %s", game.fogOfWarEnabled ? "on" : "off");
+                }
                 
-                // Normalize input vector if moving diagonally
-                if (horizontalInput != 0 && verticalInput != 0) {
-                    float length = sqrtf(horizontalInput * horizontalInput + verticalInput * verticalInput);
-                    horizontalInput /= length;
-                    verticalInput /= length;
+                // Toggle match recording (host only)
+                if (IsKeyPressed(KEY_F8) && game.isHost) {
+                    if (IsDemoRecording()) {
+                        StopDemoRecording();
+                    } else {
+                        char path[64];
+                        time_t now = time(NULL);
+                        strftime(path, sizeof(path), "layla-%Y%m%d-%H%M%S.dem", localtime(&now));
+                        if (StartDemoRecording(path)) {
+                            SetStatusMessage("Recording demo to %s", path);
+                        } else {
+                            SetStatusMessage("Could not record to %s", path);
+                        }
+                    }
                 }
                 
-                // Direct velocity application for better responsiveness
-                if (horizontalInput != 0 || verticalInput != 0) {
-                    localPlayer->velocity.x = horizontalInput * PLAYER_SPEED;
-                    localPlayer->velocity.y = verticalInput * PLAYER_SPEED;
-                } else {
-                    // Apply deceleration when no input
-                    localPlayer->velocity.x *= 0.8f;
-                    localPlayer->velocity.y *= 0.8f;
+                // Bots (host or offline only)
+                if (IsKeyPressed(KEY_F9) || IsKeyPressed(KEY_F10)) {
+                    if (!HasAuthority()) {
+                        SetStatusMessage("Only the host can add or remove bots");
+                    } else if (IsKeyPressed(KEY_F9)) {
+                        Player* bot = AddBot();
+                        if (bot) {
+                            SetStatusMessage("%s joined", bot->name);
+                        } else {
+                            SetStatusMessage("No free player slots");
+                        }
+                    } else {
+                        SetStatusMessage(RemoveBot() ? "Bot removed" : "No bots to remove");
+                    }
                 }
                 
-                // Update player rotation to face mouse
-                Vector2 mousePos = GetMousePosition();
-                Vector2 playerScreenPos = (Vector2){
-                    localPlayer->position.x, 
-                    localPlayer->position.y
-                };
+                // Everything below goes through the same input path bots use
+                PlayerInput input = { .selectWeapon = -1 };
                 
-                localPlayer->targetRotation = atan2f(mousePos.y - playerScreenPos.y, 
-                                                    mousePos.x - playerScreenPos.x);
+                // Player movement controls
+                if (IsKeyDown(KEY_W) || IsKeyDown(KEY_UP)) input.move.y -= 1.0f;
+                if (IsKeyDown(KEY_S) || IsKeyDown(KEY_DOWN)) input.move.y += 1.0f;
+                if (IsKeyDown(KEY_A) || IsKeyDown(KEY_LEFT)) input.move.x -= 1.0f;
+                if (IsKeyDown(KEY_D) || IsKeyDown(KEY_RIGHT)) input.move.x += 1.0f;
                 
-                // Weapon selection
-                if (IsKeyPressed(KEY_ONE)) SwitchWeapon(localPlayer, WEAPON_PISTOL);
-                if (IsKeyPressed(KEY_TWO)) SwitchWeapon(localPlayer, WEAPON_RIFLE);
-                if (IsKeyPressed(KEY_THREE)) SwitchWeapon(localPlayer, WEAPON_SHOTGUN);
-                if (IsKeyPressed(KEY_FOUR)) SwitchWeapon(localPlayer, WEAPON_SMG);
-                if (IsKeyPressed(KEY_FIVE)) SwitchWeapon(localPlayer, WEAPON_SNIPER);
+                // Face the mouse
+                input.aimTarget = GetScreenToWorld2D(GetMousePosition(), GetViewCamera());
                 
-                // Mouse wheel weapon switching
-                int wheel = GetMouseWheelMove();
-                if (wheel != 0) {
-                    int newWeapon = (int)localPlayer->currentWeapon + wheel;
-                    
-                    // Wrap around
-                    if (newWeapon < 0) newWeapon = WEAPON_TOTAL - 1;
-                    if (newWeapon >= WEAPON_TOTAL) newWeapon = 0;
-                    
-                    SwitchWeapon(localPlayer, (WeaponType)newWeapon);
+                // Weapon selection; keys past 5 reach weapons added by the weapons file
+                for (int key = KEY_ONE; key <= KEY_NINE; key++) {
+                    if (IsKeyPressed(key)) input.selectWeapon = key - KEY_ONE;
                 }
                 
-                // Reload weapon
-                if (IsKeyPressed(KEY_R)) {
-                    ReloadWeapon(localPlayer);
-                }
+                // Mouse wheel weapon switching
+                input.weaponStep = (int)GetMouseWheelMove();
                 
-                // Fire weapon
-                WeaponStats* stats = GetCurrentWeaponStats(localPlayer);
+                input.reload = IsKeyPressed(KEY_R);
+                input.fireHeld = IsMouseButtonDown(MOUSE_LEFT_BUTTON);
+                input.firePressed = IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
                 
-                if (stats && stats->enabled) {
-                    bool shouldFire = false;
-                    
-                    if (stats->automatic) {
-                        shouldFire = IsMouseButtonDown(MOUSE_LEFT_BUTTON);
-                    } else {
-                        shouldFire = IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
-                    }
-                    
-                    if (shouldFire && CanShoot(localPlayer)) {
-                        FireWeapon(localPlayer);
-                    }
-                }
+                ApplyPlayerInput(localPlayer, &input);
                 
                 // Exit to menu
                 if (IsKeyPressed(KEY_ESCAPE)) {
                     game.state = GAME_MENU;
+                    StopDemoRecording();
                     CloseNetwork();
                     
                     // Reset game
@@ -751,7 +1071,7 @@ void HandleInput(void)
     }
 }
 
-void DrawMenu(void)
+void DrawMenu(const RenderSnapshot* view)
 {
     // Modern gradient background
     DrawRectangleGradientV(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, (Color){10, 15, 25, 255}, (Color){25, 35, 50, 255});
@@ -818,7 +1138,7 @@ void DrawMenu(void)
     
     // Current game mode display with modern styling
     char modeText[64];
-    sprintf(modeText, "Current Mode: %s", GetGameModeName(game.mode));
+    sprintf(modeText, "Current Mode: %s", GetGameModeName(view->mode));
     Rectangle modeBg = {SCREEN_WIDTH/2 - 150, SCREEN_HEIGHT - 120, 300, 35};
     
     DrawRectangleRounded(modeBg, 0.3f, 8, (Color){20, 30, 45, 180});
@@ -862,7 +1182,7 @@ void DrawNameInput(void)
     DrawText("Press ESC to return to menu", SCREEN_WIDTH/2 - MeasureText("Press ESC to return to menu", 20)/2, SCREEN_HEIGHT - 50, 20, GRAY);
 }
 
-void DrawHostSetup(void)
+void DrawHostSetup(const RenderSnapshot* view)
 {
     DrawText("HOST GAME", SCREEN_WIDTH/2 - MeasureText("HOST GAME", 40)/2, SCREEN_HEIGHT/4, 40, WHITE);
     
@@ -883,12 +1203,12 @@ void DrawHostSetup(void)
     DrawText("Press ESC to return", SCREEN_WIDTH/2 - MeasureText("Press ESC to return", 20)/2, SCREEN_HEIGHT - 50, 20, GRAY);
     
     // Draw status message if set
-    if (game.statusTimer > 0) {
-        DrawText(game.statusMessage, 10, SCREEN_HEIGHT - 30, 20, RED);
+    if (view->statusTimer > 0) {
+        DrawText(view->statusMessage, 10, SCREEN_HEIGHT - 30, 20, RED);
     }
 }
 
-void DrawJoinSetup(void)
+void DrawJoinSetup(const RenderSnapshot* view)
 {
     DrawText("JOIN GAME", SCREEN_WIDTH/2 - MeasureText("JOIN GAME", 40)/2, SCREEN_HEIGHT/4, 40, WHITE);
     
@@ -915,192 +1235,33 @@ void DrawJoinSetup(void)
     DrawText("Press ESC to return", SCREEN_WIDTH/2 - MeasureText("Press ESC to return", 20)/2, SCREEN_HEIGHT - 50, 20, GRAY);
     
     // Draw status message if set
-    if (game.statusTimer > 0) {
-        DrawText(game.statusMessage, 10, SCREEN_HEIGHT - 30, 20, RED);
+    if (view->statusTimer > 0) {
+        DrawText(view->statusMessage, 10, SCREEN_HEIGHT - 30, 20, RED);
     }
 }
 
-void DrawUI(void)
+void DrawUI(const RenderSnapshot* view)
 {
-    // Draw Player UI
-    Player* localPlayer = FindPlayer(game.localPlayerId);
-    
-    if (localPlayer && localPlayer->active) {
-        // Health bar
-        int healthBarWidth = 200;
-        int healthBarHeight = 20;
-        float healthPercentage = localPlayer->health / localPlayer->maxHealth;
-        
-        DrawRectangle(20, 20, healthBarWidth, healthBarHeight, DARKGRAY);
-        DrawRectangle(20, 20, (int)(healthBarWidth * healthPercentage), healthBarHeight, RED);
-        DrawRectangleLinesEx((Rectangle){20, 20, healthBarWidth, healthBarHeight}, 2, BLACK);
-        
-        char healthText[32];
-        sprintf(healthText, "Health: %.0f/%.0f", localPlayer->health, localPlayer->maxHealth);
-        DrawText(healthText, 25, 20, 16, WHITE);
-        
-        // Team info for team modes
-        if (game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG) {
-            const char* teamName = localPlayer->team == 0 ? "RED" : "BLUE";
-            Color teamColor = localPlayer->team == 0 ? RED : BLUE;
-            DrawText(teamName, 20, 45, 16, teamColor);
-        }
-        
-        // Enhanced weapon info display
-        WeaponStats* stats = GetCurrentWeaponStats(localPlayer);
-        if (stats && stats->enabled) {
-            // Weapon panel background
-            Rectangle weaponPanel = {15, 45, 300, 70};
-            DrawRectangleRounded(weaponPanel, 0.2f, 8, (Color){20, 25, 30, 200});
-            DrawRectangleRoundedLines(weaponPanel, 0.2f, 8, (Color){60, 80, 120, 255});
-            
-            // Weapon name with icon
-            const char* weaponIcon = "🔫";
-            switch (localPlayer->currentWeapon) {
-                case WEAPON_PISTOL: weaponIcon = "🔫"; break;
-                case WEAPON_RIFLE: weaponIcon = "🏹"; break;
-                case WEAPON_SHOTGUN: weaponIcon = "💥"; break;
-                case WEAPON_SMG: weaponIcon = "⚡"; break;
-                case WEAPON_SNIPER: weaponIcon = "🎯"; break;
-                default: break;
-            }
-            
-            char weaponTitle[64];
-            sprintf(weaponTitle, "%s %s", weaponIcon, stats->name);
-            DrawText(weaponTitle, 25, 55, 18, WHITE);
-            
-            // Ammo count with modern styling
-            char ammoText[32];
-            sprintf(ammoText, "%d / %d", 
-                    localPlayer->magazineAmmo[localPlayer->currentWeapon],
-                    localPlayer->ammo[localPlayer->currentWeapon]);
-            DrawText(ammoText, 200, 55, 16, LIGHTGRAY);
-            
-            // Enhanced visual ammo display
-            int maxAmmo = stats->magazineSize;
-            int currentAmmo = localPlayer->magazineAmmo[localPlayer->currentWeapon];
-            float ammoPercentage = maxAmmo > 0 ? (float)currentAmmo / maxAmmo : 0;
-            
-            // Ammo bar background
-            Rectangle ammoBar = {25, 80, 200, 8};
-            DrawRectangleRounded(ammoBar, 0.5f, 8, (Color){40, 40, 40, 200});
-            
-            // Ammo bar fill
-            Color ammoColor = ammoPercentage > 0.5f ? GREEN : 
-                             ammoPercentage > 0.2f ? YELLOW : RED;
-            Rectangle ammoFill = {25, 80, 200 * ammoPercentage, 8};
-            DrawRectangleRounded(ammoFill, 0.5f, 8, ammoColor);
-            
-            // Individual bullet indicators for clarity
-            int bulletsToShow = currentAmmo > 20 ? 20 : currentAmmo;
-            for (int i = 0; i < bulletsToShow; i++) {
-                int bulletX = 25 + i * 9;
-                DrawRectangleRounded((Rectangle){bulletX, 95, 6, 12}, 0.3f, 4, YELLOW);
-                DrawRectangleRoundedLines((Rectangle){bulletX, 95, 6, 12}, 0.3f, 4, GOLD);
-            }
-            
-            // Show "..." if more bullets than displayed
-            if (currentAmmo > 20) {
-                DrawText("...", 25 + 20 * 9, 98, 12, YELLOW);
-            }
-        }
-        
-        // Enhanced reloading indicator
-        if (localPlayer->isReloading) {
-            Rectangle reloadPanel = {15, 120, 150, 30};
-            float reloadProgress = 1.0f - (localPlayer->reloadTimer / GetCurrentWeaponStats(localPlayer)->reloadTime);
-            
-            // Background
-            DrawRectangleRounded(reloadPanel, 0.3f, 8, (Color){60, 60, 20, 200});
-            
-            // Progress bar
-            Rectangle progressBar = {20, 125, 140 * reloadProgress, 20};
-            DrawRectangleRounded(progressBar, 0.3f, 8, ORANGE);
-            
-            // Text
-            DrawText("RELOADING...", 25, 130, 12, WHITE);
-        }
-    }
-    
-    // Network info & FPS counter in corner
-    if (game.debugMode) {
-        char debugText[128];
-        sprintf(debugText, "FPS: %d", GetFPS());
-        DrawText(debugText, SCREEN_WIDTH - MeasureText(debugText, 20) - 10, 10, 20, LIME);
-        
-        if (game.isConnected) {
-            sprintf(debugText, "Ping: %.1f ms", game.ping);
-            DrawText(debugText, SCREEN_WIDTH - MeasureText(debugText, 20) - 10, 35, 20, LIME);
-            
-            sprintf(debugText, "Players: %d", game.playerCount);
-            DrawText(debugText, SCREEN_WIDTH - MeasureText(debugText, 20) - 10, 60, 20, LIME);
-            
-            sprintf(debugText, "Game Mode: %s", GetGameModeName(game.mode));
-            DrawText(debugText, SCREEN_WIDTH - MeasureText(debugText, 20) - 10, 85, 20, LIME);
-            
-            // Show player name
-            char nameText[64];
-            sprintf(nameText, "Playing as: %s", game.playerName);
-            DrawText(nameText, SCREEN_WIDTH - MeasureText(nameText, 16) - 10, SCREEN_HEIGHT - 25, 16, YELLOW);
-            
-            if (game.showAdvancedStats) {
-                sprintf(debugText, "Packets Sent: %d", game.packetsSent);
-                DrawText(debugText, SCREEN_WIDTH - MeasureText(debugText, 20) - 10, 85, 20, LIME);
-                
-                sprintf(debugText, "Packets Received: %d", game.packetsReceived);
-                DrawText(debugText, SCREEN_WIDTH - MeasureText(debugText, 20) - 10, 110, 20, LIME);
-                
-                sprintf(debugText, "Bullets: %d", game.bulletCount);
-                DrawText(debugText, SCREEN_WIDTH - MeasureText(debugText, 20) - 10, 135, 20, LIME);
-                
-                sprintf(debugText, "Particles: %d", game.particleCount);
-                DrawText(debugText, SCREEN_WIDTH - MeasureText(debugText, 20) - 10, 160, 20, LIME);
-            }
-        }
-    } else {
-        // Just show FPS when not in debug mode
-        char fpsText[32];
-        sprintf(fpsText, "FPS: %d", GetFPS());
-        DrawText(fpsText, SCREEN_WIDTH - MeasureText(fpsText, 20) - 10, 10, 20, WHITE);
-    }
+    // Player, network and mode panels are cached textures
+    DrawHud(view);
     
     // Draw status message if set
-    if (game.statusTimer > 0) {
-        DrawText(game.statusMessage, 10, SCREEN_HEIGHT - 30, 20, YELLOW);
+    if (view->statusTimer > 0) {
+        DrawText(view->statusMessage, 10, SCREEN_HEIGHT - 30, 20, YELLOW);
     }
     
     // Draw game mode information
-    if (game.state == GAME_PLAYING) {
-        char modeText[64];
-        sprintf(modeText, "Mode: %s", GetGameModeName(game.mode));
-        DrawText(modeText, SCREEN_WIDTH/2 - MeasureText(modeText, 20)/2, 10, 20, WHITE);
-        
-        // Show mode timer if applicable
-        if (game.modeMaxTime > 0) {
-            int timeRemaining = (int)(game.modeMaxTime - game.modeTimer);
-            int minutes = timeRemaining / 60;
-            int seconds = timeRemaining % 60;
-            char timeText[32];
-            sprintf(timeText, "Time: %02d:%02d", minutes, seconds);
-            DrawText(timeText, SCREEN_WIDTH/2 - MeasureText(timeText, 20)/2, 35, 20, WHITE);
-        }
-        
-        // Show team scores for team modes
-        if (game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG) {
-            char scoreText[64];
-            sprintf(scoreText, "RED %d - %d BLUE", game.teamScores[0], game.teamScores[1]);
-            DrawText(scoreText, SCREEN_WIDTH/2 - MeasureText(scoreText, 24)/2, 60, 24, WHITE);
-        }
-        
+    if (view->state == GAME_PLAYING) {
         // Enhanced Production-Level Scoreboard for Deathmatch
-        if (game.mode == MODE_DEATHMATCH && IsKeyDown(KEY_TAB)) {
+        if (view->mode == MODE_DEATHMATCH && IsKeyDown(KEY_TAB)) {
             // Animated background with blur effect
             float boardWidth = 600;
             float boardHeight = 400;
             Rectangle boardBg = {SCREEN_WIDTH/2 - boardWidth/2, 80, boardWidth, boardHeight};
             
             // Multiple shadow layers for depth
-            for (int i = 0; i < 5; i++) {
+            int shadowLayers = view->effectQuality >= QUALITY_SHADOW_LEVEL ? 5 : 1;
+            for (int i = 0; i < shadowLayers; i++) {
                 Rectangle shadow = {boardBg.x + i*2, boardBg.y + i*2, boardBg.width, boardBg.height};
                 DrawRectangleRounded(shadow, 0.1f, 12, (Color){0, 0, 0, 15});
             }
@@ -1111,7 +1272,9 @@ void DrawUI(void)
             // Animated border with glow
             float glowPulse = 0.7f + 0.3f * sinf(GetTime() * 2.0f);
             DrawRectangleRoundedLines(boardBg, 0.08f, 12, (Color){70, 130, 200, (int)(180 * glowPulse)});
-            DrawRectangleRoundedLines(boardBg, 0.08f, 12, (Color){120, 180, 255, (int)(120 * glowPulse)});
+            if (view->effectQuality >= QUALITY_GLOW_LEVEL) {
+                DrawRectangleRoundedLines(boardBg, 0.08f, 12, (Color){120, 180, 255, (int)(120 * glowPulse)});
+            }
             
             // Modern header with icon and styling
             float headerY = boardBg.y + 20;
@@ -1144,8 +1307,8 @@ void DrawUI(void)
             Player sortedPlayers[MAX_PLAYERS];
             int activePlayers = 0;
             for (int i = 0; i < MAX_PLAYERS; i++) {
-                if (game.players[i].active) {
-                    sortedPlayers[activePlayers] = game.players[i];
+                if (view->players[i].active) {
+                    sortedPlayers[activePlayers] = view->players[i];
                     activePlayers++;
                 }
             }
@@ -1172,7 +1335,7 @@ void DrawUI(void)
                 DrawRectangleRounded(rowBg, 0.2f, 6, rowColor);
                 
                 // Highlight local player with special effects
-                if (p->isLocal) {
+                if (p->isLocal && !p->isBot) {
                     float highlightPulse = 0.6f + 0.4f * sinf(GetTime() * 4.0f);
                     DrawRectangleRounded(rowBg, 0.2f, 6, (Color){255, 215, 0, (int)(30 * highlightPulse)});
                     DrawRectangleRoundedLines(rowBg, 0.2f, 6, (Color){255, 215, 0, (int)(150 * highlightPulse)});
@@ -1189,8 +1352,9 @@ void DrawUI(void)
                 DrawText(rankText, boardBg.x + 30, entryY, 16, rankColor);
                 
                 // Player name with special formatting for local player
-                Color nameColor = p->isLocal ? (Color){255, 255, 100, 255} : WHITE;
-                if (p->isLocal) {
+                bool isYou = p->isLocal && !p->isBot;
+                Color nameColor = isYou ? (Color){255, 255, 100, 255} : WHITE;
+                if (isYou) {
                     DrawText("👤", boardBg.x + 60, entryY, 16, (Color){255, 215, 0, 255});
                     DrawText(p->name, boardBg.x + 85, entryY, 16, nameColor);
                 } else {
@@ -1241,9 +1405,9 @@ void DrawUI(void)
         }
         
         // Show mode instructions temporarily
-        if (game.showModeInstructions) {
+        if (view->modeInstructionTimer > 0) {
             const char* instructions = "";
-            switch (game.mode) {
+            switch (view->mode) {
                 case MODE_DEATHMATCH:
                     instructions = "DEATHMATCH: Eliminate other players to score points!";
                     break;
@@ -1259,48 +1423,35 @@ void DrawUI(void)
             
             DrawRectangle(0, SCREEN_HEIGHT/2 - 20, SCREEN_WIDTH, 40, (Color){0, 0, 0, 150});
             DrawText(instructions, SCREEN_WIDTH/2 - MeasureText(instructions, 20)/2, SCREEN_HEIGHT/2 - 10, 20, WHITE);
-            
-            // Hide instructions after 5 seconds
-            static float instructionTimer = 5.0f;
-            instructionTimer -= GetFrameTime();
-            if (instructionTimer <= 0) {
-                game.showModeInstructions = false;
-                instructionTimer = 5.0f;
-            }
         }
     }
     
     // === PRODUCTION-LEVEL CHAT SYSTEM ===
-    if (game.state == GAME_PLAYING) {
-        // Update chat message timers and fade effects
-        for (int i = 0; i < game.chatMessageCount; i++) {
-            if (game.chatMessages[i].displayTime > 0) {
-                game.chatMessages[i].displayTime -= GetFrameTime();
-            }
-        }
-        
+    if (view->state == GAME_PLAYING) {
         // Modern Chat Messages Display with animations
         int chatY = 15;
-        for (int i = 0; i < game.chatMessageCount && i < 5; i++) {
-            if (game.chatMessages[i].displayTime > 0) {
+        for (int i = 0; i < view->chatMessageCount && i < 5; i++) {
+            if (view->chatMessages[i].displayTime > 0) {
                 // Calculate fade and slide animations
-                float fadeAlpha = game.chatMessages[i].displayTime < 2.0f ? 
-                                 (game.chatMessages[i].displayTime / 2.0f) : 1.0f;
-                float slideOffset = game.chatMessages[i].displayTime > 8.0f ? 
-                                   (10.0f - game.chatMessages[i].displayTime) * 20 : 0;
+                float fadeAlpha = view->chatMessages[i].displayTime < 2.0f ? 
+                                 (view->chatMessages[i].displayTime / 2.0f) : 1.0f;
+                float slideOffset = view->chatMessages[i].displayTime > 8.0f ? 
+                                   (10.0f - view->chatMessages[i].displayTime) * 20 : 0;
                 
                 char chatLine[320];
-                sprintf(chatLine, "%s: %s", game.chatMessages[i].senderName, game.chatMessages[i].message);
+                sprintf(chatLine, "%s: %s", view->chatMessages[i].senderName, view->chatMessages[i].message);
                 
                 int textWidth = MeasureText(chatLine, 16);
-                int nameWidth = MeasureText(game.chatMessages[i].senderName, 16);
+                int nameWidth = MeasureText(view->chatMessages[i].senderName, 16);
                 
                 // Modern chat bubble with rounded corners and shadow
                 Rectangle chatBg = {15 - slideOffset, chatY - 3, textWidth + 25, 24};
                 Rectangle shadow = {chatBg.x + 2, chatBg.y + 2, chatBg.width, chatBg.height};
                 
                 // Drop shadow
-                DrawRectangleRounded(shadow, 0.4f, 8, (Color){0, 0, 0, (int)(40 * fadeAlpha)});
+                if (view->effectQuality >= QUALITY_SHADOW_LEVEL) {
+                    DrawRectangleRounded(shadow, 0.4f, 8, (Color){0, 0, 0, (int)(40 * fadeAlpha)});
+                }
                 
                 // Main background with gradient effect
                 DrawRectangleRounded(chatBg, 0.4f, 8, (Color){25, 25, 35, (int)(180 * fadeAlpha)});
@@ -1308,8 +1459,8 @@ void DrawUI(void)
                 
                 // Player name with unique color based on name hash
                 unsigned int nameHash = 0;
-                for (int j = 0; game.chatMessages[i].senderName[j]; j++) {
-                    nameHash = nameHash * 31 + game.chatMessages[i].senderName[j];
+                for (int j = 0; view->chatMessages[i].senderName[j]; j++) {
+                    nameHash = nameHash * 31 + view->chatMessages[i].senderName[j];
                 }
                 Color nameColor = {
                     (unsigned char)(100 + (nameHash % 155)),
@@ -1319,9 +1470,9 @@ void DrawUI(void)
                 };
                 
                 // Draw text with proper spacing
-                DrawText(game.chatMessages[i].senderName, chatBg.x + 10, chatY, 16, nameColor);
+                DrawText(view->chatMessages[i].senderName, chatBg.x + 10, chatY, 16, nameColor);
                 DrawText(": ", chatBg.x + 10 + nameWidth, chatY, 16, (Color){180, 180, 180, (int)(255 * fadeAlpha)});
-                DrawText(game.chatMessages[i].message, chatBg.x + 10 + nameWidth + 12, chatY, 16, 
+                DrawText(view->chatMessages[i].message, chatBg.x + 10 + nameWidth + 12, chatY, 16, 
                         (Color){255, 255, 255, (int)(255 * fadeAlpha)});
                 
                 chatY += 28;
@@ -1388,7 +1539,7 @@ void SetStatusMessage(const char* format, ...)
 void AddChatMessage(const char* message, const char* senderName)
 {
     // Shift existing messages up
-    for (int i = 9; i > 0; i--) {
+    for (int i = MAX_CHAT_MESSAGES - 1; i > 0; i--) {
         strcpy(game.chatMessages[i].message, game.chatMessages[i-1].message);
         strcpy(game.chatMessages[i].senderName, game.chatMessages[i-1].senderName);
         game.chatMessages[i].displayTime = game.chatMessages[i-1].displayTime;
@@ -1399,7 +1550,7 @@ void AddChatMessage(const char* message, const char* senderName)
     strcpy(game.chatMessages[0].senderName, senderName);
     game.chatMessages[0].displayTime = 10.0f; // Display for 10 seconds
     
-    if (game.chatMessageCount < 10) {
+    if (game.chatMessageCount < MAX_CHAT_MESSAGES) {
         game.chatMessageCount++;
     }
 }
@@ -1506,14 +1657,15 @@ void InitGameMode(GameMode mode)
             game.modeMaxTime = 600.0f; // 10 minutes
             
             // Reset flags
-            game.flags[0].position = (Vector2){100, SCREEN_HEIGHT/2};
-            game.flags[0].basePosition = (Vector2){100, SCREEN_HEIGHT/2};
+            Vector2 mapSize = GetMapSize();
+            game.flags[0].position = (Vector2){100, mapSize.y/2};
+            game.flags[0].basePosition = (Vector2){100, mapSize.y/2};
             game.flags[0].isCaptured = false;
             game.flags[0].team = 0;
             strcpy(game.flags[0].carrierId, "");
             
-            game.flags[1].position = (Vector2){SCREEN_WIDTH - 100, SCREEN_HEIGHT/2};
-            game.flags[1].basePosition = (Vector2){SCREEN_WIDTH - 100, SCREEN_HEIGHT/2};
+            game.flags[1].position = (Vector2){mapSize.x - 100, mapSize.y/2};
+            game.flags[1].basePosition = (Vector2){mapSize.x - 100, mapSize.y/2};
             game.flags[1].isCaptured = false;
             game.flags[1].team = 1;
             strcpy(game.flags[1].carrierId, "");
@@ -1542,13 +1694,11 @@ void InitGameMode(GameMode mode)
     }
     
     // Show instructions for the new mode
-    game.showModeInstructions = true;
+    game.modeInstructionTimer = MODE_INSTRUCTION_TIME;
 }
 
-void UpdateGameMode(void)
+void UpdateGameMode(float dt)
 {
-    float dt = GetFrameTime();
-    
     // Update mode timer
     if (game.modeMaxTime > 0) {
         game.modeTimer += dt;
@@ -1603,19 +1753,16 @@ void UpdateGameMode(void)
                         flag->position = carrier->position;
                         
                         // Check if carrier reached their base (opponent's flag at carrier's base)
-                        if (carrier->team != flag->team) {
+                        if (carrier->team != flag->team && HasAuthority()) {
                             float distToBase = Vector2Distance(carrier->position, game.flags[carrier->team].basePosition);
                             if (distToBase < 50) {
-                                // Score a point for carrier's team
-                                game.teamScores[carrier->team]++;
+                                // Scoring happens when the capture event is processed
+                                EmitFlagEvent(EVENT_FLAG_CAPTURE, (int)(carrier - game.players), flagIdx);
                                 
                                 // Reset the flag
                                 flag->position = flag->basePosition;
                                 flag->isCaptured = false;
                                 strcpy(flag->carrierId, "");
-                                
-                                SetStatusMessage("%s team scored a point by capturing the flag!", 
-                                                carrier->team == 0 ? "RED" : "BLUE");
                             }
                         }
                     } else {
@@ -1624,7 +1771,7 @@ void UpdateGameMode(void)
                         flag->isCaptured = false;
                         strcpy(flag->carrierId, "");
                     }
-                } else {
+                } else if (HasAuthority()) {
                     // Check if any player picks up the flag
                     for (int i = 0; i < MAX_PLAYERS; i++) {
                         if (game.players[i].active && game.players[i].team != flag->team) {
@@ -1634,9 +1781,7 @@ void UpdateGameMode(void)
                                 flag->isCaptured = true;
                                 strcpy(flag->carrierId, game.players[i].id);
                                 
-                                SetStatusMessage("%s picked up the %s flag!", 
-                                                game.players[i].id,
-                                                flag->team == 0 ? "RED" : "BLUE");
+                                EmitFlagEvent(EVENT_FLAG_PICKUP, i, flagIdx);
                                 break;
                             }
                         }
@@ -1650,29 +1795,35 @@ void UpdateGameMode(void)
     }
 }
 
-void DrawGameMode(void)
+void DrawGameMode(const RenderSnapshot* view)
 {
-    switch (game.mode) {
+    switch (view->mode) {
         case MODE_CAPTURE_FLAG:
             // Draw flags
             for (int i = 0; i < 2; i++) {
                 Color flagColor = i == 0 ? RED : BLUE;
                 Color baseColor = i == 0 ? (Color){255, 200, 200, 100} : (Color){200, 200, 255, 100};
                 
+                // Skip flags that are off screen along with their base
+                if (!CheckCollisionCircleRec(view->flags[i].basePosition, 50, view->viewBounds) &&
+                    !CheckCollisionCircleRec(view->flags[i].position, 20, view->viewBounds)) {
+                    continue;
+                }
+                
                 // Draw base
-                DrawCircle(game.flags[i].basePosition.x, game.flags[i].basePosition.y, 50, baseColor);
-                DrawCircleLines(game.flags[i].basePosition.x, game.flags[i].basePosition.y, 50, flagColor);
+                DrawCircle(view->flags[i].basePosition.x, view->flags[i].basePosition.y, 50, baseColor);
+                DrawCircleLines(view->flags[i].basePosition.x, view->flags[i].basePosition.y, 50, flagColor);
                 
                 // Draw flag
-                if (!game.flags[i].isCaptured) {
+                if (!view->flags[i].isCaptured) {
                     // Draw flag pole
-                    DrawRectangle(game.flags[i].position.x - 2, game.flags[i].position.y - 20, 4, 40, GRAY);
+                    DrawRectangle(view->flags[i].position.x - 2, view->flags[i].position.y - 20, 4, 40, GRAY);
                     
                     // Draw flag
                     Vector2 flagPoints[3] = {
-                        {game.flags[i].position.x, game.flags[i].position.y - 20},
-                        {game.flags[i].position.x + 20, game.flags[i].position.y - 10},
-                        {game.flags[i].position.x, game.flags[i].position.y}
+                        {view->flags[i].position.x, view->flags[i].position.y - 20},
+                        {view->flags[i].position.x + 20, view->flags[i].position.y - 10},
+                        {view->flags[i].position.x, view->flags[i].position.y}
                     };
                     DrawTriangle(flagPoints[0], flagPoints[1], flagPoints[2], flagColor);
                 }
@@ -0,0 +1,549 @@
+#define _DEFAULT_SOURCE
+
+#include "../include/common.h"
+#include "../include/demo.h"
+#include "../include/core.h"
+#include "../include/network.h"
+#include "../include/player.h"
+#include "../include/snapshot.h"
+#include "../include/events.h"
+#include <stddef.h>
+
+#ifndef _WIN32
+    #define DEMO_WRITER_THREAD 1
+    #define DEMO_MMAP_SUPPORTED 1
+    #include <pthread.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+#endif
+
+// Recording: the simulation appends into one buffer while the writer thread
+// drains the other, so the game never waits on the disk
+static FILE* demoFile = NULL;
+static bool recording = false;
+static unsigned char demoBuffers[2][DEMO_BUFFER_SIZE];
+static unsigned char* fillBuffer = demoBuffers[0];
+static int fillSize = 0;
+static int droppedRecords = 0;
+static unsigned int lastKeyframeTick = 0;
+
+#ifdef DEMO_WRITER_THREAD
+static pthread_mutex_t bufferLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bufferReady = PTHREAD_COND_INITIALIZER;
+static pthread_t writerThread;
+static bool writerRunning = false;
+#endif
+
+// Playback
+typedef struct {
+    unsigned int tick;
+    size_t offset;      // Of the record header
+} DemoKeyframe;
+
+static const unsigned char* demoData = NULL;
+static size_t demoSize = 0;
+static bool demoMapped = false;
+static DemoKeyframe* keyframes = NULL;
+static int keyframeCount = 0;
+static size_t cursor = 0;
+static unsigned int playbackTick = 0;
+static unsigned int firstTick = 0;
+static unsigned int lastTick = 0;
+static bool playing = false;
+static bool paused = false;
+
+// Swap buffers and write out the full one
+static unsigned char* TakeFullBuffer(int* size)
+{
+    unsigned char* full = fillBuffer;
+    *size = fillSize;
+    fillBuffer = full == demoBuffers[0] ? demoBuffers[1] : demoBuffers[0];
+    fillSize = 0;
+    return full;
+}
+
+#ifdef DEMO_WRITER_THREAD
+
+static void* DemoWriterThread(void* arg)
+{
+    (void)arg;
+    
+    pthread_mutex_lock(&bufferLock);
+    while (writerRunning || fillSize > 0) {
+        while (writerRunning && fillSize < DEMO_FLUSH_SIZE) {
+            pthread_cond_wait(&bufferReady, &bufferLock);
+        }
+        
+        int size;
+        unsigned char* full = TakeFullBuffer(&size);
+        
+        // The other buffer keeps filling while this one goes to disk
+        pthread_mutex_unlock(&bufferLock);
+        if (size > 0) {
+            fwrite(full, 1, (size_t)size, demoFile);
+        }
+        pthread_mutex_lock(&bufferLock);
+    }
+    pthread_mutex_unlock(&bufferLock);
+    
+    return NULL;
+}
+
+#endif
+
+static void AppendRecord(DemoRecordType type, const void* payload, int size)
+{
+    DemoRecordHeader header = { (unsigned char)type, 0, (unsigned short)size, game.tick };
+    int total = (int)sizeof(header) + size;
+    
+#ifdef DEMO_WRITER_THREAD
+    pthread_mutex_lock(&bufferLock);
+#endif
+    
+    // Disk can't keep up: lose the record rather than stall the tick
+    if (fillSize + total > DEMO_BUFFER_SIZE) {
+        droppedRecords++;
+    } else {
+        memcpy(fillBuffer + fillSize, &header, sizeof(header));
+        memcpy(fillBuffer + fillSize + sizeof(header), payload, (size_t)size);
+        fillSize += total;
+    }
+    
+#ifdef DEMO_WRITER_THREAD
+    if (fillSize >= DEMO_FLUSH_SIZE) {
+        pthread_cond_signal(&bufferReady);
+    }
+    pthread_mutex_unlock(&bufferLock);
+#else
+    if (fillSize >= DEMO_FLUSH_SIZE) {
+        int fullSize;
+        unsigned char* full = TakeFullBuffer(&fullSize);
+        fwrite(full, 1, (size_t)fullSize, demoFile);
+    }
+#endif
+}
+
+static void RecordKeyframe(void)
+{
+    static unsigned char buffer[SNAPSHOT_MAX_SIZE];
+    int size = EncodeGameState(buffer, sizeof(buffer));
+    if (size > 0) {
+        AppendRecord(DEMO_RECORD_KEYFRAME, buffer, size);
+    }
+    lastKeyframeTick = game.tick;
+}
+
+bool StartDemoRecording(const char* path)
+{
+    if (recording || playing) {
+        return false;
+    }
+    
+    demoFile = fopen(path, "wb");
+    if (!demoFile) {
+        return false;
+    }
+    
+    DemoFileHeader header;
+    memcpy(header.magic, DEMO_MAGIC, 4);
+    header.version = DEMO_VERSION;
+    header.tickRate = TICK_RATE;
+    header.startTick = game.tick;
+    header.snapshotVersion = SNAPSHOT_VERSION;
+    fwrite(&header, sizeof(header), 1, demoFile);
+    
+    fillBuffer = demoBuffers[0];
+    fillSize = 0;
+    droppedRecords = 0;
+    recording = true;
+    
+#ifdef DEMO_WRITER_THREAD
+    writerRunning = true;
+    if (pthread_create(&writerThread, NULL, DemoWriterThread, NULL) != 0) {
+        writerRunning = false;
+        recording = false;
+        fclose(demoFile);
+        demoFile = NULL;
+        return false;
+    }
+#endif
+    
+    // Playback needs a keyframe before the first message
+    RecordKeyframe();
+    return true;
+}
+
+void StopDemoRecording(void)
+{
+    if (!recording) {
+        return;
+    }
+    recording = false;
+    
+#ifdef DEMO_WRITER_THREAD
+    // The writer drains whatever is left before it exits
+    pthread_mutex_lock(&bufferLock);
+    writerRunning = false;
+    pthread_cond_signal(&bufferReady);
+    pthread_mutex_unlock(&bufferLock);
+    pthread_join(writerThread, NULL);
+#else
+    int size;
+    unsigned char* full = TakeFullBuffer(&size);
+    fwrite(full, 1, (size_t)size, demoFile);
+#endif
+    
+    fclose(demoFile);
+    demoFile = NULL;
+    
+    if (droppedRecords > 0) {
+        SetStatusMessage("Demo saved (%d records dropped)", droppedRecords);
+    } else {
+        SetStatusMessage("Demo saved");
+    }
+}
+
+bool IsDemoRecording(void)
+{
+    return recording;
+}
+
+// Gameplay traffic only; link upkeep and state transfer are left out
+void RecordDemoMessage(const NetworkMessage* message)
+{
+    if (!recording) {
+        return;
+    }
+    
+    switch (message->type) {
+        case MSG_PING:
+        case MSG_PONG:
+        case MSG_HEARTBEAT:
+        case MSG_CONNECT_ACCEPT:
+        case MSG_STATE_SNAPSHOT:
+            return;
+        default:
+            break;
+    }
+    
+    AppendRecord(DEMO_RECORD_MESSAGE, message, (int)GetMessageSize(message));
+}
+
+// End of each host tick: the host's own player and periodic keyframes
+void RecordDemoTick(void)
+{
+    if (!recording) {
+        return;
+    }
+    
+    Player* localPlayer = FindPlayer(game.localPlayerId);
+    if (localPlayer && localPlayer->active && game.tick % DEMO_PLAYER_INTERVAL == 0) {
+        NetworkMessage updateMsg;
+        memset(&updateMsg, 0, offsetof(NetworkMessage, data));
+        updateMsg.type = MSG_PLAYER_UPDATE;
+        strcpy(updateMsg.playerId, game.localPlayerId);
+        updateMsg.tick = game.tick;
+        updateMsg.data.player = *localPlayer;
+        RecordDemoMessage(&updateMsg);
+    }
+    
+    if (game.tick - lastKeyframeTick >= DEMO_KEYFRAME_INTERVAL) {
+        RecordKeyframe();
+    }
+}
+
+static bool LoadDemoFile(const char* path)
+{
+#ifdef DEMO_MMAP_SUPPORTED
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    
+    // Records are read in place; seeking only touches the pages it needs
+    void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    
+    demoData = data;
+    demoSize = (size_t)info.st_size;
+    demoMapped = true;
+    return true;
+#else
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    unsigned char* data = size > 0 ? malloc((size_t)size) : NULL;
+    if (!data || fread(data, 1, (size_t)size, file) != (size_t)size) {
+        free(data);
+        fclose(file);
+        return false;
+    }
+    
+    fclose(file);
+    demoData = data;
+    demoSize = (size_t)size;
+    demoMapped = false;
+    return true;
+#endif
+}
+
+static bool ReadRecordHeader(size_t offset, DemoRecordHeader* header)
+{
+    if (offset + sizeof(DemoRecordHeader) > demoSize) {
+        return false;
+    }
+    memcpy(header, demoData + offset, sizeof(DemoRecordHeader));
+    return offset + sizeof(DemoRecordHeader) + header->size <= demoSize;
+}
+
+// One pass over the record headers to find the keyframes and the length
+static bool IndexDemo(void)
+{
+    int capacity = 64;
+    keyframes = malloc(sizeof(DemoKeyframe) * capacity);
+    keyframeCount = 0;
+    if (!keyframes) {
+        return false;
+    }
+    
+    DemoRecordHeader header;
+    size_t offset = sizeof(DemoFileHeader);
+    while (ReadRecordHeader(offset, &header)) {
+        if (header.type == DEMO_RECORD_KEYFRAME) {
+            if (keyframeCount == capacity) {
+                capacity *= 2;
+                DemoKeyframe* grown = realloc(keyframes, sizeof(DemoKeyframe) * capacity);
+                if (!grown) {
+                    return false;
+                }
+                keyframes = grown;
+            }
+            keyframes[keyframeCount].tick = header.tick;
+            keyframes[keyframeCount].offset = offset;
+            keyframeCount++;
+        }
+        lastTick = header.tick;
+        offset += sizeof(DemoRecordHeader) + header.size;
+    }
+    
+    // A truncated tail (recording cut short) is simply ignored
+    demoSize = offset;
+    return keyframeCount > 0;
+}
+
+static void ClearWorld(void)
+{
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        game.players[i].active = false;
+    }
+    for (int i = 0; i < MAX_BULLETS; i++) {
+        game.bullets[i].active = false;
+    }
+    for (int i = 0; i < MAX_PARTICLES; i++) {
+        game.particles[i].active = false;
+    }
+    for (int i = 0; i < MAX_MUZZLE_FLASHES; i++) {
+        game.muzzleFlashes[i].active = false;
+    }
+    for (int i = 0; i < MAX_HIT_EFFECTS; i++) {
+        game.hitEffects[i].active = false;
+    }
+    for (int i = 0; i < MAX_TRACERS; i++) {
+        game.tracers[i].active = false;
+    }
+    game.playerCount = 0;
+    game.bulletCount = 0;
+    game.particleCount = 0;
+    game.muzzleFlashCount = 0;
+    game.hitEffectCount = 0;
+    ClearGameEvents();
+}
+
+// Replace the whole world with the keyframe at offset
+static void RestoreKeyframe(size_t offset)
+{
+    DemoRecordHeader header;
+    ReadRecordHeader(offset, &header);
+    
+    ClearWorld();
+    DecodeGameState(demoData + offset + sizeof(header), header.size);
+    playbackTick = header.tick;
+    cursor = offset + sizeof(header) + header.size;
+}
+
+bool OpenDemo(const char* path)
+{
+    CloseDemo();
+    if (!LoadDemoFile(path)) {
+        return false;
+    }
+    
+    DemoFileHeader header;
+    if (demoSize < sizeof(header)) {
+        CloseDemo();
+        return false;
+    }
+    memcpy(&header, demoData, sizeof(header));
+    if (memcmp(header.magic, DEMO_MAGIC, 4) != 0 || header.version != DEMO_VERSION ||
+        header.tickRate != TICK_RATE || header.snapshotVersion != SNAPSHOT_VERSION || !IndexDemo()) {
+        CloseDemo();
+        return false;
+    }
+    firstTick = keyframes[0].tick;
+    
+    // Nothing here is ours: the recorded players are all driven by the file
+    game.isHost = false;
+    game.isConnected = false;
+    game.state = GAME_PLAYING;
+    playing = true;
+    paused = false;
+    RestoreKeyframe(keyframes[0].offset);
+    
+    SetStatusMessage("Replaying %s (%.0fs)", path, (float)(lastTick - firstTick) / TICK_RATE);
+    return true;
+}
+
+void CloseDemo(void)
+{
+    if (demoData) {
+#ifdef DEMO_MMAP_SUPPORTED
+        if (demoMapped) {
+            munmap((void*)demoData, demoSize);
+        } else {
+            free((void*)demoData);
+        }
+#else
+        free((void*)demoData);
+#endif
+    }
+    free(keyframes);
+    
+    demoData = NULL;
+    demoSize = 0;
+    keyframes = NULL;
+    keyframeCount = 0;
+    playing = false;
+    paused = false;
+}
+
+bool IsDemoPlaying(void)
+{
+    return playing;
+}
+
+bool IsDemoPaused(void)
+{
+    return playing && paused;
+}
+
+// Start of each simulation step: feed this tick's records in place of the network
+void PlayDemoTick(void)
+{
+    if (!playing) {
+        return;
+    }
+    playbackTick++;
+    
+    DemoRecordHeader header;
+    while (ReadRecordHeader(cursor, &header) && header.tick <= playbackTick) {
+        if (header.type == DEMO_RECORD_KEYFRAME) {
+            // Snap back onto the recorded state so drift never builds up
+            RestoreKeyframe(cursor);
+            continue;
+        }
+        
+        NetworkMessage message;
+        memset(&message, 0, sizeof(message));
+        memcpy(&message, demoData + cursor + sizeof(header),
+               header.size < sizeof(message) ? header.size : sizeof(message));
+        cursor += sizeof(header) + header.size;
+        
+        // The handler checks messages came from our host
+        ProcessMessage(&message, &game.serverAddr);
+    }
+    
+    if (cursor >= demoSize && !paused) {
+        paused = true;
+        SetStatusMessage("End of demo");
+    }
+}
+
+void SeekDemo(float seconds)
+{
+    if (!playing) {
+        return;
+    }
+    
+    unsigned int target = firstTick + (unsigned int)(fmaxf(seconds, 0) * TICK_RATE);
+    if (target > lastTick) {
+        target = lastTick;
+    }
+    
+    // Latest keyframe at or before the target
+    int low = 0;
+    int high = keyframeCount - 1;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (keyframes[mid].tick <= target) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    
+    bool wasPaused = paused;
+    RestoreKeyframe(keyframes[low].offset);
+    paused = false;
+    while (playbackTick < target && !paused) {
+        StepSimulation(SIM_DT);
+    }
+    paused = wasPaused && target < lastTick;
+}
+
+// Replay controls, in place of the local player's
+void HandleDemoInput(void)
+{
+    float position = (float)(playbackTick - firstTick) / TICK_RATE;
+    
+    if (IsKeyPressed(KEY_SPACE)) {
+        paused = !paused;
+        if (paused) {
+            SetStatusMessage("Paused at %.1fs", position);
+        }
+    }
+    if (IsKeyPressed(KEY_RIGHT)) {
+        SeekDemo(position + DEMO_SEEK_STEP);
+        SetStatusMessage("Seek to %.1fs", (float)(playbackTick - firstTick) / TICK_RATE);
+    }
+    if (IsKeyPressed(KEY_LEFT)) {
+        SeekDemo(position - DEMO_SEEK_STEP);
+        SetStatusMessage("Seek to %.1fs", (float)(playbackTick - firstTick) / TICK_RATE);
+    }
+    if (IsKeyPressed(KEY_HOME)) {
+        SeekDemo(0);
+    }
+    if (IsKeyPressed(KEY_F4)) {
+        game.showAdvancedStats = !game.showAdvancedStats;
+    }
+    
+    if (IsKeyPressed(KEY_ESCAPE)) {
+        CloseDemo();
+        InitGame();
+    }
+}
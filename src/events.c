@@ -0,0 +1,194 @@
+#include "../include/common.h"
+#include "../include/events.h"
+#include "../include/core.h"
+#include "../include/particles.h"
+#include "../include/network.h"
+#include "../include/weapons.h"
+
+static GameEvent events[MAX_GAME_EVENTS];
+static int eventCount = 0;
+
+void PushGameEvent(const GameEvent* event)
+{
+    // Hundreds of events in one tick means something is already broken;
+    // dropping the excess beats overrunning the queue
+    if (eventCount < MAX_GAME_EVENTS) {
+        events[eventCount++] = *event;
+    }
+}
+
+void EmitHitEvent(int attacker, int victim, int damage, Vector2 position, Vector2 direction)
+{
+    GameEvent event = {
+        .type = EVENT_HIT,
+        .attacker = (signed char)attacker,
+        .victim = (signed char)victim,
+        .damage = (short)damage,
+        .position = position,
+        .direction = direction
+    };
+    PushGameEvent(&event);
+}
+
+void EmitFlagEvent(GameEventType type, int carrier, int team)
+{
+    GameEvent event = {
+        .type = (unsigned char)type,
+        .attacker = (signed char)carrier,
+        .victim = NO_PLAYER,
+        .team = (unsigned char)team,
+        .position = game.flags[team].position
+    };
+    PushGameEvent(&event);
+}
+
+void EmitRespawnEvent(int victim, Vector2 position)
+{
+    GameEvent event = {
+        .type = EVENT_RESPAWN,
+        .attacker = NO_PLAYER,
+        .victim = (signed char)victim,
+        .position = position
+    };
+    PushGameEvent(&event);
+}
+
+static Player* GetEventPlayer(int slot)
+{
+    if (slot < 0 || slot >= MAX_PLAYERS || !game.players[slot].active) {
+        return NULL;
+    }
+    return &game.players[slot];
+}
+
+static void ApplyHitEvent(const GameEvent* event)
+{
+    Player* victim = GetEventPlayer(event->victim);
+    if (!victim) {
+        return;
+    }
+    
+    bool wasAlive = victim->health > 0;
+    victim->health -= event->damage;
+    
+    // Clients don't test bullets against players; the host's hit ends the shot here
+    if (!HasAuthority()) {
+        RetireBulletNear(event->attacker, event->position);
+    }
+    
+    // Vibrant blood splatter
+    CreateBloodSplatter(event->position, event->direction, 30);
+    
+    // Enhanced damage effect
+    if (victim->isLocal && !victim->isBot) {
+        AddDamageFlash((Color){255, 0, 0, 180});
+    }
+    
+    // Death handling itself is in player.c; only the killing blow scores,
+    // and clients get the kill from the host
+    if (victim->health <= 0) {
+        victim->health = 0;
+        if (wasAlive && HasAuthority()) {
+            GameEvent kill = {
+                .type = EVENT_KILL,
+                .attacker = event->attacker,
+                .victim = event->victim,
+                .position = event->position
+            };
+            PushGameEvent(&kill);
+        }
+    }
+}
+
+static void ApplyKillEvent(const GameEvent* event)
+{
+    Player* attacker = GetEventPlayer(event->attacker);
+    Player* victim = GetEventPlayer(event->victim);
+    if (!attacker) {
+        return;
+    }
+    
+    if (game.mode == MODE_DEATHMATCH) {
+        attacker->score++;
+        attacker->kills++;
+        SetStatusMessage("%s eliminated %s (+1 point)", attacker->name, victim ? victim->name : "a player");
+    } else if (game.mode == MODE_TEAM_DEATHMATCH) {
+        game.teamScores[attacker->team]++;
+        attacker->score++;
+    }
+}
+
+static void ApplyRespawnEvent(const GameEvent* event)
+{
+    Player* victim = GetEventPlayer(event->victim);
+    if (!victim) {
+        return;
+    }
+    
+    victim->deaths++;
+    victim->health = victim->maxHealth;
+    
+    // Teleport rather than blend across the map
+    victim->position = event->position;
+    victim->prevPosition = event->position;
+    victim->velocity = (Vector2){0, 0};
+}
+
+static void ApplyFlagEvent(const GameEvent* event)
+{
+    Player* carrier = GetEventPlayer(event->attacker);
+    const char* flagName = event->team == 0 ? "RED" : "BLUE";
+    
+    switch (event->type) {
+        case EVENT_FLAG_PICKUP:
+            SetStatusMessage("%s picked up the %s flag!", carrier ? carrier->name : "Someone", flagName);
+            break;
+        
+        case EVENT_FLAG_DROP:
+            SetStatusMessage("Flag dropped!");
+            break;
+        
+        case EVENT_FLAG_CAPTURE:
+            // The capturing team is the one that doesn't own the flag
+            game.teamScores[event->team == 0 ? 1 : 0]++;
+            SetStatusMessage("%s team scored a point by capturing the flag!", event->team == 0 ? "BLUE" : "RED");
+            break;
+        
+        default:
+            break;
+    }
+}
+
+// Drains the queue; events pushed while draining (kills) run in the same pass
+// and go out to clients with the rest
+void ProcessGameEvents(void)
+{
+    for (int i = 0; i < eventCount; i++) {
+        const GameEvent* event = &events[i];
+        switch (event->type) {
+            case EVENT_HIT:
+                ApplyHitEvent(event);
+                break;
+            
+            case EVENT_KILL:
+                ApplyKillEvent(event);
+                break;
+            
+            case EVENT_RESPAWN:
+                ApplyRespawnEvent(event);
+                break;
+            
+            default:
+                ApplyFlagEvent(event);
+                break;
+        }
+    }
+    
+    SendGameEvents(events, eventCount);
+    eventCount = 0;
+}
+
+void ClearGameEvents(void)
+{
+    eventCount = 0;
+}
@@ -0,0 +1,307 @@
+#include "../include/common.h"
+#include "../include/flowfield.h"
+
+#define FLOW_DIRECTIONS 8
+
+typedef struct {
+    unsigned short* distance;   // Steps to the nearest target
+    signed char* next;          // Direction one step closer, -1 at a target
+    int* source;                // Which target tile that is
+    
+    // The nearest target on another tile, kept only with skipOwnTile: a
+    // field that targets every player has each bot standing on one
+    unsigned short* otherDistance;
+    signed char* otherNext;
+    int* otherSource;
+    bool skipOwnTile;
+    
+    int targets[MAX_PLAYERS];   // Tile indices
+    int targetCount;
+    bool stale;                 // Targets changed since the last build
+} FlowField;
+
+// Orthogonal steps first, so ties go straight rather than diagonal.
+// Opposite directions differ only in the lowest bit
+static const int stepX[FLOW_DIRECTIONS] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+static const int stepY[FLOW_DIRECTIONS] = { 0, 0, 1, -1, 1, -1, -1, 1 };
+
+static FlowField fields[2][FLOW_GOAL_COUNT];
+static int* queue = NULL;
+
+// The map the buffers were sized and built for
+static const void* fieldMap = NULL;
+static int fieldWidth = 0;
+static int fieldHeight = 0;
+
+static bool IsOpenTile(int x, int y)
+{
+    if (x < 0 || y < 0 || x >= game.map.width || y >= game.map.height) {
+        return false;
+    }
+    return game.map.solid[y * game.map.width + x] == 0;
+}
+
+// Diagonals may not cut a wall corner, or bots would snag on it
+static bool CanStep(int x, int y, int direction)
+{
+    int nx = x + stepX[direction];
+    int ny = y + stepY[direction];
+    if (!IsOpenTile(nx, ny)) {
+        return false;
+    }
+    if (direction >= 4) {
+        return IsOpenTile(nx, y) && IsOpenTile(x, ny);
+    }
+    return true;
+}
+
+static int GetTileIndex(Vector2 position)
+{
+    int x = (int)floorf(position.x / game.map.tileSize);
+    int y = (int)floorf(position.y / game.map.tileSize);
+    if (!IsOpenTile(x, y)) {
+        return -1;
+    }
+    return y * game.map.width + x;
+}
+
+static void FreeFieldStorage(void)
+{
+    for (int team = 0; team < 2; team++) {
+        for (int goal = 0; goal < FLOW_GOAL_COUNT; goal++) {
+            FlowField* field = &fields[team][goal];
+            free(field->distance);
+            free(field->next);
+            free(field->source);
+            free(field->otherDistance);
+            free(field->otherNext);
+            free(field->otherSource);
+            field->distance = NULL;
+            field->next = NULL;
+            field->source = NULL;
+            field->otherDistance = NULL;
+            field->otherNext = NULL;
+            field->otherSource = NULL;
+        }
+    }
+    free(queue);
+    queue = NULL;
+    fieldMap = NULL;
+}
+
+// Buffers are sized once per map; a new map invalidates every field
+static bool EnsureFieldStorage(void)
+{
+    if (!game.map.data) {
+        return false;
+    }
+    if (fieldMap == game.map.data && fieldWidth == game.map.width && fieldHeight == game.map.height) {
+        return true;
+    }
+    
+    FreeFieldStorage();
+    size_t tileCount = (size_t)game.map.width * game.map.height;
+    queue = (int*)malloc(tileCount * 2 * sizeof(int));
+    bool allocated = queue != NULL;
+    
+    for (int team = 0; team < 2; team++) {
+        for (int goal = 0; goal < FLOW_GOAL_COUNT; goal++) {
+            FlowField* field = &fields[team][goal];
+            field->distance = (unsigned short*)malloc(tileCount * sizeof(unsigned short));
+            field->next = (signed char*)malloc(tileCount);
+            field->source = (int*)malloc(tileCount * sizeof(int));
+            field->otherDistance = (unsigned short*)malloc(tileCount * sizeof(unsigned short));
+            field->otherNext = (signed char*)malloc(tileCount);
+            field->otherSource = (int*)malloc(tileCount * sizeof(int));
+            allocated = allocated && field->distance && field->next && field->source &&
+                        field->otherDistance && field->otherNext && field->otherSource;
+            field->targetCount = 0;
+            field->stale = true;
+        }
+    }
+    
+    if (!allocated) {
+        FreeFieldStorage();
+        return false;
+    }
+    
+    fieldMap = game.map.data;
+    fieldWidth = game.map.width;
+    fieldHeight = game.map.height;
+    return true;
+}
+
+// Breadth-first from every target at once; each tile remembers the
+// neighbour it was reached from. Queue entries are tile * 2 + layer, where
+// layer 1 is the nearest target other than the one in layer 0
+static void BuildField(FlowField* field)
+{
+    size_t tileCount = (size_t)fieldWidth * fieldHeight;
+    for (size_t i = 0; i < tileCount; i++) {
+        field->distance[i] = FLOW_UNREACHABLE;
+        field->next[i] = -1;
+        field->source[i] = -1;
+        field->otherDistance[i] = FLOW_UNREACHABLE;
+        field->otherNext[i] = -1;
+        field->otherSource[i] = -1;
+    }
+    
+    int head = 0;
+    int tail = 0;
+    for (int i = 0; i < field->targetCount; i++) {
+        int index = field->targets[i];
+        if (field->distance[index] != 0) {
+            field->distance[index] = 0;
+            field->source[index] = index;
+            queue[tail++] = index * 2;
+        }
+    }
+    
+    while (head < tail) {
+        int index = queue[head] / 2;
+        bool other = queue[head] % 2 != 0;
+        head++;
+        int x = index % fieldWidth;
+        int y = index / fieldWidth;
+        unsigned short distance = other ? field->otherDistance[index] : field->distance[index];
+        int source = other ? field->otherSource[index] : field->source[index];
+        
+        for (int direction = 0; direction < FLOW_DIRECTIONS; direction++) {
+            if (!CanStep(x, y, direction)) {
+                continue;
+            }
+            
+            // Steps are symmetric, so the way back is the opposite direction
+            int neighbour = (y + stepY[direction]) * fieldWidth + x + stepX[direction];
+            if (field->distance[neighbour] == FLOW_UNREACHABLE) {
+                field->distance[neighbour] = (unsigned short)(distance + 1);
+                field->next[neighbour] = (signed char)(direction ^ 1);
+                field->source[neighbour] = source;
+                queue[tail++] = neighbour * 2;
+            } else if (field->skipOwnTile && field->source[neighbour] != source &&
+                       field->otherDistance[neighbour] == FLOW_UNREACHABLE) {
+                field->otherDistance[neighbour] = (unsigned short)(distance + 1);
+                field->otherNext[neighbour] = (signed char)(direction ^ 1);
+                field->otherSource[neighbour] = source;
+                queue[tail++] = neighbour * 2 + 1;
+            }
+        }
+    }
+    
+    field->stale = false;
+}
+
+static void AddTarget(int* targets, int* count, Vector2 position)
+{
+    int index = GetTileIndex(position);
+    if (index >= 0 && *count < MAX_PLAYERS) {
+        targets[(*count)++] = index;
+    }
+}
+
+// Marks the field stale if its target tiles differ from last time
+static void SetFieldTargets(FlowField* field, const int* targets, int count, bool skipOwnTile)
+{
+    if (count != field->targetCount || memcmp(targets, field->targets, sizeof(int) * count) != 0 ||
+        skipOwnTile != field->skipOwnTile) {
+        memcpy(field->targets, targets, sizeof(int) * count);
+        field->targetCount = count;
+        field->skipOwnTile = skipOwnTile;
+        field->stale = true;
+    }
+}
+
+static bool IsTeamMode(void)
+{
+    return game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG;
+}
+
+void UpdateFlowFields(void)
+{
+    if (!EnsureFieldStorage()) {
+        return;
+    }
+    
+    // Without teams everyone is an enemy: one field for all, team 0's
+    bool teamMode = IsTeamMode();
+    
+    for (int team = 0; team < 2; team++) {
+        int targets[MAX_PLAYERS];
+        int count = 0;
+        
+        if (teamMode || team == 0) {
+            for (int i = 0; i < MAX_PLAYERS; i++) {
+                const Player* player = &game.players[i];
+                if (player->active && player->health > 0 && (!teamMode || player->team != team)) {
+                    AddTarget(targets, &count, player->position);
+                }
+            }
+            SetFieldTargets(&fields[team][FLOW_ENEMIES], targets, count, !teamMode);
+        }
+        
+        count = 0;
+        AddTarget(targets, &count, game.flags[1 - team].position);
+        SetFieldTargets(&fields[team][FLOW_ENEMY_FLAG], targets, count, false);
+        
+        count = 0;
+        AddTarget(targets, &count, game.flags[team].basePosition);
+        SetFieldTargets(&fields[team][FLOW_HOME], targets, count, false);
+    }
+}
+
+// The field, built if its targets moved since it was last used
+static FlowField* GetField(int team, FlowGoal goal)
+{
+    if (!fieldMap || fieldMap != game.map.data || team < 0 || team > 1 || goal < 0 || goal >= FLOW_GOAL_COUNT) {
+        return NULL;
+    }
+    
+    if (goal == FLOW_ENEMIES && !IsTeamMode()) {
+        team = 0;
+    }
+    
+    FlowField* field = &fields[team][goal];
+    if (field->stale) {
+        BuildField(field);
+    }
+    return field;
+}
+
+Vector2 GetFlowDirection(int team, FlowGoal goal, Vector2 position)
+{
+    FlowField* field = GetField(team, goal);
+    int index = field ? GetTileIndex(position) : -1;
+    if (index < 0) {
+        return (Vector2){0, 0};
+    }
+    
+    // A target underfoot in a field that targets everyone is the asker
+    int direction = field->next[index];
+    if (field->skipOwnTile && field->distance[index] == 0) {
+        direction = field->otherNext[index];
+    }
+    if (direction < 0) {
+        return (Vector2){0, 0};
+    }
+    
+    // Aim for the middle of the next tile so corners are taken wide
+    float tileSize = game.map.tileSize;
+    Vector2 waypoint = {
+        ((index % fieldWidth) + stepX[direction] + 0.5f) * tileSize,
+        ((index / fieldWidth) + stepY[direction] + 0.5f) * tileSize
+    };
+    return Vector2Normalize(Vector2Subtract(waypoint, position));
+}
+
+int GetFlowDistance(int team, FlowGoal goal, Vector2 position)
+{
+    FlowField* field = GetField(team, goal);
+    int index = field ? GetTileIndex(position) : -1;
+    if (index < 0) {
+        return FLOW_UNREACHABLE;
+    }
+    if (field->skipOwnTile && field->distance[index] == 0) {
+        return field->otherDistance[index];
+    }
+    return field->distance[index];
+}
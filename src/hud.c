@@ -0,0 +1,365 @@
+#include "../include/common.h"
+#include "../include/hud.h"
+#include "../include/core.h"
+#include "../include/render.h"
+#include "../include/weapons.h"
+#include "../include/pacing.h"
+
+typedef struct {
+    RenderTexture2D texture;
+    int key[HUD_MAX_KEY];
+    int keyCount;
+    bool loaded;
+} HudWidget;
+
+static HudWidget playerPanel;
+static HudWidget networkPanel;
+static HudWidget namePanel;
+static HudWidget modePanel;
+
+static unsigned int HashText(const char* text)
+{
+    unsigned int hash = 2166136261u;
+    for (int i = 0; text[i]; i++) {
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Starts re-rendering a widget if its key changed. Returns false when the
+// cached texture is still valid and nothing needs drawing.
+static bool BeginHudWidget(HudWidget* widget, int width, int height, const int* key, int keyCount)
+{
+    if (widget->loaded && widget->keyCount == keyCount &&
+        memcmp(widget->key, key, sizeof(int) * keyCount) == 0) {
+        return false;
+    }
+    
+    if (widget->loaded && (widget->texture.texture.width != width || widget->texture.texture.height != height)) {
+        UnloadRenderTexture(widget->texture);
+        widget->loaded = false;
+    }
+    if (!widget->loaded) {
+        widget->texture = LoadRenderTexture(width, height);
+        widget->loaded = widget->texture.id != 0;
+        if (!widget->loaded) {
+            return false;
+        }
+    }
+    
+    memcpy(widget->key, key, sizeof(int) * keyCount);
+    widget->keyCount = keyCount;
+    
+    // Keep alpha straight while compositing into a transparent target, so
+    // the texture comes out premultiplied
+    BeginTextureMode(widget->texture);
+    ClearBackground(BLANK);
+    rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE_MINUS_SRC_ALPHA, RL_FUNC_ADD, RL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+    return true;
+}
+
+static void EndHudWidget(void)
+{
+    EndBlendMode();
+    EndTextureMode();
+}
+
+static void DrawHudWidget(const HudWidget* widget, float x, float y)
+{
+    if (!widget->loaded) {
+        return;
+    }
+    
+    // Render textures come out upside down
+    Texture2D texture = widget->texture.texture;
+    BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+    DrawTextureRec(texture, (Rectangle){0, 0, texture.width, -texture.height}, (Vector2){x, y}, WHITE);
+    EndBlendMode();
+}
+
+// Health, team and weapon panel; drawn relative to (15, 15)
+static void RenderPlayerPanel(const RenderSnapshot* view, const Player* localPlayer, const WeaponStats* stats)
+{
+    // Health bar
+    int healthBarWidth = 200;
+    int healthBarHeight = 20;
+    float healthPercentage = localPlayer->health / localPlayer->maxHealth;
+    
+    DrawRectangle(5, 5, healthBarWidth, healthBarHeight, DARKGRAY);
+    DrawRectangle(5, 5, (int)(healthBarWidth * healthPercentage), healthBarHeight, RED);
+    DrawRectangleLinesEx((Rectangle){5, 5, healthBarWidth, healthBarHeight}, 2, BLACK);
+    
+    char healthText[32];
+    sprintf(healthText, "Health: %.0f/%.0f", localPlayer->health, localPlayer->maxHealth);
+    DrawText(healthText, 10, 5, 16, WHITE);
+    
+    // Team info for team modes
+    if (view->mode == MODE_TEAM_DEATHMATCH || view->mode == MODE_CAPTURE_FLAG) {
+        const char* teamName = localPlayer->team == 0 ? "RED" : "BLUE";
+        Color teamColor = localPlayer->team == 0 ? RED : BLUE;
+        DrawText(teamName, 5, 30, 16, teamColor);
+    }
+    
+    if (!stats || !stats->enabled) {
+        return;
+    }
+    
+    // Weapon panel background
+    Rectangle weaponPanel = {0, 30, 300, 70};
+    DrawRectangleRounded(weaponPanel, 0.2f, 8, (Color){20, 25, 30, 200});
+    DrawRectangleRoundedLines(weaponPanel, 0.2f, 8, (Color){60, 80, 120, 255});
+    
+    // Weapon name with icon
+    const char* weaponIcon = "🔫";
+    switch (stats->style) {
+        case WEAPON_PISTOL: weaponIcon = "🔫"; break;
+        case WEAPON_RIFLE: weaponIcon = "🏹"; break;
+        case WEAPON_SHOTGUN: weaponIcon = "💥"; break;
+        case WEAPON_SMG: weaponIcon = "⚡"; break;
+        case WEAPON_SNIPER: weaponIcon = "🎯"; break;
+        default: break;
+    }
+    
+    char weaponTitle[64];
+    sprintf(weaponTitle, "%s %s", weaponIcon, stats->name);
+    DrawText(weaponTitle, 10, 40, 18, WHITE);
+    
+    // Ammo count with modern styling
+    char ammoText[32];
+    sprintf(ammoText, "%d / %d",
+            localPlayer->magazineAmmo[localPlayer->currentWeapon],
+            localPlayer->ammo[localPlayer->currentWeapon]);
+    DrawText(ammoText, 185, 40, 16, LIGHTGRAY);
+    
+    // Enhanced visual ammo display
+    int maxAmmo = stats->magazineSize;
+    int currentAmmo = localPlayer->magazineAmmo[localPlayer->currentWeapon];
+    float ammoPercentage = maxAmmo > 0 ? (float)currentAmmo / maxAmmo : 0;
+    
+    // Ammo bar background
+    Rectangle ammoBar = {10, 65, 200, 8};
+    DrawRectangleRounded(ammoBar, 0.5f, 8, (Color){40, 40, 40, 200});
+    
+    // Ammo bar fill
+    Color ammoColor = ammoPercentage > 0.5f ? GREEN :
+                     ammoPercentage > 0.2f ? YELLOW : RED;
+    Rectangle ammoFill = {10, 65, 200 * ammoPercentage, 8};
+    DrawRectangleRounded(ammoFill, 0.5f, 8, ammoColor);
+    
+    // Individual bullet indicators for clarity
+    int bulletsToShow = currentAmmo > 20 ? 20 : currentAmmo;
+    for (int i = 0; i < bulletsToShow; i++) {
+        int bulletX = 10 + i * 9;
+        DrawRectangleRounded((Rectangle){bulletX, 80, 6, 12}, 0.3f, 4, YELLOW);
+        DrawRectangleRoundedLines((Rectangle){bulletX, 80, 6, 12}, 0.3f, 4, GOLD);
+    }
+    
+    // Show "..." if more bullets than displayed
+    if (currentAmmo > 20) {
+        DrawText("...", 10 + 20 * 9, 83, 12, YELLOW);
+    }
+}
+
+// Right-aligned FPS and network lines; drawn relative to the top-right corner
+static void DrawRightAligned(const char* text, int width, int y, Color color)
+{
+    DrawText(text, width - MeasureText(text, 20) - 10, y, 20, color);
+}
+
+static void RenderNetworkPanel(const RenderSnapshot* view, int width, int fps)
+{
+    char debugText[128];
+    
+    if (!game.debugMode) {
+        // Just show FPS when not in debug mode
+        sprintf(debugText, "FPS: %d", fps);
+        DrawRightAligned(debugText, width, 10, WHITE);
+        return;
+    }
+    
+    sprintf(debugText, "FPS: %d", fps);
+    DrawRightAligned(debugText, width, 10, LIME);
+    
+    if (!view->isConnected) {
+        return;
+    }
+    
+    sprintf(debugText, "Ping: %.1f ms", view->ping);
+    DrawRightAligned(debugText, width, 35, LIME);
+    
+    sprintf(debugText, "Players: %d", view->playerCount);
+    DrawRightAligned(debugText, width, 60, LIME);
+    
+    sprintf(debugText, "Game Mode: %s", GetGameModeName(view->mode));
+    DrawRightAligned(debugText, width, 85, LIME);
+    
+    if (game.showAdvancedStats) {
+        sprintf(debugText, "Packets Sent: %d", view->packetsSent);
+        DrawRightAligned(debugText, width, 85, LIME);
+        
+        sprintf(debugText, "Packets Received: %d", view->packetsReceived);
+        DrawRightAligned(debugText, width, 110, LIME);
+        
+        sprintf(debugText, "Bullets: %d", view->bulletCount);
+        DrawRightAligned(debugText, width, 135, LIME);
+        
+        sprintf(debugText, "Particles: %d", view->particleCount);
+        DrawRightAligned(debugText, width, 160, LIME);
+        
+        sprintf(debugText, "Tick: %u", view->tick);
+        DrawRightAligned(debugText, width, 185, LIME);
+        
+        float frameMean, frameDeviation;
+        GetFramePacingStats(&frameMean, &frameDeviation);
+        sprintf(debugText, "Frame: %.2f ms +/- %.2f", frameMean, frameDeviation);
+        DrawRightAligned(debugText, width, 210, LIME);
+        
+        if (!view->isHost && view->clock.synced) {
+            sprintf(debugText, "Clock: %+.1f ms, drift %+.0f ppm", view->clock.offset * 1000.0, view->clock.drift * 1e6);
+            DrawRightAligned(debugText, width, 235, LIME);
+        }
+    }
+}
+
+// Mode name, timer and team scores; drawn relative to the top centre
+static void RenderModePanel(const RenderSnapshot* view, int width, int timeRemaining)
+{
+    char modeText[64];
+    sprintf(modeText, "Mode: %s", GetGameModeName(view->mode));
+    DrawText(modeText, width/2 - MeasureText(modeText, 20)/2, 10, 20, WHITE);
+    
+    // Show mode timer if applicable
+    if (timeRemaining >= 0) {
+        int minutes = timeRemaining / 60;
+        int seconds = timeRemaining % 60;
+        char timeText[32];
+        sprintf(timeText, "Time: %02d:%02d", minutes, seconds);
+        DrawText(timeText, width/2 - MeasureText(timeText, 20)/2, 35, 20, WHITE);
+    }
+    
+    // Show team scores for team modes
+    if (view->mode == MODE_TEAM_DEATHMATCH || view->mode == MODE_CAPTURE_FLAG) {
+        char scoreText[64];
+        sprintf(scoreText, "RED %d - %d BLUE", view->teamScores[0], view->teamScores[1]);
+        DrawText(scoreText, width/2 - MeasureText(scoreText, 24)/2, 60, 24, WHITE);
+    }
+}
+
+void DrawHud(const RenderSnapshot* view)
+{
+    const Player* localPlayer = FindViewPlayer(view, view->localPlayerId);
+    bool teamMode = view->mode == MODE_TEAM_DEATHMATCH || view->mode == MODE_CAPTURE_FLAG;
+    
+    if (localPlayer && localPlayer->active) {
+        const WeaponStats* stats = GetViewWeaponStats(view, localPlayer->currentWeapon);
+        int weapon = localPlayer->currentWeapon;
+        int key[] = {
+            (int)roundf(localPlayer->health),
+            (int)roundf(localPlayer->maxHealth),
+            (int)(200 * localPlayer->health / localPlayer->maxHealth),
+            teamMode ? localPlayer->team : -1,
+            weapon,
+            stats && stats->enabled ? stats->magazineSize : -1,
+            stats ? (int)HashText(stats->name) : 0,     // Hot reload can rename or restyle a slot
+            stats ? (int)stats->style : -1,
+            localPlayer->magazineAmmo[weapon],
+            localPlayer->ammo[weapon]
+        };
+        
+        if (BeginHudWidget(&playerPanel, 310, 100, key, sizeof(key) / sizeof(key[0]))) {
+            RenderPlayerPanel(view, localPlayer, stats);
+            EndHudWidget();
+        }
+        DrawHudWidget(&playerPanel, 15, 15);
+        
+        // Reload progress moves every frame, so it stays immediate
+        if (localPlayer->isReloading && stats) {
+            Rectangle reloadPanel = {15, 120, 150, 30};
+            float reloadProgress = 1.0f - (localPlayer->reloadTimer / stats->reloadTime);
+            
+            // Background
+            DrawRectangleRounded(reloadPanel, 0.3f, 8, (Color){60, 60, 20, 200});
+            
+            // Progress bar
+            Rectangle progressBar = {20, 125, 140 * reloadProgress, 20};
+            DrawRectangleRounded(progressBar, 0.3f, 8, ORANGE);
+            
+            // Text
+            DrawText("RELOADING...", 25, 130, 12, WHITE);
+        }
+    }
+    
+    // Network info & FPS counter in corner
+    int networkWidth = 420;
+    int fps = GetFPS();
+    float frameMean, frameDeviation;
+    GetFramePacingStats(&frameMean, &frameDeviation);
+    int networkKey[] = {
+        fps,
+        game.debugMode,
+        game.showAdvancedStats,
+        view->isConnected,
+        view->isHost,
+        (int)(view->ping * 10),
+        view->playerCount,
+        view->mode,
+        game.debugMode && game.showAdvancedStats ? view->packetsSent : 0,
+        game.debugMode && game.showAdvancedStats ? view->packetsReceived : 0,
+        game.debugMode && game.showAdvancedStats ? view->bulletCount : 0,
+        game.debugMode && game.showAdvancedStats ? view->particleCount : 0,
+        game.debugMode && game.showAdvancedStats ? (int)view->tick : 0,
+        view->clock.synced,
+        (int)(view->clock.offset * 10000.0),
+        (int)(view->clock.drift * 1e6),
+        game.debugMode && game.showAdvancedStats ? (int)(frameMean * 100) : 0,
+        game.debugMode && game.showAdvancedStats ? (int)(frameDeviation * 100) : 0
+    };
+    if (BeginHudWidget(&networkPanel, networkWidth, 265, networkKey, sizeof(networkKey) / sizeof(networkKey[0]))) {
+        RenderNetworkPanel(view, networkWidth, fps);
+        EndHudWidget();
+    }
+    DrawHudWidget(&networkPanel, SCREEN_WIDTH - networkWidth, 0);
+    
+    // Show player name
+    if (game.debugMode && view->isConnected) {
+        int nameKey[] = { (int)HashText(game.playerName) };
+        if (BeginHudWidget(&namePanel, networkWidth, 20, nameKey, 1)) {
+            char nameText[64];
+            sprintf(nameText, "Playing as: %s", game.playerName);
+            DrawText(nameText, networkWidth - MeasureText(nameText, 16) - 10, 0, 16, YELLOW);
+            EndHudWidget();
+        }
+        DrawHudWidget(&namePanel, SCREEN_WIDTH - networkWidth, SCREEN_HEIGHT - 25);
+    }
+    
+    // Draw game mode information
+    if (view->state == GAME_PLAYING) {
+        int modeWidth = 600;
+        int timeRemaining = view->modeMaxTime > 0 ? (int)(view->modeMaxTime - view->modeTimer) : -1;
+        int modeKey[] = {
+            view->mode,
+            timeRemaining,
+            teamMode ? view->teamScores[0] : 0,
+            teamMode ? view->teamScores[1] : 0
+        };
+        if (BeginHudWidget(&modePanel, modeWidth, 90, modeKey, sizeof(modeKey) / sizeof(modeKey[0]))) {
+            RenderModePanel(view, modeWidth, timeRemaining);
+            EndHudWidget();
+        }
+        DrawHudWidget(&modePanel, SCREEN_WIDTH/2 - modeWidth/2, 0);
+    }
+}
+
+// Called before the window closes, while the GL context still exists
+void UnloadHud(void)
+{
+    HudWidget* widgets[] = { &playerPanel, &networkPanel, &namePanel, &modePanel };
+    
+    for (int i = 0; i < (int)(sizeof(widgets) / sizeof(widgets[0])); i++) {
+        if (widgets[i]->loaded) {
+            UnloadRenderTexture(widgets[i]->texture);
+            widgets[i]->loaded = false;
+        }
+    }
+}
@@ -0,0 +1,375 @@
+#define _DEFAULT_SOURCE
+
+#include "../include/common.h"
+#include "../include/jobs.h"
+#include <stdint.h>
+
+#ifndef _WIN32
+    #define JOB_THREADS_SUPPORTED 1
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+typedef struct {
+    JobFunction function;
+    void* data;
+    int count;
+    int grain;
+    int prerequisites;      // Unfinished jobs this one still waits for
+    int pendingRanges;      // Ranges handed out but not yet run
+    JobHandle successors[MAX_JOBS];
+    int successorCount;
+} Job;
+
+typedef struct {
+    JobHandle job;
+    int begin;
+    int end;
+} JobRange;
+
+// The owner pushes and pops at the bottom; thieves take from the top, so
+// they get the oldest work and the owner keeps what is warm in its cache
+typedef struct {
+    JobRange ranges[JOB_QUEUE_SIZE];
+    int top;
+    int bottom;
+#ifdef JOB_THREADS_SUPPORTED
+    pthread_mutex_t lock;
+#endif
+} JobQueue;
+
+static Job jobs[MAX_JOBS];
+static int jobCount = 0;
+static int unfinishedJobs = 0;
+
+// Queue 0 belongs to whichever thread is inside RunJobs()
+static JobQueue queues[MAX_JOB_WORKERS + 1];
+static int workerCount = 0;
+
+#ifdef JOB_THREADS_SUPPORTED
+
+static pthread_t workers[MAX_JOB_WORKERS];
+static pthread_mutex_t wakeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeSignal = PTHREAD_COND_INITIALIZER;
+static unsigned int graphGeneration = 0;
+static bool workersRunning = false;
+
+static int AtomicDecrement(int* value)
+{
+    return __atomic_sub_fetch(value, 1, __ATOMIC_ACQ_REL);
+}
+
+static int AtomicLoad(int* value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static void AtomicStore(int* value, int newValue)
+{
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+// Without workers nobody else can touch a queue
+static void LockQueue(JobQueue* queue)
+{
+    if (workerCount > 0) {
+        pthread_mutex_lock(&queue->lock);
+    }
+}
+
+static void UnlockQueue(JobQueue* queue)
+{
+    if (workerCount > 0) {
+        pthread_mutex_unlock(&queue->lock);
+    }
+}
+
+static void YieldThread(void)
+{
+    sched_yield();
+}
+
+#else
+
+// Only the calling thread ever runs jobs here
+
+static int AtomicDecrement(int* value)
+{
+    return --*value;
+}
+
+static int AtomicLoad(int* value)
+{
+    return *value;
+}
+
+static void AtomicStore(int* value, int newValue)
+{
+    *value = newValue;
+}
+
+static void LockQueue(JobQueue* queue)
+{
+    (void)queue;
+}
+
+static void UnlockQueue(JobQueue* queue)
+{
+    (void)queue;
+}
+
+static void YieldThread(void)
+{
+}
+
+#endif
+
+static bool PushRange(JobQueue* queue, JobRange range)
+{
+    LockQueue(queue);
+    bool pushed = queue->bottom - queue->top < JOB_QUEUE_SIZE;
+    if (pushed) {
+        queue->ranges[queue->bottom % JOB_QUEUE_SIZE] = range;
+        queue->bottom++;
+    }
+    UnlockQueue(queue);
+    return pushed;
+}
+
+static bool TakeRange(JobQueue* queue, JobRange* range, bool fromTop)
+{
+    LockQueue(queue);
+    bool taken = queue->bottom > queue->top;
+    if (taken) {
+        if (fromTop) {
+            *range = queue->ranges[queue->top % JOB_QUEUE_SIZE];
+            queue->top++;
+        } else {
+            queue->bottom--;
+            *range = queue->ranges[queue->bottom % JOB_QUEUE_SIZE];
+        }
+    }
+    if (queue->top == queue->bottom) {
+        queue->top = queue->bottom = 0;
+    }
+    UnlockQueue(queue);
+    return taken;
+}
+
+// Own queue first, then steal from the others in turn
+static bool FindRange(int worker, JobRange* range)
+{
+    if (TakeRange(&queues[worker], range, false)) {
+        return true;
+    }
+    for (int i = 1; i <= workerCount; i++) {
+        int victim = (worker + i) % (workerCount + 1);
+        if (TakeRange(&queues[victim], range, true)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void RunRange(int worker, JobRange range);
+
+// Cut a ready job into ranges on the worker's own queue
+static void ScheduleJob(int worker, JobHandle handle)
+{
+    Job* job = &jobs[handle];
+    int rangeCount = job->count > 0 ? (job->count + job->grain - 1) / job->grain : 1;
+    job->pendingRanges = rangeCount;
+    
+    for (int i = 0; i < rangeCount; i++) {
+        int begin = i * job->grain;
+        int end = begin + job->grain < job->count ? begin + job->grain : job->count;
+        JobRange range = { handle, begin, end };
+        if (!PushRange(&queues[worker], range)) {
+            RunRange(worker, range);
+        }
+    }
+}
+
+static void RunRange(int worker, JobRange range)
+{
+    Job* job = &jobs[range.job];
+    job->function(job->data, range.begin, range.end);
+    
+    if (AtomicDecrement(&job->pendingRanges) == 0) {
+        // Release successors before counting this job done, so RunJobs()
+        // can't see zero while work is still being handed out
+        for (int i = 0; i < job->successorCount; i++) {
+            JobHandle successor = job->successors[i];
+            if (AtomicDecrement(&jobs[successor].prerequisites) == 0) {
+                ScheduleJob(worker, successor);
+            }
+        }
+        AtomicDecrement(&unfinishedJobs);
+    }
+}
+
+#ifdef JOB_THREADS_SUPPORTED
+
+// Workers sleep between graphs and only touch the queues while one runs
+static void* JobWorker(void* arg)
+{
+    int worker = (int)(intptr_t)arg;
+    unsigned int seenGeneration = 0;
+    
+    for (;;) {
+        pthread_mutex_lock(&wakeLock);
+        while (workersRunning && graphGeneration == seenGeneration) {
+            pthread_cond_wait(&wakeSignal, &wakeLock);
+        }
+        seenGeneration = graphGeneration;
+        bool running = workersRunning;
+        pthread_mutex_unlock(&wakeLock);
+        if (!running) {
+            break;
+        }
+        
+        // Help until the graph is done, yielding while others hold the work
+        while (AtomicLoad(&unfinishedJobs) > 0) {
+            JobRange range;
+            if (FindRange(worker, &range)) {
+                RunRange(worker, range);
+            } else {
+                YieldThread();
+            }
+        }
+    }
+    
+    return NULL;
+}
+
+static void WakeWorkers(void)
+{
+    pthread_mutex_lock(&wakeLock);
+    graphGeneration++;
+    pthread_cond_broadcast(&wakeSignal);
+    pthread_mutex_unlock(&wakeLock);
+}
+
+void StartJobSystem(void)
+{
+    for (int i = 0; i <= MAX_JOB_WORKERS; i++) {
+        pthread_mutex_init(&queues[i].lock, NULL);
+    }
+    
+    // One core stays with the thread that calls RunJobs()
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int wanted = cores > 1 ? (int)cores - 1 : 0;
+    if (wanted > MAX_JOB_WORKERS) wanted = MAX_JOB_WORKERS;
+    
+    workersRunning = true;
+    while (workerCount < wanted) {
+        if (pthread_create(&workers[workerCount], NULL, JobWorker, (void*)(intptr_t)(workerCount + 1)) != 0) {
+            break;
+        }
+        workerCount++;
+    }
+}
+
+void StopJobSystem(void)
+{
+    pthread_mutex_lock(&wakeLock);
+    workersRunning = false;
+    pthread_cond_broadcast(&wakeSignal);
+    pthread_mutex_unlock(&wakeLock);
+    
+    for (int i = 0; i < workerCount; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    workerCount = 0;
+}
+
+#else
+
+static void WakeWorkers(void)
+{
+}
+
+void StartJobSystem(void)
+{
+}
+
+void StopJobSystem(void)
+{
+}
+
+#endif
+
+int GetJobWorkerCount(void)
+{
+    return workerCount;
+}
+
+JobHandle AddParallelJob(JobFunction function, void* data, int count, int grain)
+{
+    // A full graph can't take more; run it now rather than drop it
+    if (jobCount >= MAX_JOBS) {
+        function(data, 0, count);
+        return -1;
+    }
+    
+    Job* job = &jobs[jobCount];
+    job->function = function;
+    job->data = data;
+    job->count = count;
+    job->grain = grain > 0 ? grain : 1;
+    job->prerequisites = 0;
+    job->pendingRanges = 0;
+    job->successorCount = 0;
+    return jobCount++;
+}
+
+JobHandle AddJob(JobFunction function, void* data)
+{
+    return AddParallelJob(function, data, 1, 1);
+}
+
+void AddJobDependency(JobHandle job, JobHandle prerequisite)
+{
+    if (job < 0 || prerequisite < 0 || job == prerequisite) {
+        return;
+    }
+    
+    Job* before = &jobs[prerequisite];
+    before->successors[before->successorCount++] = job;
+    jobs[job].prerequisites++;
+}
+
+void RunJobs(void)
+{
+    if (jobCount == 0) {
+        return;
+    }
+    
+    // Collect the roots before scheduling any: a root that finishes early
+    // could otherwise release a successor that would then be queued twice
+    JobHandle roots[MAX_JOBS];
+    int rootCount = 0;
+    for (int i = 0; i < jobCount; i++) {
+        if (jobs[i].prerequisites == 0) {
+            roots[rootCount++] = i;
+        }
+    }
+    
+    AtomicStore(&unfinishedJobs, jobCount);
+    for (int i = 0; i < rootCount; i++) {
+        ScheduleJob(0, roots[i]);
+    }
+    WakeWorkers();
+    
+    // The caller works too instead of waiting idle
+    while (AtomicLoad(&unfinishedJobs) > 0) {
+        JobRange range;
+        if (FindRange(0, &range)) {
+            RunRange(0, range);
+        } else {
+            YieldThread();
+        }
+    }
+    
+    jobCount = 0;
+}
@@ -0,0 +1,340 @@
+#define _DEFAULT_SOURCE
+
+#include "../include/common.h"
+#include "../include/listener.h"
+#include "../include/network.h"
+
+#if !defined(_WIN32) && defined(SO_REUSEPORT)
+    #define LISTENER_SHARDING_SUPPORTED 1
+    #include <pthread.h>
+    #include <sys/time.h>
+#endif
+
+#define ROUTE_TABLE_SIZE (MAX_PLAYERS * 4)
+
+// Packet as received by a shard thread
+typedef struct {
+    NetworkMessage message;
+    struct sockaddr_in senderAddr;
+} ReceivedPacket;
+
+// Client address -> shard it was received on
+typedef struct {
+    struct sockaddr_in addr;
+    int shard;
+    bool used;
+} ShardRoute;
+
+static ShardRoute routes[ROUTE_TABLE_SIZE];
+static int shardCount = 0;
+
+static unsigned int HashAddress(struct sockaddr_in* addr)
+{
+    unsigned int h = (unsigned int)addr->sin_addr.s_addr * 2654435761u;
+    return (h ^ addr->sin_port) % ROUTE_TABLE_SIZE;
+}
+
+static bool IsSameAddress(struct sockaddr_in* a, struct sockaddr_in* b)
+{
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+int FindClientShard(struct sockaddr_in* addr)
+{
+    if (shardCount == 0 || !addr) {
+        return -1;
+    }
+    
+    unsigned int slot = HashAddress(addr);
+    for (int i = 0; i < ROUTE_TABLE_SIZE; i++) {
+        ShardRoute* route = &routes[(slot + i) % ROUTE_TABLE_SIZE];
+        if (!route->used) {
+            break;
+        }
+        if (IsSameAddress(&route->addr, addr)) {
+            return route->shard;
+        }
+    }
+    return -1;
+}
+
+// Drop a departed client's route. Later entries in the same probe run are
+// pulled back into the hole so lookups past it still find them
+void ForgetClientRoute(struct sockaddr_in* addr)
+{
+    if (!addr) {
+        return;
+    }
+    
+    unsigned int slot = HashAddress(addr);
+    int hole = -1;
+    for (int i = 0; i < ROUTE_TABLE_SIZE; i++) {
+        int index = (slot + i) % ROUTE_TABLE_SIZE;
+        if (!routes[index].used) {
+            return;
+        }
+        if (IsSameAddress(&routes[index].addr, addr)) {
+            hole = index;
+            break;
+        }
+    }
+    if (hole < 0) {
+        return;
+    }
+    
+    routes[hole].used = false;
+    for (int next = (hole + 1) % ROUTE_TABLE_SIZE; routes[next].used; next = (next + 1) % ROUTE_TABLE_SIZE) {
+        int home = (int)HashAddress(&routes[next].addr);
+        
+        // An entry can't move to before its home slot
+        bool homeInRun = hole < next ? (home > hole && home <= next) : (home > hole || home <= next);
+        if (!homeInRun) {
+            routes[hole] = routes[next];
+            routes[next].used = false;
+            hole = next;
+        }
+    }
+}
+
+int GetListenerShardCount(void)
+{
+    return shardCount;
+}
+
+#ifdef LISTENER_SHARDING_SUPPORTED
+
+// One receive thread and packet queue per socket
+typedef struct {
+    int socket_fd;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    ReceivedPacket queue[SHARD_QUEUE_SIZE];
+    int head;
+    int count;
+    int dropped;
+} ListenerShard;
+
+static ListenerShard shards[MAX_LISTENER_SHARDS];
+static volatile bool shardsRunning = false;
+
+static void RecordRoute(struct sockaddr_in* addr, int shard)
+{
+    unsigned int slot = HashAddress(addr);
+    for (int i = 0; i < ROUTE_TABLE_SIZE; i++) {
+        ShardRoute* route = &routes[(slot + i) % ROUTE_TABLE_SIZE];
+        if (!route->used || IsSameAddress(&route->addr, addr)) {
+            route->addr = *addr;
+            route->shard = shard;
+            route->used = true;
+            return;
+        }
+    }
+    
+    // Full of stray senders: take the home slot. Every packet records its
+    // route again, so whoever was evicted gets theirs back on the next one
+    ShardRoute* route = &routes[slot];
+    route->addr = *addr;
+    route->shard = shard;
+}
+
+static void* ShardReceiveThread(void* arg)
+{
+    ListenerShard* shard = (ListenerShard*)arg;
+    ReceivedPacket packet;
+    
+    while (shardsRunning) {
+        socklen_t addrLen = sizeof(packet.senderAddr);
+        int bytesReceived = recvfrom(shard->socket_fd, &packet.message, sizeof(packet.message), 0,
+                                     (struct sockaddr*)&packet.senderAddr, &addrLen);
+        
+        // Timeouts wake us up so shutdown can be noticed
+        if (bytesReceived <= 0) {
+            continue;
+        }
+        
+        // Drop runt packets before they reach the game thread
+        if (bytesReceived < (int)sizeof(MessageType) + (int)sizeof(packet.message.playerId)) {
+            continue;
+        }
+        
+        pthread_mutex_lock(&shard->lock);
+        if (shard->count < SHARD_QUEUE_SIZE) {
+            shard->queue[(shard->head + shard->count) % SHARD_QUEUE_SIZE] = packet;
+            shard->count++;
+        } else {
+            shard->dropped++;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+    
+    return NULL;
+}
+
+static int OpenShardSocket(int port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    int enable = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+        close(fd);
+        return -1;
+    }
+    
+    // Short receive timeout so the thread can exit on shutdown
+    struct timeval timeout = {0, 100000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+    
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    
+    return fd;
+}
+
+int StartListenerShards(int port, int count)
+{
+    StopListenerShards();
+    
+    if (count < 1) count = 1;
+    if (count > MAX_LISTENER_SHARDS) count = MAX_LISTENER_SHARDS;
+    
+    // Bind every socket before starting any threads
+    for (int i = 0; i < count; i++) {
+        shards[i].socket_fd = OpenShardSocket(port);
+        if (shards[i].socket_fd < 0) {
+            for (int j = 0; j < i; j++) {
+                close(shards[j].socket_fd);
+            }
+            return -1;
+        }
+        shards[i].head = 0;
+        shards[i].count = 0;
+        shards[i].dropped = 0;
+        pthread_mutex_init(&shards[i].lock, NULL);
+    }
+    
+    memset(routes, 0, sizeof(routes));
+    shardsRunning = true;
+    
+    // A socket nobody drains would swallow its clients' packets, so a shard
+    // whose thread won't start is closed along with every one after it
+    int started = 0;
+    while (started < count && pthread_create(&shards[started].thread, NULL, ShardReceiveThread, &shards[started]) == 0) {
+        started++;
+    }
+    for (int i = started; i < count; i++) {
+        close(shards[i].socket_fd);
+        pthread_mutex_destroy(&shards[i].lock);
+    }
+    
+    shardCount = started;
+    if (started == 0) {
+        shardsRunning = false;
+        return -1;
+    }
+    return started;
+}
+
+void StopListenerShards(void)
+{
+    if (shardCount == 0) {
+        return;
+    }
+    
+    shardsRunning = false;
+    for (int i = 0; i < shardCount; i++) {
+        pthread_join(shards[i].thread, NULL);
+        close(shards[i].socket_fd);
+        pthread_mutex_destroy(&shards[i].lock);
+    }
+    
+    shardCount = 0;
+}
+
+int DrainListenerShards(void)
+{
+    static ReceivedPacket batch[SHARD_QUEUE_SIZE];
+    int processed = 0;
+    
+    for (int i = 0; i < shardCount; i++) {
+        ListenerShard* shard = &shards[i];
+        
+        // Copy the queue out so the receive thread is never blocked on game logic
+        pthread_mutex_lock(&shard->lock);
+        int count = shard->count;
+        for (int j = 0; j < count; j++) {
+            batch[j] = shard->queue[(shard->head + j) % SHARD_QUEUE_SIZE];
+        }
+        shard->head = (shard->head + count) % SHARD_QUEUE_SIZE;
+        shard->count = 0;
+        pthread_mutex_unlock(&shard->lock);
+        
+        for (int j = 0; j < count; j++) {
+            RecordRoute(&batch[j].senderAddr, i);
+            ProcessMessage(&batch[j].message, &batch[j].senderAddr);
+            game.packetsReceived++;
+        }
+        processed += count;
+    }
+    
+    return processed;
+}
+
+int GetListenerSocket(int shard)
+{
+    if (shard < 0 || shard >= shardCount) {
+        return -1;
+    }
+    return shards[shard].socket_fd;
+}
+
+int GetDefaultShardCount(void)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    if (cores > DEFAULT_LISTENER_SHARDS) cores = DEFAULT_LISTENER_SHARDS;
+    return (int)cores;
+}
+
+#else
+
+// No SO_REUSEPORT on this platform: the host keeps its single socket
+
+int StartListenerShards(int port, int count)
+{
+    (void)port;
+    (void)count;
+    return -1;
+}
+
+void StopListenerShards(void)
+{
+}
+
+int DrainListenerShards(void)
+{
+    return 0;
+}
+
+int GetListenerSocket(int shard)
+{
+    (void)shard;
+    return -1;
+}
+
+int GetDefaultShardCount(void)
+{
+    return 1;
+}
+
+#endif
@@ -1,11 +1,20 @@
 #include "../include/common.h"
 #include "../include/core.h"
+#include "../include/bots.h"
+#include "../include/demo.h"
 #include "../include/network.h"
+#include "../include/pacing.h"
+#include "../include/quality.h"
+#include "../include/render.h"
+#include "../include/hud.h"
+#include "../include/jobs.h"
+#include "../include/simulation.h"
+#include "../include/sprites.h"
 
 // Global game instance
 Game game;
 
-int main(void)
+int main(int argc, char** argv)
 {
 #ifdef _WIN32
     // Initialize Winsock for Windows
@@ -17,21 +26,52 @@ int main(void)
 #endif
 
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Layla - 2D Multiplayer Shooter (C/raylib)");
-    SetTargetFPS(0); // Uncapped FPS for maximum performance
+    SetTargetFPS(0); // PaceFrame() does the limiting
     
     InitGame();
     
+    // layla --replay <file.dem> plays a recorded match instead of the menu;
+    // layla --bots <n> keeps hosted and offline games topped up to n players
+    if (argc > 2 && strcmp(argv[1], "--replay") == 0 && !OpenDemo(argv[2])) {
+        SetStatusMessage("Could not open demo %s", argv[2]);
+    } else if (argc > 2 && strcmp(argv[1], "--bots") == 0) {
+        SetBotFill(atoi(argv[2]));
+    }
+    
+    StartJobSystem();
+    StartSimulation();
+    
+    double lastFrameStart = GetTime();
     while (!WindowShouldClose())
     {
-        UpdateGame();
+        double frameStart = GetTime();
+        float frameDelta = (float)(frameStart - lastFrameStart);
+        lastFrameStart = frameStart;
+        UpdateFrameInput();
+        
+        // Draw the newest published state; the simulation keeps running meanwhile
+        const RenderSnapshot* view = AcquireRenderSnapshot();
         
         BeginDrawing();
         ClearBackground(DARKGRAY);
-        DrawGame();
+        DrawGame(view);
+        
+        // Time spent building the frame, not waiting on vsync
+        bool inGame = view->state == GAME_PLAYING;
+        UpdateEffectQuality((float)(GetTime() - frameStart), frameDelta, GetPacingTargetFPS(inGame));
         EndDrawing();
+        
+        PaceFrame(inGame);
     }
     
+    StopSimulation();
+    StopJobSystem();
+    StopDemoRecording();
+    CloseDemo();
     CloseNetwork();
+    UnloadGameBackground();
+    UnloadPlayerSprites();
+    UnloadHud();
     CloseWindow();
     
 #ifdef _WIN32
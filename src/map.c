@@ -0,0 +1,443 @@
+#define _DEFAULT_SOURCE
+
+#include "../include/common.h"
+#include "../include/map.h"
+#include "../include/rng.h"
+
+#ifndef _WIN32
+    #define MAP_MMAP_SUPPORTED 1
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+#endif
+
+#define MAX_MAP_DIMENSION 1024
+
+// Built-in arena (left half; the right half mirrors it)
+static const char* arenaHalfRows[] = {
+    "########################",
+    "#.......................",
+    "#.......................",
+    "#.......######..........",
+    "#.......#...............",
+    "#.......#...............",
+    "#...................##..",
+    "#...................##..",
+    "#....##.................",
+    "#....##.................",
+    "#.........#.............",
+    "#.........#.............",
+    "#.........#.............",
+    "#.......................",
+    "#.........#.............",
+    "#.........#.............",
+    "#.........#.............",
+    "#....##.................",
+    "#....##.................",
+    "#...................##..",
+    "#...................##..",
+    "#.......#...............",
+    "#.......#...............",
+    "#.......######..........",
+    "#.......................",
+    "#.......................",
+    "########################"
+};
+
+// Outside the map counts as wall
+static bool IsSolidTile(int x, int y)
+{
+    if (x < 0 || y < 0 || x >= game.map.width || y >= game.map.height) {
+        return true;
+    }
+    return game.map.solid[y * game.map.width + x] != 0;
+}
+
+// Validate a file image and point the map at it; takes ownership on success
+static bool AttachMapImage(const void* data, size_t size, bool mapped)
+{
+    const MapFileHeader* header = (const MapFileHeader*)data;
+    if (size < sizeof(MapFileHeader) || memcmp(header->magic, MAP_MAGIC, 4) != 0 || header->version != MAP_VERSION) {
+        return false;
+    }
+    
+    size_t tileCount = (size_t)header->width * header->height;
+    if (header->width == 0 || header->height == 0 ||
+        header->width > MAX_MAP_DIMENSION || header->height > MAX_MAP_DIMENSION || header->tileSize == 0 ||
+        header->solidOffset + tileCount > size || header->distanceOffset + tileCount > size) {
+        return false;
+    }
+    
+    UnloadMap();
+    
+    const unsigned char* bytes = (const unsigned char*)data;
+    game.map.width = (int)header->width;
+    game.map.height = (int)header->height;
+    game.map.tileSize = (float)header->tileSize;
+    game.map.solid = bytes + header->solidOffset;
+    game.map.distance = bytes + header->distanceOffset;
+    game.map.data = data;
+    game.map.dataSize = size;
+    game.map.mapped = mapped;
+    return true;
+}
+
+bool LoadMap(const char* path)
+{
+#ifdef MAP_MMAP_SUPPORTED
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    
+    // The grids are used straight from the page cache
+    void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    
+    if (!AttachMapImage(data, (size_t)info.st_size, true)) {
+        munmap(data, (size_t)info.st_size);
+        return false;
+    }
+    return true;
+#else
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    void* data = size > 0 ? malloc((size_t)size) : NULL;
+    if (!data || fread(data, 1, (size_t)size, file) != (size_t)size || !AttachMapImage(data, (size_t)size, false)) {
+        free(data);
+        fclose(file);
+        return false;
+    }
+    
+    fclose(file);
+    return true;
+#endif
+}
+
+// Build a map image from text rows ('#' = wall), computing the distance grid
+bool LoadMapFromRows(const char** rows, int width, int height)
+{
+    if (width <= 0 || height <= 0 || width > MAX_MAP_DIMENSION || height > MAX_MAP_DIMENSION) {
+        return false;
+    }
+    
+    size_t tileCount = (size_t)width * height;
+    size_t size = sizeof(MapFileHeader) + tileCount * 2;
+    unsigned char* data = (unsigned char*)malloc(size);
+    int* queue = (int*)malloc(tileCount * sizeof(int));
+    if (!data || !queue) {
+        free(data);
+        free(queue);
+        return false;
+    }
+    
+    MapFileHeader* header = (MapFileHeader*)data;
+    memcpy(header->magic, MAP_MAGIC, 4);
+    header->version = MAP_VERSION;
+    header->width = (unsigned int)width;
+    header->height = (unsigned int)height;
+    header->tileSize = (unsigned int)TILE_SIZE;
+    header->solidOffset = sizeof(MapFileHeader);
+    header->distanceOffset = (unsigned int)(sizeof(MapFileHeader) + tileCount);
+    
+    unsigned char* solid = data + header->solidOffset;
+    unsigned char* distance = data + header->distanceOffset;
+    
+    // Walls seed the search; open tiles start at their distance to the map edge
+    int head = 0;
+    int tail = 0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int index = y * width + x;
+            solid[index] = rows[y][x] == '#';
+            if (solid[index]) {
+                distance[index] = 0;
+                queue[tail++] = index;
+            } else {
+                int edge = x + 1;
+                if (y + 1 < edge) edge = y + 1;
+                if (width - x < edge) edge = width - x;
+                if (height - y < edge) edge = height - y;
+                distance[index] = (unsigned char)(edge > 255 ? 255 : edge);
+            }
+        }
+    }
+    
+    // Breadth-first over 8 neighbours gives the exact Chebyshev distance
+    while (head < tail) {
+        int index = queue[head++];
+        int x = index % width;
+        int y = index / width;
+        int next = distance[index] + 1;
+        if (next > 255) {
+            continue;
+        }
+        
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                int nx = x + dx;
+                int ny = y + dy;
+                if (nx < 0 || ny < 0 || nx >= width || ny >= height) {
+                    continue;
+                }
+                int neighbour = ny * width + nx;
+                if (distance[neighbour] > next) {
+                    distance[neighbour] = (unsigned char)next;
+                    queue[tail++] = neighbour;
+                }
+            }
+        }
+    }
+    
+    free(queue);
+    
+    if (!AttachMapImage(data, size, false)) {
+        free(data);
+        return false;
+    }
+    return true;
+}
+
+bool SaveMap(const char* path)
+{
+    if (!game.map.data) {
+        return false;
+    }
+    
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    
+    bool written = fwrite(game.map.data, 1, game.map.dataSize, file) == game.map.dataSize;
+    fclose(file);
+    return written;
+}
+
+void UnloadMap(void)
+{
+    if (!game.map.data) {
+        return;
+    }
+    
+#ifdef MAP_MMAP_SUPPORTED
+    if (game.map.mapped) {
+        munmap((void*)game.map.data, game.map.dataSize);
+    } else {
+        free((void*)game.map.data);
+    }
+#else
+    free((void*)game.map.data);
+#endif
+    
+    memset(&game.map, 0, sizeof(Map));
+}
+
+// The arena file if present, otherwise the built-in layout
+// The map file when there is one, the built-in arena otherwise
+void LoadArenaMap(void)
+{
+    if (!LoadMap(DEFAULT_MAP_PATH)) {
+        BuildArenaMap();
+    }
+}
+
+// Mirrors the left half of the arena into a full map
+bool BuildArenaMap(void)
+{
+    int height = (int)(sizeof(arenaHalfRows) / sizeof(arenaHalfRows[0]));
+    int half = (int)strlen(arenaHalfRows[0]);
+    static char rowBuffer[sizeof(arenaHalfRows) / sizeof(arenaHalfRows[0])][64];
+    const char* rows[sizeof(arenaHalfRows) / sizeof(arenaHalfRows[0])];
+    
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < half; x++) {
+            rowBuffer[y][x] = arenaHalfRows[y][x];
+            rowBuffer[y][half * 2 - 1 - x] = arenaHalfRows[y][x];
+        }
+        rowBuffer[y][half * 2] = '\0';
+        rows[y] = rowBuffer[y];
+    }
+    
+    return LoadMapFromRows(rows, half * 2, height);
+}
+
+bool IsWallAt(Vector2 position)
+{
+    if (!game.map.data) {
+        return false;
+    }
+    return IsSolidTile((int)floorf(position.x / game.map.tileSize), (int)floorf(position.y / game.map.tileSize));
+}
+
+// Lower bound on the distance from a point to any wall
+float GetWallClearance(Vector2 position)
+{
+    if (!game.map.data) {
+        return 1e9f;
+    }
+    
+    int x = (int)floorf(position.x / game.map.tileSize);
+    int y = (int)floorf(position.y / game.map.tileSize);
+    if (IsSolidTile(x, y)) {
+        return 0;
+    }
+    
+    // Every tile closer than the nearest wall tile is open
+    int tiles = game.map.distance[y * game.map.width + x];
+    return (float)(tiles - 1) * game.map.tileSize;
+}
+
+// Grid DDA along the segment; reports the first wall crossed
+bool MapRaycast(Vector2 from, Vector2 to, Vector2* hitPoint, Vector2* hitNormal)
+{
+    if (!game.map.data) {
+        return false;
+    }
+    
+    float tileSize = game.map.tileSize;
+    Vector2 dir = Vector2Subtract(to, from);
+    int x = (int)floorf(from.x / tileSize);
+    int y = (int)floorf(from.y / tileSize);
+    
+    if (IsSolidTile(x, y)) {
+        if (hitPoint) *hitPoint = from;
+        if (hitNormal) *hitNormal = Vector2Normalize(Vector2Negate(dir));
+        return true;
+    }
+    
+    int stepX = dir.x > 0 ? 1 : -1;
+    int stepY = dir.y > 0 ? 1 : -1;
+    float tDeltaX = dir.x != 0 ? tileSize / fabsf(dir.x) : 1e30f;
+    float tDeltaY = dir.y != 0 ? tileSize / fabsf(dir.y) : 1e30f;
+    float tMaxX = dir.x > 0 ? ((x + 1) * tileSize - from.x) / dir.x :
+                  dir.x < 0 ? (from.x - x * tileSize) / -dir.x : 1e30f;
+    float tMaxY = dir.y > 0 ? ((y + 1) * tileSize - from.y) / dir.y :
+                  dir.y < 0 ? (from.y - y * tileSize) / -dir.y : 1e30f;
+    
+    for (int i = 0; i < game.map.width + game.map.height + 2; i++) {
+        float t;
+        Vector2 normal;
+        if (tMaxX < tMaxY) {
+            t = tMaxX;
+            tMaxX += tDeltaX;
+            x += stepX;
+            normal = (Vector2){ (float)-stepX, 0 };
+        } else {
+            t = tMaxY;
+            tMaxY += tDeltaY;
+            y += stepY;
+            normal = (Vector2){ 0, (float)-stepY };
+        }
+        
+        if (t > 1.0f) {
+            break;
+        }
+        
+        if (IsSolidTile(x, y)) {
+            if (hitPoint) *hitPoint = Vector2Add(from, Vector2Scale(dir, t));
+            if (hitNormal) *hitNormal = normal;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// Move a circle and push it back out of any wall it ends up overlapping
+Vector2 MoveCircle(Vector2 position, Vector2 delta, float radius)
+{
+    Vector2 result = Vector2Add(position, delta);
+    if (!game.map.data || GetWallClearance(position) >= radius + Vector2Length(delta)) {
+        return result;
+    }
+    
+    float tileSize = game.map.tileSize;
+    for (int pass = 0; pass < 2; pass++) {
+        int minX = (int)floorf((result.x - radius) / tileSize);
+        int maxX = (int)floorf((result.x + radius) / tileSize);
+        int minY = (int)floorf((result.y - radius) / tileSize);
+        int maxY = (int)floorf((result.y + radius) / tileSize);
+        
+        for (int y = minY; y <= maxY; y++) {
+            for (int x = minX; x <= maxX; x++) {
+                if (!IsSolidTile(x, y)) {
+                    continue;
+                }
+                
+                Vector2 closest = {
+                    Clamp(result.x, x * tileSize, (x + 1) * tileSize),
+                    Clamp(result.y, y * tileSize, (y + 1) * tileSize)
+                };
+                Vector2 away = Vector2Subtract(result, closest);
+                float distance = Vector2Length(away);
+                
+                if (distance >= radius) {
+                    continue;
+                }
+                if (distance > 0.0001f) {
+                    result = Vector2Add(result, Vector2Scale(away, (radius - distance) / distance));
+                } else {
+                    // Centre ended up inside the wall: back out the way we came
+                    result = position;
+                }
+            }
+        }
+    }
+    
+    return result;
+}
+
+// Random open spot between minX and maxX with room for a player
+Vector2 FindSpawnPoint(float minX, float maxX)
+{
+    Vector2 size = GetMapSize();
+    
+    for (int attempt = 0; attempt < 32; attempt++) {
+        Vector2 position = {
+            RandomRange(RNG_GAMEPLAY, minX, maxX),
+            RandomRange(RNG_GAMEPLAY, PLAYER_SIZE, size.y - PLAYER_SIZE)
+        };
+        if (GetWallClearance(position) >= PLAYER_SIZE) {
+            return position;
+        }
+    }
+    
+    // Crowded map: first open tile in range
+    if (game.map.data) {
+        for (int y = 0; y < game.map.height; y++) {
+            for (int x = 0; x < game.map.width; x++) {
+                Vector2 center = { (x + 0.5f) * game.map.tileSize, (y + 0.5f) * game.map.tileSize };
+                if (center.x >= minX && center.x <= maxX && !IsSolidTile(x, y)) {
+                    return center;
+                }
+            }
+        }
+    }
+    
+    return (Vector2){ size.x / 2, size.y / 2 };
+}
+
+Vector2 GetMapSize(void)
+{
+    if (!game.map.data) {
+        return (Vector2){ SCREEN_WIDTH, SCREEN_HEIGHT };
+    }
+    return (Vector2){ game.map.width * game.map.tileSize, game.map.height * game.map.tileSize };
+}
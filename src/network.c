@@ -3,10 +3,18 @@
 #include "../include/player.h"
 #include "../include/weapons.h"
 #include "../include/core.h"
+#include "../include/listener.h"
+#include "../include/timesync.h"
+#include "../include/snapshot.h"
+#include "../include/rng.h"
+#include "../include/demo.h"
+#include "../include/visibility.h"
 #include <errno.h>
 #include <string.h>
 #include <time.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
 
 // Platform-specific includes
 #ifdef _WIN32
@@ -18,38 +26,162 @@
     #include <unistd.h>
 #endif
 
+// Bytes on the wire for one player update, what the send budget is spent in
+#define PLAYER_UPDATE_SIZE (offsetof(NetworkMessage, data) + sizeof(Player))
+
+// Host: recent events by sequence, kept for resending until acked
+static NetworkEvent eventLog[EVENT_LOG_SIZE];
+
+static void RemoveSession(ClientSession* session);
+
+static void InitLinkStats(LinkStats* link)
+{
+    memset(link, 0, sizeof(LinkStats));
+    link->sendBudget = LINK_START_BUDGET;
+    link->sendInterval = SEND_INTERVAL_MIN;
+}
+
+// Count gaps in the peer's sequence numbers to estimate loss on its packets
+static void TrackReceivedSequence(LinkStats* link, unsigned short sequence)
+{
+    short advance = (short)(sequence - link->recvSequence);
+    if (link->recvExpected == 0 && link->recvCount == 0) {
+        advance = 1;
+    }
+    
+    // Late or duplicate packets count as received but don't move the window
+    if (advance > 0) {
+        link->recvExpected += advance;
+        link->recvSequence = sequence;
+    }
+    link->recvCount++;
+    
+    if (link->recvExpected >= LINK_LOSS_WINDOW) {
+        float loss = 1.0f - (float)link->recvCount / (float)link->recvExpected;
+        if (loss < 0) loss = 0;
+        link->measuredLoss = link->measuredLoss * 0.5f + loss * 0.5f;
+        link->recvCount = 0;
+        link->recvExpected = 0;
+    }
+}
+
+// AIMD on the send budget: back off on loss or queueing delay, probe upward otherwise
+static void UpdateLinkEstimate(LinkStats* link, float rttSample, float reportedLoss)
+{
+    link->rtt = link->rtt > 0 ? link->rtt * 0.875f + rttSample * 0.125f : rttSample;
+    if (link->minRtt <= 0 || rttSample < link->minRtt) {
+        link->minRtt = rttSample;
+    }
+    link->lossRate = link->lossRate * 0.75f + reportedLoss * 0.25f;
+    
+    bool congested = link->lossRate > LINK_LOSS_THRESHOLD || link->rtt > link->minRtt * 1.5f + 20.0f;
+    if (congested) {
+        link->sendBudget *= 0.7f;
+    } else {
+        link->sendBudget += LINK_BUDGET_STEP;
+    }
+    
+    if (link->sendBudget < LINK_MIN_BUDGET) link->sendBudget = LINK_MIN_BUDGET;
+    if (link->sendBudget > LINK_MAX_BUDGET) link->sendBudget = LINK_MAX_BUDGET;
+}
+
+// Fastest snapshot rate at which a snapshot of this size fits the budget
+static float ChooseSendInterval(LinkStats* link, int snapshotMessages)
+{
+    if (snapshotMessages < 1) snapshotMessages = 1;
+    float interval = (float)(snapshotMessages * PLAYER_UPDATE_SIZE) / link->sendBudget;
+    if (interval < SEND_INTERVAL_MIN) interval = SEND_INTERVAL_MIN;
+    if (interval > SEND_INTERVAL_MAX) interval = SEND_INTERVAL_MAX;
+    return interval;
+}
+
+// Header plus the part of the union this message type uses
+size_t GetMessageSize(const NetworkMessage* message)
+{
+    size_t header = offsetof(NetworkMessage, data);
+    
+    switch (message->type) {
+        case MSG_PLAYER_JOIN:
+        case MSG_PLAYER_UPDATE:
+            return PLAYER_UPDATE_SIZE;
+        case MSG_PLAYER_SHOOT:
+            return offsetof(NetworkMessage, data.shot.angles) + sizeof(float) * message->data.shot.pelletCount;
+        case MSG_PING:
+        case MSG_PONG:
+            return header + sizeof(message->data.pingInfo);
+        case MSG_CONNECT_ACCEPT:
+        case MSG_EVENT_ACK:
+            return header + sizeof(unsigned int);
+        case MSG_GAME_MODE:
+            return header + sizeof(GameMode);
+        case MSG_GAME_EVENTS:
+            return offsetof(NetworkMessage, data.events.list) + sizeof(NetworkEvent) * message->data.events.count;
+        case MSG_STATE_SNAPSHOT:
+            return offsetof(NetworkMessage, data.snapshot.bytes) + message->data.snapshot.fragmentSize;
+        case MSG_FLAG_UPDATE:
+            return offsetof(NetworkMessage, data.flagIndex) + sizeof(message->data.flagIndex);
+        case MSG_CHAT:
+            return offsetof(NetworkMessage, data.senderName) + sizeof(message->data.senderName);
+        case MSG_PLAYER_LEAVE:
+        case MSG_HEARTBEAT:
+            return header;
+    }
+    
+    // No default above, so -Wswitch names any type added without a size here;
+    // anything else is a corrupt type and isn't sent at all
+    assert(!"message type without a wire size");
+    return 0;
+}
+
+static LinkStats* GetPeerLink(struct sockaddr_in* addr)
+{
+    if (!game.isHost) {
+        return &game.serverLink;
+    }
+    ClientSession* session = FindSession(addr);
+    return session ? &session->link : NULL;
+}
+
 int StartHost(int port)
 {
     // Close existing socket if it's open
     if (game.socket_fd >= 0) {
         close(game.socket_fd);
+        game.socket_fd = -1;
     }
     
-    // Create UDP socket
-    game.socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (game.socket_fd < 0) {
-        return -1;
-    }
-    
-    // Set socket to non-blocking
-    int flags = fcntl(game.socket_fd, F_GETFL, 0);
-    fcntl(game.socket_fd, F_SETFL, flags | O_NONBLOCK);
-    
     // Initialize server address
     memset(&game.serverAddr, 0, sizeof(game.serverAddr));
     game.serverAddr.sin_family = AF_INET;
     game.serverAddr.sin_port = htons(port);
     game.serverAddr.sin_addr.s_addr = INADDR_ANY;
     
-    // Bind socket to port
-    if (bind(game.socket_fd, (struct sockaddr*)&game.serverAddr, sizeof(game.serverAddr)) < 0) {
-        close(game.socket_fd);
-        game.socket_fd = -1;
-        return -1;
+    // Prefer one SO_REUSEPORT socket per receive thread; shard 0 doubles as the send socket
+    if (game.listenerShards > 1 && StartListenerShards(port, game.listenerShards) > 0) {
+        game.socket_fd = GetListenerSocket(0);
+    } else {
+        // Create UDP socket
+        game.socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (game.socket_fd < 0) {
+            return -1;
+        }
+        
+        // Set socket to non-blocking
+        int flags = fcntl(game.socket_fd, F_GETFL, 0);
+        fcntl(game.socket_fd, F_SETFL, flags | O_NONBLOCK);
+        
+        // Bind socket to port
+        if (bind(game.socket_fd, (struct sockaddr*)&game.serverAddr, sizeof(game.serverAddr)) < 0) {
+            close(game.socket_fd);
+            game.socket_fd = -1;
+            return -1;
+        }
     }
     
-    // Initialize client list
+    // Initialize session table
+    memset(game.sessions, 0, sizeof(game.sessions));
     game.clientCount = 0;
+    game.connectionId = 0;
     game.hostPort = port;
     
     // Reset packet counters
@@ -99,6 +231,13 @@ int ConnectToServer(const char* ip, int port)
     strcpy(game.joinIP, ip);
     game.joinPort = port;
     
+    // Not accepted yet; the host assigns our connection id
+    game.connectionId = 0;
+    game.lastServerHeardTime = GetTime();
+    InitLinkStats(&game.serverLink);
+    ResetClockSync();
+    game.hasInitialState = false;
+    
     // Reset packet counters
     game.packetsSent = 0;
     game.packetsReceived = 0;
@@ -114,19 +253,15 @@ void CloseNetwork(void)
             NetworkMessage leaveMsg;
             leaveMsg.type = MSG_PLAYER_LEAVE;
             strcpy(leaveMsg.playerId, game.localPlayerId);
-            
-            if (game.isHost) {
-                // Send to all clients
-                for (int i = 0; i < game.clientCount; i++) {
-                    SendMessage(&leaveMsg, &game.clientAddrs[i]);
-                }
-            } else {
-                // Send to server
-                SendMessage(&leaveMsg, &game.serverAddr);
-            }
+            SendToPeers(&leaveMsg);
         }
         
-        close(game.socket_fd);
+        // Sharded listeners own their sockets, including socket_fd
+        if (GetListenerShardCount() > 0) {
+            StopListenerShards();
+        } else {
+            close(game.socket_fd);
+        }
         game.socket_fd = -1;
     }
     
@@ -134,7 +269,7 @@ void CloseNetwork(void)
     game.isHost = false;
 }
 
-void UpdateNetwork(void)
+void UpdateNetwork(float dt)
 {
     if (!game.isConnected || game.socket_fd < 0) {
         return;
@@ -146,18 +281,46 @@ void UpdateNetwork(void)
     static float reconnectTimer = 0;
     static float gameModeTimer = 0;
     static float flagUpdateTimer = 0;
+    static float joinRetryTimer = 0;
     static int failedPackets = 0;
     
-    float dt = GetFrameTime();
     updateTimer += dt;
     pingTimer += dt;
     reconnectTimer += dt;
     gameModeTimer += dt;
     flagUpdateTimer += dt;
+    joinRetryTimer += dt;
     
-    // Send player updates every 33ms (30Hz) for smoother gameplay
-    if (updateTimer >= 0.033f) {
+    if (game.isHost) {
+        // Drop clients that stopped talking to us
+        UpdateSessions();
+    } else {
+        // Host went silent: forget our session and start joining again
+        if (game.connectionId != 0 && GetTime() - game.lastServerHeardTime > SESSION_TIMEOUT) {
+            game.connectionId = 0;
+            game.hasInitialState = false;
+            SetStatusMessage("Lost connection to host, rejoining...");
+        }
+        
+        // Keep asking until the host accepts us and its state snapshot got through
+        if ((game.connectionId == 0 || !game.hasInitialState) && joinRetryTimer >= HEARTBEAT_INTERVAL) {
+            joinRetryTimer = 0;
+            SendJoinRequest();
+        }
+    }
+    
+    if (game.isHost) {
+        // Host's own player changes every frame; each client gets snapshots at its own rate
+        Player* localPlayer = FindPlayer(game.localPlayerId);
+        if (localPlayer && localPlayer->active) {
+            MarkPlayerDirty((int)(localPlayer - game.players), NULL);
+        }
+        SendSessionSnapshots(dt);
+        ResendGameEvents(dt);
+    } else if (updateTimer >= game.serverLink.sendInterval) {
+        // Client uplink: 30Hz unless the link to the host is congested
         updateTimer = 0;
+        game.serverLink.sendInterval = ChooseSendInterval(&game.serverLink, 1);
         
         Player* localPlayer = FindPlayer(game.localPlayerId);
         if (localPlayer && localPlayer->active) {
@@ -165,66 +328,46 @@ void UpdateNetwork(void)
             updateMsg.type = MSG_PLAYER_UPDATE;
             strcpy(updateMsg.playerId, game.localPlayerId);
             updateMsg.data.player = *localPlayer;
-            
-            if (game.isHost) {
-                // Send to all clients
-                for (int i = 0; i < game.clientCount; i++) {
-                    SendMessage(&updateMsg, &game.clientAddrs[i]);
-                }
-            } else {
-                // Send to server
-                SendMessage(&updateMsg, &game.serverAddr);
-            }
+            SendToPeers(&updateMsg);
         }
     }
     
-    // Send ping every 1 second
+    // Send ping every 1 second; the pong drives each link's RTT and budget
     if (pingTimer >= 1.0f) {
         pingTimer = 0;
         
         NetworkMessage pingMsg;
         pingMsg.type = MSG_PING;
         strcpy(pingMsg.playerId, game.localPlayerId);
-        pingMsg.data.ping = 0;
-        
-        game.pingStartTime = GetTime();
+        pingMsg.data.pingInfo.sentTime = GetTime();
         
         if (game.isHost) {
-            // Send to all clients
-            for (int i = 0; i < game.clientCount; i++) {
-                SendMessage(&pingMsg, &game.clientAddrs[i]);
+            for (int i = 0; i < MAX_PLAYERS; i++) {
+                if (game.sessions[i].active) {
+                    pingMsg.data.pingInfo.lossRate = game.sessions[i].link.measuredLoss;
+                    SendMessage(&pingMsg, &game.sessions[i].addr);
+                }
             }
         } else {
-            // Send to server
+            pingMsg.data.pingInfo.lossRate = game.serverLink.measuredLoss;
             SendMessage(&pingMsg, &game.serverAddr);
         }
     }
     
-    // Send game mode updates periodically (only if host)
+    // Send game mode updates periodically (only if host); scores travel as
+    // kill and capture events instead
     if (game.isHost && gameModeTimer >= 5.0f) {
         gameModeTimer = 0;
         
-        // Send current game mode
         NetworkMessage modeMsg;
         modeMsg.type = MSG_GAME_MODE;
         strcpy(modeMsg.playerId, game.localPlayerId);
         modeMsg.data.gameMode = game.mode;
-        
-        // Send team scores
-        NetworkMessage scoreMsg;
-        scoreMsg.type = MSG_TEAM_SCORE;
-        strcpy(scoreMsg.playerId, game.localPlayerId);
-        scoreMsg.data.teamScores[0] = game.teamScores[0];
-        scoreMsg.data.teamScores[1] = game.teamScores[1];
-        
-        for (int i = 0; i < game.clientCount; i++) {
-            SendMessage(&modeMsg, &game.clientAddrs[i]);
-            SendMessage(&scoreMsg, &game.clientAddrs[i]);
-        }
+        BroadcastMessage(&modeMsg, NULL);
     }
     
-    // Send flag updates for Capture the Flag mode
-    if (game.mode == MODE_CAPTURE_FLAG && flagUpdateTimer >= 0.5f) {
+    // Send flag updates for Capture the Flag mode; the host owns flag state
+    if (game.isHost && game.mode == MODE_CAPTURE_FLAG && flagUpdateTimer >= 0.5f) {
         flagUpdateTimer = 0;
         
         // Send flag states
@@ -234,17 +377,24 @@ void UpdateNetwork(void)
             strcpy(flagMsg.playerId, game.localPlayerId);
             flagMsg.data.flag = game.flags[i];
             flagMsg.data.flagIndex = i;
-            
-            if (game.isHost) {
-                for (int j = 0; j < game.clientCount; j++) {
-                    SendMessage(&flagMsg, &game.clientAddrs[j]);
-                }
-            } else {
-                SendMessage(&flagMsg, &game.serverAddr);
-            }
+            BroadcastMessage(&flagMsg, NULL);
         }
     }
     
+    // Keep the session alive when nothing else went out recently
+    if (GetTime() - game.lastSendTime >= HEARTBEAT_INTERVAL) {
+        NetworkMessage heartbeatMsg;
+        heartbeatMsg.type = MSG_HEARTBEAT;
+        strcpy(heartbeatMsg.playerId, game.localPlayerId);
+        SendToPeers(&heartbeatMsg);
+    }
+    
+    // Sharded hosts receive on worker threads; just process what they queued
+    if (GetListenerShardCount() > 0) {
+        DrainListenerShards();
+        return;
+    }
+    
     // Receive messages
     struct sockaddr_in senderAddr;
     socklen_t senderAddrLen = sizeof(senderAddr);
@@ -286,14 +436,7 @@ void UpdateNetwork(void)
                             failedPackets = 0;
                             
                             // Resend join message
-                            NetworkMessage joinMsg;
-                            joinMsg.type = MSG_PLAYER_JOIN;
-                            strcpy(joinMsg.playerId, game.localPlayerId);
-                            Player* localPlayer = FindPlayer(game.localPlayerId);
-                            if (localPlayer) {
-                                joinMsg.data.player = *localPlayer;
-                                SendMessage(&joinMsg, &game.serverAddr);
-                            }
+                            SendJoinRequest();
                         }
                     }
                 }
@@ -314,11 +457,357 @@ void SendMessage(NetworkMessage* message, struct sockaddr_in* destAddr)
         return;
     }
     
-    // Send the message
-    sendto(game.socket_fd, message, sizeof(NetworkMessage), 0,
+    // Reply to a client on the shard socket it arrived on
+    int fd = game.socket_fd;
+    int shard = FindClientShard(destAddr);
+    if (shard >= 0) {
+        fd = GetListenerSocket(shard);
+    }
+    
+    // Stamp our connection id so the host can match us to a session
+    message->connectionId = game.connectionId;
+    
+    // Per-link sequence lets the receiver measure loss
+    LinkStats* link = GetPeerLink(destAddr);
+    message->sequence = link ? link->sendSequence++ : 0;
+    message->tick = game.tick;
+    
+    // Send only the header and the payload this message type uses
+    size_t size = GetMessageSize(message);
+    if (size == 0) {
+        return;
+    }
+    sendto(fd, message, size, 0,
            (struct sockaddr*)destAddr, sizeof(struct sockaddr_in));
     
     game.packetsSent++;
+    game.lastSendTime = GetTime();
+}
+
+void BroadcastMessage(NetworkMessage* message, struct sockaddr_in* exceptAddr)
+{
+    // Everything the host tells its clients is part of the match record
+    RecordDemoMessage(message);
+    
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ClientSession* session = &game.sessions[i];
+        if (!session->active) {
+            continue;
+        }
+        if (exceptAddr && session->addr.sin_addr.s_addr == exceptAddr->sin_addr.s_addr &&
+            session->addr.sin_port == exceptAddr->sin_port) {
+            continue;
+        }
+        SendMessage(message, &session->addr);
+    }
+}
+
+void SendToPeers(NetworkMessage* message)
+{
+    if (game.isHost) {
+        // Send to all clients
+        BroadcastMessage(message, NULL);
+    } else {
+        // Send to server
+        SendMessage(message, &game.serverAddr);
+    }
+}
+
+bool HasAuthority(void)
+{
+    // A replay only shows what the recording host decided
+    if (IsDemoPlaying()) {
+        return false;
+    }
+    return game.isHost || !game.isConnected;
+}
+
+// Host only: one tick's events, batched into as few messages as fit and
+// logged until every client acks them
+void SendGameEvents(const GameEvent* events, int count)
+{
+    if (!game.isHost || !game.isConnected || count == 0) {
+        return;
+    }
+    
+    // A client this far behind has stopped acking; it rejoins and gets a fresh snapshot
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ClientSession* session = &game.sessions[i];
+        if (session->active && game.eventSequence + count - session->eventAck > EVENT_LOG_SIZE) {
+            SetStatusMessage("Player %s stopped acking events", session->playerId);
+            RemoveSession(session);
+        }
+    }
+    
+    NetworkMessage eventsMsg;
+    eventsMsg.type = MSG_GAME_EVENTS;
+    strcpy(eventsMsg.playerId, game.localPlayerId);
+    eventsMsg.data.events.firstSequence = game.eventSequence;
+    eventsMsg.data.events.count = 0;
+    
+    for (int i = 0; i < count; i++) {
+        const GameEvent* event = &events[i];
+        NetworkEvent* wire = &eventLog[game.eventSequence++ % EVENT_LOG_SIZE];
+        wire->type = event->type;
+        wire->team = event->team;
+        wire->damage = event->damage;
+        wire->position = event->position;
+        wire->direction = event->direction;
+        snprintf(wire->attackerId, sizeof(wire->attackerId), "%s",
+                 event->attacker >= 0 ? game.players[event->attacker].id : "");
+        snprintf(wire->victimId, sizeof(wire->victimId), "%s",
+                 event->victim >= 0 ? game.players[event->victim].id : "");
+        eventsMsg.data.events.list[eventsMsg.data.events.count++] = *wire;
+        
+        if (eventsMsg.data.events.count == MAX_NETWORK_EVENTS || i == count - 1) {
+            BroadcastMessage(&eventsMsg, NULL);
+            eventsMsg.data.events.firstSequence = game.eventSequence;
+            eventsMsg.data.events.count = 0;
+        }
+    }
+}
+
+// Host only: once a client's ack is overdue, send its unacked events again,
+// oldest first
+void ResendGameEvents(float dt)
+{
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ClientSession* session = &game.sessions[i];
+        if (!session->active) {
+            continue;
+        }
+        if (session->eventAck == game.eventSequence) {
+            session->eventResendTimer = 0;
+            continue;
+        }
+        
+        // Give the ack a round trip and a half (rtt is in ms) to arrive
+        session->eventResendTimer += dt;
+        if (session->eventResendTimer < fmaxf(EVENT_RESEND_INTERVAL, session->link.rtt * 0.0015f)) {
+            continue;
+        }
+        session->eventResendTimer = 0;
+        
+        NetworkMessage eventsMsg;
+        eventsMsg.type = MSG_GAME_EVENTS;
+        strcpy(eventsMsg.playerId, game.localPlayerId);
+        
+        unsigned int sequence = session->eventAck;
+        for (int m = 0; m < EVENT_RESEND_MESSAGES && sequence != game.eventSequence; m++) {
+            eventsMsg.data.events.firstSequence = sequence;
+            eventsMsg.data.events.count = 0;
+            while (eventsMsg.data.events.count < MAX_NETWORK_EVENTS && sequence != game.eventSequence) {
+                eventsMsg.data.events.list[eventsMsg.data.events.count++] = eventLog[sequence++ % EVENT_LOG_SIZE];
+            }
+            SendMessage(&eventsMsg, &session->addr);
+        }
+    }
+}
+
+// Slot of the player with this id here, or NO_PLAYER
+static int FindEventPlayer(const char* playerId)
+{
+    if (playerId[0] == '\0') {
+        return NO_PLAYER;
+    }
+    Player* player = FindPlayer(playerId);
+    return player ? (int)(player - game.players) : NO_PLAYER;
+}
+
+void SendJoinRequest(void)
+{
+    Player* localPlayer = FindPlayer(game.localPlayerId);
+    if (!localPlayer) {
+        return;
+    }
+    
+    NetworkMessage joinMsg;
+    joinMsg.type = MSG_PLAYER_JOIN;
+    strcpy(joinMsg.playerId, game.localPlayerId);
+    joinMsg.data.player = *localPlayer;
+    SendMessage(&joinMsg, &game.serverAddr);
+}
+
+ClientSession* FindSession(struct sockaddr_in* addr)
+{
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ClientSession* session = &game.sessions[i];
+        if (session->active && session->addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+            session->addr.sin_port == addr->sin_port) {
+            return session;
+        }
+    }
+    return NULL;
+}
+
+// A session that joins again must use the id it joined with, and a new
+// peer can't take an id another session speaks for
+static bool CanClaimPlayerId(ClientSession* session, const char* playerId)
+{
+    if (session) {
+        return strcmp(session->playerId, playerId) == 0;
+    }
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (game.sessions[i].active && strcmp(game.sessions[i].playerId, playerId) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Host: a client may only speak for the player its session joined as
+static bool IsSenderPlayer(struct sockaddr_in* senderAddr, const char* playerId)
+{
+    ClientSession* session = FindSession(senderAddr);
+    return session && strcmp(session->playerId, playerId) == 0;
+}
+
+static ClientSession* CreateSession(struct sockaddr_in* addr, const char* playerId)
+{
+    // Reuse the first free slot
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ClientSession* session = &game.sessions[i];
+        if (!session->active) {
+            session->addr = *addr;
+            strcpy(session->playerId, playerId);
+            session->lastHeardTime = GetTime();
+            session->active = true;
+            
+            // Everything is news to a fresh client
+            InitLinkStats(&session->link);
+            session->dirtyPlayers = ~0u;
+            memset(session->lastSentTime, 0, sizeof(session->lastSentTime));
+            
+            // Its snapshot already covers every event sent so far
+            session->eventAck = game.eventSequence;
+            session->eventResendTimer = 0;
+            
+            // Never hand out 0, which means "not accepted"
+            do {
+                session->connectionId = RandomUInt(RNG_SYSTEM);
+            } while (session->connectionId == 0);
+            
+            game.clientCount++;
+            return session;
+        }
+    }
+    return NULL;
+}
+
+static void RemoveSession(ClientSession* session)
+{
+    // Tell everyone else the player is gone
+    NetworkMessage leaveMsg;
+    leaveMsg.type = MSG_PLAYER_LEAVE;
+    strcpy(leaveMsg.playerId, session->playerId);
+    
+    session->active = false;
+    game.clientCount--;
+    ForgetClientRoute(&session->addr);
+    
+    RemovePlayer(leaveMsg.playerId);
+    BroadcastMessage(&leaveMsg, NULL);
+}
+
+void MarkPlayerDirty(int slot, ClientSession* except)
+{
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (game.sessions[i].active && &game.sessions[i] != except) {
+            game.sessions[i].dirtyPlayers |= 1u << slot;
+        }
+    }
+}
+
+void SendSessionSnapshots(float dt)
+{
+    double now = GetTime();
+    
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ClientSession* session = &game.sessions[i];
+        if (!session->active) {
+            continue;
+        }
+        
+        session->link.sendTimer += dt;
+        if (session->link.sendTimer < session->link.sendInterval) {
+            continue;
+        }
+        session->link.sendTimer = 0;
+        
+        // Rank the players this client hasn't seen the latest state of:
+        // stale and nearby players first
+        Player* viewer = FindPlayer(session->playerId);
+        int candidates[MAX_PLAYERS];
+        float priorities[MAX_PLAYERS];
+        int candidateCount = 0;
+        int otherPlayers = 0;
+        
+        for (int slot = 0; slot < MAX_PLAYERS; slot++) {
+            Player* player = &game.players[slot];
+            if (!player->active || strcmp(player->id, session->playerId) == 0) {
+                session->dirtyPlayers &= ~(1u << slot);
+                continue;
+            }
+            otherPlayers++;
+            
+            if (!(session->dirtyPlayers & (1u << slot))) {
+                continue;
+            }
+            
+            // Enemies the client can't see only need the odd refresh for the
+            // scoreboard; they stay dirty until then
+            float staleness = (float)(now - session->lastSentTime[slot]);
+            if (viewer && staleness < HIDDEN_PLAYER_INTERVAL && !AreTeammates(viewer, player) &&
+                !IsInSight((int)(viewer - game.players), slot)) {
+                continue;
+            }
+            
+            float distance = viewer ? Vector2Distance(viewer->position, player->position) : 0;
+            float priority = staleness / (1.0f + distance / PRIORITY_DISTANCE_SCALE);
+            
+            // Insertion sort, highest priority first
+            int insertAt = candidateCount;
+            while (insertAt > 0 && priorities[insertAt - 1] < priority) {
+                candidates[insertAt] = candidates[insertAt - 1];
+                priorities[insertAt] = priorities[insertAt - 1];
+                insertAt--;
+            }
+            candidates[insertAt] = slot;
+            priorities[insertAt] = priority;
+            candidateCount++;
+        }
+        
+        // Spend this snapshot's share of the budget; the rest waits and gains priority
+        int maxMessages = (int)(session->link.sendBudget * session->link.sendInterval / PLAYER_UPDATE_SIZE);
+        if (maxMessages < 1) maxMessages = 1;
+        
+        for (int c = 0; c < candidateCount && c < maxMessages; c++) {
+            int slot = candidates[c];
+            NetworkMessage updateMsg;
+            updateMsg.type = MSG_PLAYER_UPDATE;
+            strcpy(updateMsg.playerId, game.players[slot].id);
+            updateMsg.data.player = game.players[slot];
+            SendMessage(&updateMsg, &session->addr);
+            
+            session->dirtyPlayers &= ~(1u << slot);
+            session->lastSentTime[slot] = now;
+        }
+        
+        session->link.sendInterval = ChooseSendInterval(&session->link, otherPlayers);
+    }
+}
+
+void UpdateSessions(void)
+{
+    double now = GetTime();
+    
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ClientSession* session = &game.sessions[i];
+        if (session->active && now - session->lastHeardTime > SESSION_TIMEOUT) {
+            SetStatusMessage("Player %s timed out", session->playerId);
+            RemoveSession(session);
+        }
+    }
 }
 
 void ProcessMessage(NetworkMessage* message, struct sockaddr_in* senderAddr)
@@ -340,69 +829,95 @@ void ProcessMessage(NetworkMessage* message, struct sockaddr_in* senderAddr)
     GameMode receivedMode;
     Flag receivedFlag;
     
+    if (game.isHost) {
+        // Only joins may come from unknown peers; everything else needs a live session
+        ClientSession* session = FindSession(senderAddr);
+        if (!session) {
+            if (message->type != MSG_PLAYER_JOIN) {
+                return;
+            }
+        } else if (message->type != MSG_PLAYER_JOIN) {
+            if (message->connectionId != session->connectionId) {
+                return;
+            }
+        }
+        
+        if (session) {
+            session->lastHeardTime = GetTime();
+            TrackReceivedSequence(&session->link, message->sequence);
+        }
+    } else {
+        // Clients only listen to their host
+        if (senderAddr->sin_addr.s_addr != game.serverAddr.sin_addr.s_addr ||
+            senderAddr->sin_port != game.serverAddr.sin_port) {
+            return;
+        }
+        game.lastServerHeardTime = GetTime();
+        TrackReceivedSequence(&game.serverLink, message->sequence);
+    }
+    
     switch (message->type) {
         case MSG_PLAYER_JOIN: {
-            // Add the player
-            Player* player = CreatePlayer(message->playerId, message->data.player.name, false);
+            if (game.isHost && !CanClaimPlayerId(FindSession(senderAddr), message->playerId)) {
+                break;
+            }
+            
+            // Nobody gets to overwrite a player simulated here: our own or a bot
+            Player* existing = FindPlayer(message->playerId);
+            if (existing && existing->isLocal) {
+                break;
+            }
+            
+            Player* player = existing;
+            if (existing && game.isHost) {
+                // A retried join: health, score and position stay as simulated here
+                snprintf(existing->name, sizeof(existing->name), "%s", message->data.player.name);
+            } else {
+                // Add the player
+                player = CreatePlayer(message->playerId, message->data.player.name, false);
+                if (player) {
+                    Player spawned = *player;
+                    *player = message->data.player;
+                    player->isLocal = false;
+                    player->active = true;
+                    
+                    // A newcomer picks its look and spawn point, but not its stats
+                    if (game.isHost) {
+                        player->health = spawned.health;
+                        player->maxHealth = spawned.maxHealth;
+                        player->score = spawned.score;
+                        player->kills = spawned.kills;
+                        player->deaths = spawned.deaths;
+                    }
+                }
+            }
             
             if (player) {
-                // Copy player data
-                *player = message->data.player;
-                player->isLocal = false;
-                player->active = true;
-                
-                // If we're the host, add the client to our list
+                // If we're the host, open (or refresh) the client's session
                 if (game.isHost) {
-                    bool clientExists = false;
-                    for (int i = 0; i < game.clientCount; i++) {
-                        if (game.clientAddrs[i].sin_addr.s_addr == senderAddr->sin_addr.s_addr &&
-                            game.clientAddrs[i].sin_port == senderAddr->sin_port) {
-                            clientExists = true;
-                            break;
-                        }
+                    ClientSession* session = FindSession(senderAddr);
+                    bool newSession = false;
+                    if (!session) {
+                        session = CreateSession(senderAddr, message->playerId);
+                        newSession = true;
                     }
                     
-                    if (!clientExists && game.clientCount < MAX_PLAYERS) {
-                        game.clientAddrs[game.clientCount] = *senderAddr;
-                        game.clientCount++;
+                    if (session) {
+                        // Handshake reply carrying the client's connection id
+                        NetworkMessage acceptMsg;
+                        acceptMsg.type = MSG_CONNECT_ACCEPT;
+                        strcpy(acceptMsg.playerId, game.localPlayerId);
+                        acceptMsg.data.assignedConnectionId = session->connectionId;
+                        SendMessage(&acceptMsg, senderAddr);
                         
-                        // Send all existing players to the new client
-                        for (int i = 0; i < MAX_PLAYERS; i++) {
-                            if (game.players[i].active && strcmp(game.players[i].id, message->playerId) != 0) {
-                                NetworkMessage playerMsg;
-                                playerMsg.type = MSG_PLAYER_JOIN;
-                                strcpy(playerMsg.playerId, game.players[i].id);
-                                playerMsg.data.player = game.players[i];
-                                SendMessage(&playerMsg, senderAddr);
-                            }
-                        }
-                    
-                        // Send current game mode to the new client
-                        NetworkMessage modeMsg;
-                        modeMsg.type = MSG_GAME_MODE;
-                        strcpy(modeMsg.playerId, game.localPlayerId);
-                        modeMsg.data.gameMode = game.mode;
-                        SendMessage(&modeMsg, senderAddr);
-                    
-                        // Send team scores to the new client
-                        NetworkMessage scoreMsg;
-                        scoreMsg.type = MSG_TEAM_SCORE;
-                        strcpy(scoreMsg.playerId, game.localPlayerId);
-                        scoreMsg.data.teamScores[0] = game.teamScores[0];
-                        scoreMsg.data.teamScores[1] = game.teamScores[1];
-                        SendMessage(&scoreMsg, senderAddr);
-                    
-                        // If it's capture the flag mode, send flag states
-                        if (game.mode == MODE_CAPTURE_FLAG) {
-                            for (int i = 0; i < 2; i++) {
-                                NetworkMessage flagMsg;
-                                flagMsg.type = MSG_FLAG_UPDATE;
-                                strcpy(flagMsg.playerId, game.localPlayerId);
-                                flagMsg.data.flag = game.flags[i];
-                                flagMsg.data.flagIndex = i;
-                                SendMessage(&flagMsg, senderAddr);
-                            }
+                        // Announce the newcomer to everyone else, as the host has it
+                        if (newSession) {
+                            message->data.player = *player;
+                            BroadcastMessage(message, senderAddr);
                         }
+                        
+                        // Bring the new client up to date: players, bullets, mode, scores and flags
+                        SendStateSnapshot(senderAddr);
                     }
                 }
                 
@@ -412,56 +927,76 @@ void ProcessMessage(NetworkMessage* message, struct sockaddr_in* senderAddr)
         }
             
         case MSG_PLAYER_LEAVE: {
-            // Remove the player
-            RemovePlayer(message->playerId);
+            if (game.isHost && !IsSenderPlayer(senderAddr, message->playerId)) {
+                break;
+            }
+            
+            // Remove the player; the host also closes the session and tells the others
+            ClientSession* session = game.isHost ? FindSession(senderAddr) : NULL;
+            if (session) {
+                RemoveSession(session);
+            } else {
+                RemovePlayer(message->playerId);
+            }
             SetStatusMessage("Player %s left", message->playerId);
             break;
         }
             
         case MSG_PLAYER_UPDATE: {
+            if (game.isHost && !IsSenderPlayer(senderAddr, message->playerId)) {
+                break;
+            }
+            
             // Update player
             Player* player = FindPlayer(message->playerId);
             if (player && !player->isLocal) {
+                // UDP can reorder, so an update older than the one applied is
+                // stale. Over a second older means the sender re-anchored its
+                // clock rather than a late packet; that one is taken
+                int age = (int)(player->lastUpdateTick - message->tick);
+                if (age > 0 && age <= TICK_RATE) {
+                    break;
+                }
+                
                 // Copy position, velocity, rotation
                 player->position = message->data.player.position;
                 player->velocity = message->data.player.velocity;
                 player->rotation = message->data.player.rotation;
-                player->health = message->data.player.health;
+                
+                // Health is the host's to decide
+                if (!game.isHost) {
+                    player->health = message->data.player.health;
+                }
                 player->currentWeapon = message->data.player.currentWeapon;
                 player->isReloading = message->data.player.isReloading;
                 player->reloadTimer = message->data.player.reloadTimer;
+                player->lastUpdateTick = message->tick;
                 
-                // Forward this to all clients if we're the host
+                // The host relays it in the next snapshot of every other client
                 if (game.isHost) {
-                    for (int i = 0; i < game.clientCount; i++) {
-                        if (game.clientAddrs[i].sin_addr.s_addr != senderAddr->sin_addr.s_addr ||
-                            game.clientAddrs[i].sin_port != senderAddr->sin_port) {
-                            SendMessage(message, &game.clientAddrs[i]);
-                        }
-                    }
+                    MarkPlayerDirty((int)(player - game.players), FindSession(senderAddr));
+                    RecordDemoMessage(message);
                 }
             }
             break;
         }
             
         case MSG_PLAYER_SHOOT: {
-            // Create bullet
-            CreateBullet(
-                message->playerId,
-                message->data.bullet.position,
-                message->data.bullet.rotation,
-                message->data.bullet.damage,
-                message->data.bullet.color
-            );
+            if (game.isHost && !IsSenderPlayer(senderAddr, message->playerId)) {
+                break;
+            }
+            
+            // Pellets go where the shooter aimed them; only the angles are
+            // taken from the message
+            Player* shooter = FindPlayer(message->playerId);
+            if (shooter) {
+                FireRemoteShot(shooter, message->data.shot.origin, message->data.shot.angles,
+                               message->data.shot.pelletCount);
+            }
             
             // Forward this to all clients if we're the host
             if (game.isHost) {
-                for (int i = 0; i < game.clientCount; i++) {
-                    if (game.clientAddrs[i].sin_addr.s_addr != senderAddr->sin_addr.s_addr ||
-                        game.clientAddrs[i].sin_port != senderAddr->sin_port) {
-                        SendMessage(message, &game.clientAddrs[i]);
-                    }
-                }
+                BroadcastMessage(message, senderAddr);
             }
             break;
         }
@@ -469,20 +1004,51 @@ void ProcessMessage(NetworkMessage* message, struct sockaddr_in* senderAddr)
         case MSG_PING: {
             // Respond with pong
             if (game.isHost || (strcmp(message->playerId, game.localPlayerId) != 0)) {
+                double receiveTime = GetTime();
+                LinkStats* link = GetPeerLink(senderAddr);
+                
                 NetworkMessage pongMsg;
                 pongMsg.type = MSG_PONG;
                 strcpy(pongMsg.playerId, message->playerId);
-                pongMsg.data.ping = message->data.ping;
+                pongMsg.data.pingInfo.sentTime = message->data.pingInfo.sentTime;
+                pongMsg.data.pingInfo.receiveTime = receiveTime;
+                pongMsg.data.pingInfo.replyTime = GetTime();
+                pongMsg.data.pingInfo.lossRate = link ? link->measuredLoss : 0;
                 SendMessage(&pongMsg, senderAddr);
             }
             break;
         }
             
         case MSG_PONG: {
-            // Calculate ping
+            // Calculate ping from our own echoed send time
             if (strcmp(message->playerId, game.localPlayerId) == 0) {
                 double now = GetTime();
-                game.ping = (float)((now - game.pingStartTime) * 1000.0);
+                LinkStats* link = GetPeerLink(senderAddr);
+                if (link) {
+                    float rttSample = (float)((now - message->data.pingInfo.sentTime) * 1000.0);
+                    UpdateLinkEstimate(link, rttSample, message->data.pingInfo.lossRate);
+                }
+                
+                // Clients sync their clock to the host's
+                if (!game.isHost) {
+                    AddClockSample(message->data.pingInfo.sentTime, message->data.pingInfo.receiveTime,
+                                   message->data.pingInfo.replyTime, now);
+                }
+                
+                if (game.isHost) {
+                    // Show the average over all clients
+                    float total = 0;
+                    int count = 0;
+                    for (int i = 0; i < MAX_PLAYERS; i++) {
+                        if (game.sessions[i].active && game.sessions[i].link.rtt > 0) {
+                            total += game.sessions[i].link.rtt;
+                            count++;
+                        }
+                    }
+                    game.ping = count > 0 ? total / count : 0;
+                } else {
+                    game.ping = game.serverLink.rtt;
+                }
                 game.lastPingTime = now;
             }
             break;
@@ -500,69 +1066,110 @@ void ProcessMessage(NetworkMessage* message, struct sockaddr_in* senderAddr)
                 
                 // Forward to other clients if we're the host
                 if (game.isHost) {
-                    for (int i = 0; i < game.clientCount; i++) {
-                        if (game.clientAddrs[i].sin_addr.s_addr != senderAddr->sin_addr.s_addr ||
-                            game.clientAddrs[i].sin_port != senderAddr->sin_port) {
-                            SendMessage(message, &game.clientAddrs[i]);
-                        }
-                    }
+                    BroadcastMessage(message, senderAddr);
                 }
             }
             break;
         }
         
-        case MSG_TEAM_SCORE: {
-            // Update team scores
-            if (game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG) {
-                game.teamScores[0] = message->data.teamScores[0];
-                game.teamScores[1] = message->data.teamScores[1];
-                
-                // Forward to other clients if we're the host
-                if (game.isHost) {
-                    for (int i = 0; i < game.clientCount; i++) {
-                        if (game.clientAddrs[i].sin_addr.s_addr != senderAddr->sin_addr.s_addr ||
-                            game.clientAddrs[i].sin_port != senderAddr->sin_port) {
-                            SendMessage(message, &game.clientAddrs[i]);
-                        }
+        case MSG_GAME_EVENTS: {
+            // Host results: queued and applied at the end of this tick. Live
+            // ones are applied once each and in order, then acked; a replay
+            // has them in order already
+            bool live = !IsDemoPlaying();
+            if (!game.isHost && (!live || game.hasInitialState)) {
+                unsigned int sequence = message->data.events.firstSequence;
+                int count = message->data.events.count;
+                for (int i = 0; i < count && i < MAX_NETWORK_EVENTS; i++, sequence++) {
+                    // Already applied, or past a gap the host will resend
+                    if (live && sequence != game.eventSequence) {
+                        continue;
                     }
+                    game.eventSequence++;
+                    
+                    const NetworkEvent* wire = &message->data.events.list[i];
+                    GameEvent event = {
+                        .type = wire->type,
+                        .attacker = (signed char)FindEventPlayer(wire->attackerId),
+                        .victim = (signed char)FindEventPlayer(wire->victimId),
+                        .team = wire->team,
+                        .damage = wire->damage,
+                        .position = wire->position,
+                        .direction = wire->direction
+                    };
+                    PushGameEvent(&event);
+                }
+                
+                if (live) {
+                    NetworkMessage ackMsg;
+                    ackMsg.type = MSG_EVENT_ACK;
+                    strcpy(ackMsg.playerId, game.localPlayerId);
+                    ackMsg.data.eventAck = game.eventSequence;
+                    SendMessage(&ackMsg, &game.serverAddr);
+                }
+            }
+            break;
+        }
+        
+        case MSG_EVENT_ACK: {
+            // Acks only move forward, and never past what was sent
+            ClientSession* session = game.isHost ? FindSession(senderAddr) : NULL;
+            if (session) {
+                unsigned int ack = message->data.eventAck;
+                if (ack != session->eventAck &&
+                    ack - session->eventAck <= game.eventSequence - session->eventAck) {
+                    session->eventAck = ack;
+                    session->eventResendTimer = 0;
                 }
             }
             break;
         }
         
         case MSG_FLAG_UPDATE: {
-            // Update flag state for CTF mode
-            if (game.mode == MODE_CAPTURE_FLAG) {
+            // Update flag state for CTF mode, as the host sees it
+            if (!game.isHost && game.mode == MODE_CAPTURE_FLAG) {
                 int flagIndex = message->data.flagIndex;
                 if (flagIndex >= 0 && flagIndex < 2) {
                     game.flags[flagIndex] = message->data.flag;
-                    
-                    // Forward to other clients if we're the host
-                    if (game.isHost) {
-                        for (int i = 0; i < game.clientCount; i++) {
-                            if (game.clientAddrs[i].sin_addr.s_addr != senderAddr->sin_addr.s_addr ||
-                                game.clientAddrs[i].sin_port != senderAddr->sin_port) {
-                                SendMessage(message, &game.clientAddrs[i]);
-                            }
-                        }
-                    }
                 }
             }
             break;
         }
         
+        case MSG_CONNECT_ACCEPT: {
+            // Handshake complete: stamp this id on everything we send
+            if (!game.isHost) {
+                if (game.connectionId == 0) {
+                    SetStatusMessage("Joined host (connection %08x)", message->data.assignedConnectionId);
+                }
+                game.connectionId = message->data.assignedConnectionId;
+            }
+            break;
+        }
+        
+        case MSG_STATE_SNAPSHOT: {
+            if (!game.isHost) {
+                ReceiveSnapshotFragment(message);
+            }
+            break;
+        }
+        
+        case MSG_HEARTBEAT: {
+            // Nothing to do; receiving it already refreshed the session
+            break;
+        }
+        
         case MSG_CHAT: {
+            if (game.isHost && !IsSenderPlayer(senderAddr, message->playerId)) {
+                break;
+            }
+            
             // Add received chat message
             AddChatMessage(message->data.chatMessage, message->data.senderName);
             
             // Forward to other clients if we're the host
             if (game.isHost) {
-                for (int i = 0; i < game.clientCount; i++) {
-                    if (game.clientAddrs[i].sin_addr.s_addr != senderAddr->sin_addr.s_addr ||
-                        game.clientAddrs[i].sin_port != senderAddr->sin_port) {
-                        SendMessage(message, &game.clientAddrs[i]);
-                    }
-                }
+                BroadcastMessage(message, senderAddr);
             }
             break;
         }
@@ -578,7 +1185,7 @@ void GeneratePlayerId(char* playerId)
     // Use current time and pid to create better randomness
     unsigned int seed = (unsigned int)time(NULL) ^ (unsigned int)getpid();
     seed ^= (uintptr_t)playerId; // Mix in the pointer address for better entropy
-    srand(seed);
+    SeedRandomStream(RNG_SYSTEM, seed);
     
     // Generate a unique prefix to reduce collision chance
     unsigned long uniquifier = (unsigned long)time(NULL) % 100000;
@@ -592,7 +1199,7 @@ void GeneratePlayerId(char* playerId)
     
     // Generate random part for the rest of the ID
     for (int i = 5; i < 15; i++) {
-        playerId[i] = chars[rand() % (sizeof(chars) - 1)];
+        playerId[i] = chars[RandomInt(RNG_SYSTEM, (int)sizeof(chars) - 1)];
     }
     playerId[15] = '\0';
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+#define _DEFAULT_SOURCE
+
+#include "../include/common.h"
+#include "../include/pacing.h"
+
+static double nextDeadline = 0;
+static double lastFrameTime = 0;
+static double spinMargin = 0.002;
+static float intervals[PACING_SAMPLE_COUNT];
+static int intervalCount = 0;
+static int intervalHead = 0;
+
+// Coarse OS sleep; may overshoot by a scheduler quantum
+static void SleepSeconds(double seconds)
+{
+#ifdef _WIN32
+    Sleep((DWORD)(seconds * 1000.0));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+#endif
+}
+
+// Sleep most of the way, then spin; the spin margin follows how late the
+// OS has been waking us up
+static void WaitUntil(double deadline)
+{
+    double sleepFor = deadline - GetTime() - spinMargin;
+    if (sleepFor > 0) {
+        double wakeTarget = GetTime() + sleepFor;
+        SleepSeconds(sleepFor);
+        double overshoot = GetTime() - wakeTarget;
+        
+        spinMargin = fmax(spinMargin * 0.99, overshoot * 1.5);
+        if (spinMargin < PACING_SPIN_MIN) spinMargin = PACING_SPIN_MIN;
+        if (spinMargin > PACING_SPIN_MAX) spinMargin = PACING_SPIN_MAX;
+    }
+    
+    while (GetTime() < deadline) {
+    }
+}
+
+int GetPacingTargetFPS(bool inGame)
+{
+    if (!IsWindowFocused() || IsWindowMinimized()) {
+        return PACING_BACKGROUND_FPS;
+    }
+    if (!inGame) {
+        return PACING_MENU_FPS;
+    }
+    if (game.targetFPS == PACING_UNCAPPED) {
+        return 0;
+    }
+    
+    // Follow the display unless the user picked a cap
+    int refreshRate = GetMonitorRefreshRate(GetCurrentMonitor());
+    if (refreshRate <= 0) {
+        refreshRate = 60;
+    }
+    if (game.vsyncEnabled || game.targetFPS == 0) {
+        return refreshRate;
+    }
+    return game.targetFPS;
+}
+
+// Called once per frame after presenting
+void PaceFrame(bool inGame)
+{
+    int targetFPS = GetPacingTargetFPS(inGame);
+    double now = GetTime();
+    
+    if (targetFPS > 0) {
+        double interval = 1.0 / targetFPS;
+        nextDeadline += interval;
+        
+        // Too far behind (hitch or rate change): start a fresh schedule
+        // instead of rushing frames out to catch up
+        if (nextDeadline < now || nextDeadline > now + interval) {
+            nextDeadline = now + interval;
+        }
+        WaitUntil(nextDeadline);
+        now = GetTime();
+    }
+    
+    if (lastFrameTime > 0) {
+        intervals[intervalHead] = (float)(now - lastFrameTime);
+        intervalHead = (intervalHead + 1) % PACING_SAMPLE_COUNT;
+        if (intervalCount < PACING_SAMPLE_COUNT) {
+            intervalCount++;
+        }
+    }
+    lastFrameTime = now;
+}
+
+// Mean and standard deviation of recent frame intervals
+void GetFramePacingStats(float* meanMs, float* deviationMs)
+{
+    float sum = 0;
+    float sumSquares = 0;
+    
+    for (int i = 0; i < intervalCount; i++) {
+        sum += intervals[i];
+        sumSquares += intervals[i] * intervals[i];
+    }
+    
+    if (intervalCount == 0) {
+        *meanMs = 0;
+        *deviationMs = 0;
+        return;
+    }
+    
+    float mean = sum / intervalCount;
+    float variance = sumSquares / intervalCount - mean * mean;
+    *meanMs = mean * 1000.0f;
+    *deviationMs = sqrtf(variance > 0 ? variance : 0) * 1000.0f;
+}
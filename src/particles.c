@@ -1,12 +1,37 @@
 #include "../include/common.h"
 #include "../include/particles.h"
+#include "../include/quality.h"
 #include "../include/player.h"
+#include "../include/rng.h"
 
-void UpdateParticles(void)
+// Flash triangle half-angle of 0.2 radians
+#define FLASH_SPREAD_COS 0.98006658f
+#define FLASH_SPREAD_SIN 0.19866933f
+
+// Parabolic sine with one refinement pass, within about 0.001 of sinf().
+// Only for looks: anything gameplay reads must use the exact functions.
+static float FastSin(float x)
 {
-    float dt = GetFrameTime();
-    
-    for (int i = 0; i < MAX_PARTICLES; i++) {
+    x -= 2 * PI * floorf((x + PI) * (1.0f / (2 * PI)));
+    float y = (4 / PI) * x - (4 / (PI * PI)) * x * fabsf(x);
+    return 0.225f * (y * fabsf(y) - y) + y;
+}
+
+static Vector2 FastDirection(float angle)
+{
+    return (Vector2){ FastSin(angle + PI / 2), FastSin(angle) };
+}
+
+void UpdateParticles(float dt)
+{
+    game.particleCount -= UpdateParticleRange(0, MAX_PARTICLES, dt);
+}
+
+// Leaves particleCount to the caller, so ranges can run on separate threads
+int UpdateParticleRange(int begin, int end, float dt)
+{
+    int expired = 0;
+    for (int i = begin; i < end; i++) {
         if (game.particles[i].active) {
             Particle* p = &game.particles[i];
             
@@ -41,16 +66,15 @@ void UpdateParticles(void)
             // Deactivate if lifetime expired
             if (p->lifetime <= 0) {
                 p->active = false;
-                game.particleCount--;
+                expired++;
             }
         }
     }
+    return expired;
 }
 
-void UpdateMuzzleFlashes(void)
+void UpdateMuzzleFlashes(float dt)
 {
-    float dt = GetFrameTime();
-    
     for (int i = 0; i < MAX_MUZZLE_FLASHES; i++) {
         if (game.muzzleFlashes[i].active) {
             MuzzleFlash* m = &game.muzzleFlashes[i];
@@ -65,9 +89,9 @@ void UpdateMuzzleFlashes(void)
             // Update position based on player's gun position if player exists
             Player* owner = FindPlayer(m->ownerId);
             if (owner && owner->active) {
-                m->position.x = owner->position.x + cosf(owner->rotation) * GUN_LENGTH;
-                m->position.y = owner->position.y + sinf(owner->rotation) * GUN_LENGTH;
-                m->rotation = owner->rotation;
+                m->position.x = owner->position.x + owner->direction.x * GUN_LENGTH;
+                m->position.y = owner->position.y + owner->direction.y * GUN_LENGTH;
+                m->direction = owner->direction;
             }
             
             // Deactivate if lifetime expired
@@ -79,10 +103,8 @@ void UpdateMuzzleFlashes(void)
     }
 }
 
-void UpdateHitEffects(void)
+void UpdateHitEffects(float dt)
 {
-    float dt = GetFrameTime();
-    
     for (int i = 0; i < MAX_HIT_EFFECTS; i++) {
         if (game.hitEffects[i].active) {
             HitEffect* h = &game.hitEffects[i];
@@ -106,87 +128,100 @@ void UpdateHitEffects(void)
     }
 }
 
-void DrawParticles(void)
+void UpdateTracers(float dt)
 {
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        if (game.particles[i].active) {
-            Particle* p = &game.particles[i];
-            
-            switch (p->type) {
-                case PARTICLE_DEBRIS:
-                    // Draw as small rectangle
-                    {
-                        Rectangle rect = {
-                            p->position.x - p->size/2,
-                            p->position.y - p->size/2,
-                            p->size,
-                            p->size
-                        };
-                        DrawRectanglePro(rect, (Vector2){p->size/2, p->size/2}, p->rotation * RAD2DEG, p->color);
-                    }
-                    break;
-                    
-                case PARTICLE_BLOOD:
-                    // Draw as circle
-                    DrawCircleV(p->position, p->size, p->color);
-                    break;
-                    
-                case PARTICLE_SPARK:
-                    // Draw as line
-                    {
-                        Vector2 end = {
-                            p->position.x + cosf(p->rotation) * p->size * 2,
-                            p->position.y + sinf(p->rotation) * p->size * 2
-                        };
-                        DrawLineEx(p->position, end, p->size / 2, p->color);
-                    }
-                    break;
-                    
-                case PARTICLE_SMOKE:
-                    // Draw as circle
-                    DrawCircleV(p->position, p->size, p->color);
-                    break;
-                    
-                case PARTICLE_SHELL:
-                    // Draw as small rectangle
-                    {
-                        Rectangle rect = {
-                            p->position.x - p->size/2,
-                            p->position.y - p->size/2,
-                            p->size * 2,
-                            p->size
-                        };
-                        DrawRectanglePro(rect, (Vector2){p->size, p->size/2}, p->rotation * RAD2DEG, p->color);
-                    }
-                    break;
+    for (int i = 0; i < MAX_TRACERS; i++) {
+        if (game.tracers[i].active) {
+            game.tracers[i].lifetime -= dt;
+            if (game.tracers[i].lifetime <= 0) {
+                game.tracers[i].active = false;
             }
         }
     }
 }
 
-void DrawMuzzleFlashes(void)
+void DrawParticles(const RenderSnapshot* view)
 {
-    for (int i = 0; i < MAX_MUZZLE_FLASHES; i++) {
-        if (game.muzzleFlashes[i].active) {
-            MuzzleFlash* m = &game.muzzleFlashes[i];
-            
-            // Draw as triangle
-            Vector2 v1 = {
-                m->position.x,
-                m->position.y
-            };
-            Vector2 v2 = {
-                m->position.x + cosf(m->rotation - 0.2f) * m->size,
-                m->position.y + sinf(m->rotation - 0.2f) * m->size
-            };
-            Vector2 v3 = {
-                m->position.x + cosf(m->rotation + 0.2f) * m->size,
-                m->position.y + sinf(m->rotation + 0.2f) * m->size
-            };
-            
-            DrawTriangle(v2, v1, v3, m->color);
-            
-            // Draw additional glow
+    for (int i = 0; i < view->particleCount; i++) {
+        const Particle* p = &view->particles[i];
+        
+        switch (p->type) {
+            case PARTICLE_DEBRIS:
+                // Draw as small rectangle
+                {
+                    Rectangle rect = {
+                        p->position.x - p->size/2,
+                        p->position.y - p->size/2,
+                        p->size,
+                        p->size
+                    };
+                    DrawRectanglePro(rect, (Vector2){p->size/2, p->size/2}, p->rotation * RAD2DEG, p->color);
+                }
+                break;
+                
+            case PARTICLE_BLOOD:
+                // Draw as circle
+                DrawCircleV(p->position, p->size, p->color);
+                break;
+                
+            case PARTICLE_SPARK:
+                // Draw as line
+                {
+                    Vector2 direction = FastDirection(p->rotation);
+                    Vector2 end = {
+                        p->position.x + direction.x * p->size * 2,
+                        p->position.y + direction.y * p->size * 2
+                    };
+                    DrawLineEx(p->position, end, p->size / 2, p->color);
+                }
+                break;
+                
+            case PARTICLE_SMOKE:
+                // Draw as circle
+                DrawCircleV(p->position, p->size, p->color);
+                break;
+                
+            case PARTICLE_SHELL:
+                // Draw as small rectangle
+                {
+                    Rectangle rect = {
+                        p->position.x - p->size/2,
+                        p->position.y - p->size/2,
+                        p->size * 2,
+                        p->size
+                    };
+                    DrawRectanglePro(rect, (Vector2){p->size, p->size/2}, p->rotation * RAD2DEG, p->color);
+                }
+                break;
+        }
+    }
+}
+
+void DrawMuzzleFlashes(const RenderSnapshot* view)
+{
+    for (int i = 0; i < view->muzzleFlashCount; i++) {
+        const MuzzleFlash* m = &view->muzzleFlashes[i];
+        
+        // Draw as triangle
+        Vector2 v1 = {
+            m->position.x,
+            m->position.y
+        };
+        // Edges are the direction turned either way by a fixed angle
+        Vector2 d = m->direction;
+        Vector2 v2 = {
+            m->position.x + (d.x * FLASH_SPREAD_COS + d.y * FLASH_SPREAD_SIN) * m->size,
+            m->position.y + (d.y * FLASH_SPREAD_COS - d.x * FLASH_SPREAD_SIN) * m->size
+        };
+        Vector2 v3 = {
+            m->position.x + (d.x * FLASH_SPREAD_COS - d.y * FLASH_SPREAD_SIN) * m->size,
+            m->position.y + (d.y * FLASH_SPREAD_COS + d.x * FLASH_SPREAD_SIN) * m->size
+        };
+        
+        DrawTriangle(v2, v1, v3, m->color);
+        
+        // Draw additional glow
+        if (view->effectQuality >= QUALITY_GLOW_LEVEL) {
             Color glowColor = m->color;
             glowColor.a = m->color.a / 2;
             DrawCircleV(m->position, m->size / 2, glowColor);
@@ -194,15 +229,27 @@ void DrawMuzzleFlashes(void)
     }
 }
 
-void DrawHitEffects(void)
+void DrawHitEffects(const RenderSnapshot* view)
 {
-    for (int i = 0; i < MAX_HIT_EFFECTS; i++) {
-        if (game.hitEffects[i].active) {
-            HitEffect* h = &game.hitEffects[i];
-            
-            // Draw as circle
-            DrawCircleV(h->position, h->size, h->color);
-        }
+    for (int i = 0; i < view->hitEffectCount; i++) {
+        const HitEffect* h = &view->hitEffects[i];
+        
+        // Draw as circle
+        DrawCircleV(h->position, h->size, h->color);
+    }
+}
+
+void DrawTracers(const RenderSnapshot* view)
+{
+    for (int i = 0; i < view->tracerCount; i++) {
+        const Tracer* t = &view->tracers[i];
+        float fade = t->lifetime / TRACER_LIFETIME;
+        
+        // Bright core over a wider fading glow
+        Color glow = t->color;
+        glow.a = (unsigned char)(90 * fade);
+        DrawLineEx(t->start, t->end, 4.0f, glow);
+        DrawLineEx(t->start, t->end, 1.5f, Fade(WHITE, fade));
     }
 }
 
@@ -214,25 +261,32 @@ void CreateParticle(Vector2 position, Vector2 velocity, float rotation, float ro
         return;
     }
     
-    // Find an empty slot
+    // Find an empty slot while under the quality budget
     int slot = -1;
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        if (!game.particles[i].active) {
-            slot = i;
-            break;
+    if (game.particleCount < GetParticleBudget()) {
+        for (int i = 0; i < MAX_PARTICLES; i++) {
+            if (!game.particles[i].active) {
+                slot = i;
+                break;
+            }
         }
     }
     
-    // If no slots available, replace oldest particle
-    if (slot == -1) {
-        float oldestLifetime = MAX_PARTICLES;
+    // Otherwise replace the particle closest to expiring
+    bool recycled = slot == -1;
+    if (recycled) {
+        float oldestLifetime = 1e9f;
         for (int i = 0; i < MAX_PARTICLES; i++) {
-            if (game.particles[i].lifetime < oldestLifetime) {
+            if (game.particles[i].active && game.particles[i].lifetime < oldestLifetime) {
                 oldestLifetime = game.particles[i].lifetime;
                 slot = i;
             }
         }
+        if (slot == -1) {
+            return;
+        }
     }
+    lifetime = ScaleEffectLifetime(lifetime);
     
     // Initialize the particle
     Particle* p = &game.particles[slot];
@@ -250,10 +304,12 @@ void CreateParticle(Vector2 position, Vector2 velocity, float rotation, float ro
     p->active = true;
     
     // Increment particle count
-    game.particleCount++;
+    if (!recycled) {
+        game.particleCount++;
+    }
 }
 
-void CreateMuzzleFlash(Vector2 position, float rotation, float size, Color color, const char* ownerId)
+void CreateMuzzleFlash(Vector2 position, Vector2 direction, float size, Color color, const char* ownerId)
 {
     // Don't create muzzle flashes if effects are disabled
     if (!game.visualEffectsEnabled) {
@@ -283,7 +339,7 @@ void CreateMuzzleFlash(Vector2 position, float rotation, float size, Color color
     // Initialize the muzzle flash
     MuzzleFlash* m = &game.muzzleFlashes[slot];
     m->position = position;
-    m->rotation = rotation;
+    m->direction = direction;
     m->size = size;
     m->lifetime = MUZZLE_FLASH_LIFETIME;
     m->maxLifetime = MUZZLE_FLASH_LIFETIME;
@@ -295,19 +351,23 @@ void CreateMuzzleFlash(Vector2 position, float rotation, float size, Color color
     game.muzzleFlashCount++;
     
     // Also create some smoke particles
-    for (int i = 0; i < 5; i++) {
+    int smokeCount = ScaleEffectCount(5);
+    float r[6 * 5];
+    FillRandomFloats(RNG_COSMETIC, r, 6 * smokeCount);
+    for (int i = 0; i < smokeCount; i++) {
+        const float* u = &r[6 * i];
         Vector2 smokeVel = {
-            cosf(rotation) * 50.0f + ((float)rand() / RAND_MAX - 0.5f) * 30.0f,
-            sinf(rotation) * 50.0f + ((float)rand() / RAND_MAX - 0.5f) * 30.0f
+            direction.x * 50.0f + (u[0] - 0.5f) * 30.0f,
+            direction.y * 50.0f + (u[1] - 0.5f) * 30.0f
         };
         
         CreateParticle(
             position,
             smokeVel,
-            ((float)rand() / RAND_MAX) * 2 * M_PI,
-            ((float)rand() / RAND_MAX - 0.5f) * 2.0f,
-            5.0f + ((float)rand() / RAND_MAX) * 5.0f,
-            0.5f + ((float)rand() / RAND_MAX) * 0.5f,
+            u[2] * 2 * M_PI,
+            (u[3] - 0.5f) * 2.0f,
+            5.0f + u[4] * 5.0f,
+            0.5f + u[5] * 0.5f,
             (Color){200, 200, 200, 180},
             (Color){150, 150, 150, 0},
             PARTICLE_SMOKE
@@ -355,13 +415,46 @@ void CreateHitEffect(Vector2 position, float size, Color color)
     game.hitEffectCount++;
 }
 
+void CreateTracer(Vector2 start, Vector2 end, Color color)
+{
+    if (!game.visualEffectsEnabled) {
+        return;
+    }
+    
+    // Reuse the oldest streak when all are in flight
+    int slot = 0;
+    for (int i = 0; i < MAX_TRACERS; i++) {
+        if (!game.tracers[i].active) {
+            slot = i;
+            break;
+        }
+        if (game.tracers[i].lifetime < game.tracers[slot].lifetime) {
+            slot = i;
+        }
+    }
+    
+    Tracer* t = &game.tracers[slot];
+    t->start = start;
+    t->end = end;
+    t->lifetime = TRACER_LIFETIME;
+    t->color = color;
+    t->active = true;
+}
+
 void CreateBloodSplatter(Vector2 position, Vector2 direction, int count)
 {
+    count = ScaleEffectCount(count);
+    if (count > MAX_BURST_PARTICLES) count = MAX_BURST_PARTICLES;
+    
+    float r[5 * MAX_BURST_PARTICLES];
+    FillRandomFloats(RNG_COSMETIC, r, 5 * count);
     for (int i = 0; i < count; i++) {
+        const float* u = &r[5 * i];
+        
         // Add randomness to particle direction
         Vector2 particleDir = {
-            direction.x + ((float)rand() / RAND_MAX - 0.5f) * 0.5f,
-            direction.y + ((float)rand() / RAND_MAX - 0.5f) * 0.5f
+            direction.x + (u[0] - 0.5f) * 0.5f,
+            direction.y + (u[1] - 0.5f) * 0.5f
         };
         
         // Normalize direction
@@ -371,7 +464,7 @@ void CreateBloodSplatter(Vector2 position, Vector2 direction, int count)
             particleDir.y /= length;
         }
         
-        float particleSpeed = 50.0f + ((float)rand() / RAND_MAX) * 150.0f;
+        float particleSpeed = 50.0f + u[2] * 150.0f;
         
         CreateParticle(
             position,
@@ -381,8 +474,8 @@ void CreateBloodSplatter(Vector2 position, Vector2 direction, int count)
             },
             0,
             0,
-            2.0f + ((float)rand() / RAND_MAX) * 3.0f,
-            0.5f + ((float)rand() / RAND_MAX) * 0.5f,
+            2.0f + u[3] * 3.0f,
+            0.5f + u[4] * 0.5f,
             (Color){180, 0, 0, 255},
             (Color){120, 0, 0, 0},
             PARTICLE_BLOOD
@@ -395,11 +488,18 @@ void CreateBloodSplatter(Vector2 position, Vector2 direction, int count)
 
 void CreateSparkEffect(Vector2 position, Vector2 normal, int count)
 {
+    count = ScaleEffectCount(count);
+    if (count > MAX_BURST_PARTICLES) count = MAX_BURST_PARTICLES;
+    
+    float r[5 * MAX_BURST_PARTICLES];
+    FillRandomFloats(RNG_COSMETIC, r, 5 * count);
     for (int i = 0; i < count; i++) {
+        const float* u = &r[5 * i];
+        
         // Calculate reflection direction with randomness
         Vector2 reflectDir = {
-            normal.x + ((float)rand() / RAND_MAX - 0.5f) * 1.5f,
-            normal.y + ((float)rand() / RAND_MAX - 0.5f) * 1.5f
+            normal.x + (u[0] - 0.5f) * 1.5f,
+            normal.y + (u[1] - 0.5f) * 1.5f
         };
         
         // Normalize direction
@@ -409,7 +509,7 @@ void CreateSparkEffect(Vector2 position, Vector2 normal, int count)
             reflectDir.y /= length;
         }
         
-        float particleSpeed = 100.0f + ((float)rand() / RAND_MAX) * 200.0f;
+        float particleSpeed = 100.0f + u[2] * 200.0f;
         float particleAngle = atan2f(reflectDir.y, reflectDir.x);
         
         CreateParticle(
@@ -420,8 +520,8 @@ void CreateSparkEffect(Vector2 position, Vector2 normal, int count)
             },
             particleAngle,
             0,
-            1.0f + ((float)rand() / RAND_MAX) * 2.0f,
-            0.2f + ((float)rand() / RAND_MAX) * 0.3f,
+            1.0f + u[3] * 2.0f,
+            0.2f + u[4] * 0.3f,
             (Color){255, 230, 150, 255},
             (Color){255, 100, 0, 0},
             PARTICLE_SPARK
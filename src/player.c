@@ -3,6 +3,12 @@
 #include "../include/weapons.h"
 #include "../include/particles.h"
 #include "../include/core.h"
+#include "../include/map.h"
+#include "../include/sprites.h"
+#include "../include/quality.h"
+#include "../include/rng.h"
+#include "../include/events.h"
+#include "../include/network.h"
 
 Player* FindPlayer(const char* playerId)
 {
@@ -39,16 +45,21 @@ Player* CreatePlayer(const char* playerId, const char* playerName, bool isLocal)
     Player* player = &game.players[slot];
     strcpy(player->id, playerId);
     strcpy(player->name, playerName ? playerName : "Unknown");
-    player->position = (Vector2){ SCREEN_WIDTH/2, SCREEN_HEIGHT/2 };
+    Vector2 mapSize = GetMapSize();
+    player->position = (Vector2){ mapSize.x/2, mapSize.y/2 };
     player->velocity = (Vector2){ 0, 0 };
     player->rotation = 0;
+    player->direction = (Vector2){ 1, 0 };
     player->targetRotation = 0;
     player->health = 100.0f;
     player->maxHealth = 100.0f;
-    player->team = rand() % 2;  // Randomly assign to team 0 (red) or 1 (blue)
+    player->team = RandomInt(RNG_GAMEPLAY, 2);  // Randomly assign to team 0 (red) or 1 (blue)
     player->score = 0;
     player->kills = 0;
     player->deaths = 0;
+    player->lastUpdateTick = game.tick;
+    player->prevPosition = player->position;
+    player->prevRotation = player->rotation;
     
     // Generate a deterministic color based on player ID
     unsigned int hashValue = 0;
@@ -86,6 +97,7 @@ Player* CreatePlayer(const char* playerId, const char* playerName, bool isLocal)
     };
     
     player->isLocal = isLocal;
+    player->isBot = false;
     player->active = true;
         
     // Set appropriate team colors for team modes
@@ -99,9 +111,9 @@ Player* CreatePlayer(const char* playerId, const char* playerName, bool isLocal)
     
     // Initialize weapons
     player->currentWeapon = WEAPON_PISTOL;
-    for (int i = 0; i < WEAPON_TOTAL; i++) {
-        player->ammo[i] = 100;
-        player->magazineAmmo[i] = GetCurrentWeaponStats(player)->magazineSize;
+    for (int i = 0; i < GetWeaponCount(); i++) {
+        player->ammo[i] = GetWeaponStats(i)->maxAmmo;
+        player->magazineAmmo[i] = GetWeaponStats(i)->magazineSize;
     }
     player->fireTimer = 0;
     player->reloadTimer = 0;
@@ -124,87 +136,120 @@ void RemovePlayer(const char* playerId)
     }
 }
 
-void UpdatePlayers(void)
+// Drops a carried flag and queues the respawn. Scoring was done by the
+// kill event when the health ran out
+static void HandlePlayerDeath(Player* player)
 {
-    float dt = GetFrameTime();
+    int slot = (int)(player - game.players);
     
+    // Handle CTF flag drop if player was carrying it
+    if (game.mode == MODE_CAPTURE_FLAG) {
+        for (int i = 0; i < 2; i++) {
+            if (game.flags[i].isCaptured && strcmp(game.flags[i].carrierId, player->id) == 0) {
+                // Drop the flag where the player died
+                game.flags[i].position = player->position;
+                game.flags[i].isCaptured = false;
+                strcpy(game.flags[i].carrierId, "");
+                EmitFlagEvent(EVENT_FLAG_DROP, slot, i);
+            }
+        }
+    }
+    
+    // Health, deaths and position all change when the event is applied
+    EmitRespawnEvent(slot, FindTeamSpawnPoint(player));
+}
+
+// Only the team modes have sides; in deathmatch nobody is on yours
+bool AreTeammates(const Player* a, const Player* b)
+{
+    if (game.mode != MODE_TEAM_DEATHMATCH && game.mode != MODE_CAPTURE_FLAG) {
+        return false;
+    }
+    return a->team == b->team;
+}
+
+// Team-based in team modes, always clear of walls
+Vector2 FindTeamSpawnPoint(const Player* player)
+{
+    Vector2 mapSize = GetMapSize();
+    if (game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG) {
+        if (player->team == 0) {
+            // Red team spawns on left side
+            return FindSpawnPoint(PLAYER_SIZE, mapSize.x/3);
+        }
+        // Blue team spawns on right side
+        return FindSpawnPoint(2*mapSize.x/3, mapSize.x - PLAYER_SIZE);
+    }
+    
+    // Random respawn position for deathmatch
+    return FindSpawnPoint(PLAYER_SIZE, mapSize.x - PLAYER_SIZE);
+}
+
+// Movement, aim, weapon choice and firing for a player we control
+void ApplyPlayerInput(Player* player, const PlayerInput* input)
+{
+    float horizontalInput = input->move.x;
+    float verticalInput = input->move.y;
+    
+    // Normalize input vector if moving diagonally
+    float length = sqrtf(horizontalInput * horizontalInput + verticalInput * verticalInput);
+    if (length > 1.0f) {
+        horizontalInput /= length;
+        verticalInput /= length;
+    }
+    
+    // Direct velocity application for better responsiveness
+    if (horizontalInput != 0 || verticalInput != 0) {
+        player->velocity.x = horizontalInput * PLAYER_SPEED;
+        player->velocity.y = verticalInput * PLAYER_SPEED;
+    } else {
+        // Apply deceleration when no input
+        player->velocity.x *= 0.8f;
+        player->velocity.y *= 0.8f;
+    }
+    
+    // Turn toward the aim point
+    player->targetRotation = atan2f(input->aimTarget.y - player->position.y,
+                                    input->aimTarget.x - player->position.x);
+    
+    if (input->selectWeapon >= 0) {
+        SwitchWeapon(player, (WeaponType)input->selectWeapon);
+    }
+    
+    if (input->weaponStep != 0) {
+        int newWeapon = (int)player->currentWeapon + input->weaponStep;
+        
+        // Wrap around
+        if (newWeapon < 0) newWeapon = GetWeaponCount() - 1;
+        if (newWeapon >= GetWeaponCount()) newWeapon = 0;
+        
+        SwitchWeapon(player, (WeaponType)newWeapon);
+    }
+    
+    if (input->reload) {
+        ReloadWeapon(player);
+    }
+    
+    // Fire weapon
+    WeaponStats* stats = GetCurrentWeaponStats(player);
+    if (stats && stats->enabled) {
+        bool shouldFire = stats->automatic ? input->fireHeld : input->firePressed;
+        if (shouldFire && CanShoot(player)) {
+            FireWeapon(player);
+        }
+    }
+}
+
+void UpdatePlayers(float dt)
+{
     // Update all players
     for (int i = 0; i < MAX_PLAYERS; i++) {
         if (game.players[i].active) {
             Player* player = &game.players[i];
             
             if (player->isLocal) {
-                // Apply velocity to position
-                player->position.x += player->velocity.x * dt;
-                player->position.y += player->velocity.y * dt;
-                
-                // Keep player in bounds
-                if (player->position.x < PLAYER_SIZE/2) player->position.x = PLAYER_SIZE/2;
-                if (player->position.x > SCREEN_WIDTH - PLAYER_SIZE/2) 
-                    player->position.x = SCREEN_WIDTH - PLAYER_SIZE/2;
-                if (player->position.y < PLAYER_SIZE/2) player->position.y = PLAYER_SIZE/2;
-                if (player->position.y > SCREEN_HEIGHT - PLAYER_SIZE/2) 
-                    player->position.y = SCREEN_HEIGHT - PLAYER_SIZE/2;
-                
-                // Handle player death
-                if (player->health <= 0) {
-                    player->deaths++; // Increment death counter
-                    
-                    // Award points to killer in Deathmatch modes
-                    // We're simplifying here - ideally we'd track the last player who damaged this player
-                    
-                    // Award team points in team modes
-                    if (game.mode == MODE_TEAM_DEATHMATCH) {
-                        // Award point to the opposing team
-                        int opposingTeam = player->team == 0 ? 1 : 0;
-                        game.teamScores[opposingTeam]++;
-                        
-                        char teamName[10];
-                        sprintf(teamName, "%s", opposingTeam == 0 ? "RED" : "BLUE");
-                        SetStatusMessage("Point for %s team!", teamName);
-                    }
-                    
-                    // Individual scoring in deathmatch
-                    if (game.mode == MODE_DEATHMATCH) {
-                        // In a real game, we'd track who killed this player
-                        // For now, just notify of the death
-                        SetStatusMessage("Player %s was eliminated!", player->name);
-                    }
-                    
-                    // Handle CTF flag drop if player was carrying it
-                    if (game.mode == MODE_CAPTURE_FLAG) {
-                        for (int i = 0; i < 2; i++) {
-                            if (game.flags[i].isCaptured && strcmp(game.flags[i].carrierId, player->id) == 0) {
-                                // Drop the flag where the player died
-                                game.flags[i].position = player->position;
-                                game.flags[i].isCaptured = false;
-                                strcpy(game.flags[i].carrierId, "");
-                                SetStatusMessage("Flag dropped!");
-                            }
-                        }
-                    }
-                    
-                    player->health = player->maxHealth;  // Respawn with full health
-                    
-                    // Respawn position - team-based in team modes
-                    if (game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG) {
-                        if (player->team == 0) {
-                            // Red team spawns on left side
-                            player->position.x = PLAYER_SIZE + (float)rand()/(float)RAND_MAX * (SCREEN_WIDTH/3);
-                        } else {
-                            // Blue team spawns on right side
-                            player->position.x = 2*SCREEN_WIDTH/3 + (float)rand()/(float)RAND_MAX * (SCREEN_WIDTH/3 - PLAYER_SIZE);
-                        }
-                        player->position.y = PLAYER_SIZE + (float)rand()/(float)RAND_MAX * (SCREEN_HEIGHT - 2*PLAYER_SIZE);
-                    } else {
-                        // Random respawn position for deathmatch
-                        player->position.x = PLAYER_SIZE + (float)rand()/(float)RAND_MAX * (SCREEN_WIDTH - 2*PLAYER_SIZE);
-                        player->position.y = PLAYER_SIZE + (float)rand()/(float)RAND_MAX * (SCREEN_HEIGHT - 2*PLAYER_SIZE);
-                    }
-                    
-                    // Reset velocity
-                    player->velocity = (Vector2){0, 0};
-                }
+                // Apply velocity to position, sliding along walls
+                player->position = MoveCircle(player->position, Vector2Scale(player->velocity, dt), PLAYER_SIZE/2);
                 
                 // Apply friction with improved values for better movement feel
                 if (Vector2Length(player->velocity) > 0) {
@@ -229,15 +274,17 @@ void UpdatePlayers(void)
                 player->rotation += rotationDiff * 10.0f * dt;
             } else {
                 // For non-local players, apply simple position prediction
-                player->position.x += player->velocity.x * dt;
-                player->position.y += player->velocity.y * dt;
-                
-                // Handle remote player death
-                if (player->health <= 0) {
-                    player->health = player->maxHealth;  // Respawn with full health
-                }
+                player->position = MoveCircle(player->position, Vector2Scale(player->velocity, dt), PLAYER_SIZE/2);
             }
             
+            // The authority handles every death; clients wait for its respawn event
+            if (player->health <= 0 && HasAuthority()) {
+                HandlePlayerDeath(player);
+            }
+            
+            // The one place aim turns into a vector; shots and effects read this
+            player->direction = (Vector2){ cosf(player->rotation), sinf(player->rotation) };
+            
             // Update fire timer
             if (player->fireTimer > 0) {
                 player->fireTimer -= dt;
@@ -262,131 +309,33 @@ void UpdatePlayers(void)
     }
 }
 
-void DrawPlayers(void)
+void DrawPlayers(const RenderSnapshot* view)
 {
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-        if (game.players[i].active) {
-            Player* p = &game.players[i];
-            
-            // Enhanced player body design
-            Vector2 center = p->position;
+    for (int v = 0; v < view->visiblePlayerCount; v++) {
+        int i = view->visiblePlayers[v];
+        if (view->players[i].active) {
+            const Player* p = &view->players[i];
             
-            // Draw shadow
-            DrawCircle(center.x + 2, center.y + 2, PLAYER_SIZE/2 + 2, (Color){0, 0, 0, 60});
-            
-            // For team modes, use enhanced team colors
-            Color playerColor = p->color;
-            Color outlineColor = WHITE;
-            if (game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG) {
-                playerColor = p->team == 0 ? (Color){220, 50, 50, 255} : (Color){50, 120, 220, 255};
-                outlineColor = p->team == 0 ? (Color){255, 100, 100, 255} : (Color){100, 160, 255, 255};
-            }
+            // Blend between the last two ticks
+            Vector2 center = Vector2Lerp(p->prevPosition, p->position, view->renderAlpha);
+            float rotationDelta = p->rotation - p->prevRotation;
+            while (rotationDelta > M_PI) rotationDelta -= 2 * M_PI;
+            while (rotationDelta < -M_PI) rotationDelta += 2 * M_PI;
+            float rotation = p->prevRotation + rotationDelta * view->renderAlpha;
             
-            // Draw player body as hexagon for better look
-            Vector2 hexPoints[6];
+            // Body and weapon come pre-rendered from the sprite atlas
             float hexRadius = PLAYER_SIZE/2;
-            for (int h = 0; h < 6; h++) {
-                float angle = (h * 60.0f) * DEG2RAD;
-                hexPoints[h] = (Vector2){
-                    center.x + cosf(angle) * hexRadius,
-                    center.y + sinf(angle) * hexRadius
-                };
-            }
-            
-            // Draw hexagon body
-            for (int h = 0; h < 6; h++) {
-                Vector2 p1 = hexPoints[h];
-                Vector2 p2 = hexPoints[(h + 1) % 6];
-                Vector2 p3 = center;
-                DrawTriangle(p1, p2, p3, playerColor);
-            }
-            
-            // Draw hexagon outline
-            for (int h = 0; h < 6; h++) {
-                Vector2 p1 = hexPoints[h];
-                Vector2 p2 = hexPoints[(h + 1) % 6];
-                DrawLineEx(p1, p2, 2.0f, outlineColor);
-            }
-            
-            // Draw directional indicator (front of player)
-            Vector2 frontPoint = {
-                center.x + cosf(p->rotation) * (hexRadius + 3),
-                center.y + sinf(p->rotation) * (hexRadius + 3)
-            };
-            DrawCircle(frontPoint.x, frontPoint.y, 3, outlineColor);
-            
-            // Enhanced weapon rendering
-            Vector2 gunStart = {
-                center.x + cosf(p->rotation) * (hexRadius - 2),
-                center.y + sinf(p->rotation) * (hexRadius - 2)
-            };
-            Vector2 gunEnd = {
-                center.x + cosf(p->rotation) * (GUN_LENGTH + hexRadius),
-                center.y + sinf(p->rotation) * (GUN_LENGTH + hexRadius)
-            };
-            
-            // Draw weapon based on type
-            WeaponStats* stats = GetCurrentWeaponStats(p);
-            Color weaponColor = LIGHTGRAY;
-            float weaponWidth = 4.0f;
-            
-            if (stats) {
-                switch (p->currentWeapon) {
-                    case WEAPON_PISTOL:
-                        weaponColor = GRAY;
-                        weaponWidth = 3.0f;
-                        break;
-                    case WEAPON_RIFLE:
-                        weaponColor = DARKGRAY;
-                        weaponWidth = 5.0f;
-                        break;
-                    case WEAPON_SHOTGUN:
-                        weaponColor = BROWN;
-                        weaponWidth = 6.0f;
-                        break;
-                    case WEAPON_SMG:
-                        weaponColor = DARKBLUE;
-                        weaponWidth = 4.0f;
-                        break;
-                    case WEAPON_SNIPER:
-                        weaponColor = BLACK;
-                        weaponWidth = 4.0f;
-                        // Draw scope
-                        Vector2 scopePos = {
-                            gunStart.x + cosf(p->rotation) * 8,
-                            gunStart.y + sinf(p->rotation) * 8
-                        };
-                        DrawRectanglePro((Rectangle){scopePos.x, scopePos.y, 6, 3}, 
-                                       (Vector2){3, 1.5f}, p->rotation * RAD2DEG, DARKGRAY);
-                        break;
-                    default:
-                        break;
-                }
-            }
-            
-            DrawLineEx(gunStart, gunEnd, weaponWidth, weaponColor);
-            DrawLineEx(gunStart, gunEnd, 1.0f, WHITE); // Highlight line
+            DrawPlayerSprite(view, i, p->currentWeapon, center, rotation);
             
             // Enhanced team indicator
-            if (game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG) {
-                Color teamIndicatorColor = p->team == 0 ? RED : BLUE;
-                Vector2 indicatorPos = {center.x, center.y - hexRadius - 12};
-                
-                // Draw team badge
-                DrawRectanglePro((Rectangle){indicatorPos.x, indicatorPos.y, 12, 8}, 
-                               (Vector2){6, 4}, 0, teamIndicatorColor);
-                DrawRectangleLinesEx((Rectangle){indicatorPos.x - 6, indicatorPos.y - 4, 12, 8}, 
-                                   1, WHITE);
-                
-                // Draw team letter
-                const char* teamLetter = p->team == 0 ? "R" : "B";
-                DrawText(teamLetter, indicatorPos.x - 3, indicatorPos.y - 3, 8, WHITE);
+            if (view->mode == MODE_TEAM_DEATHMATCH || view->mode == MODE_CAPTURE_FLAG) {
+                DrawTeamBadge(p->team, (Vector2){center.x, center.y - hexRadius - 12});
             }
             
             // Enhanced flag carrier indicator
-            if (game.mode == MODE_CAPTURE_FLAG) {
+            if (view->mode == MODE_CAPTURE_FLAG) {
                 for (int f = 0; f < 2; f++) {
-                    if (game.flags[f].isCaptured && strcmp(game.flags[f].carrierId, p->id) == 0) {
+                    if (view->flags[f].isCaptured && strcmp(view->flags[f].carrierId, p->id) == 0) {
                         Color flagColor = f == 0 ? RED : BLUE;
                         Vector2 flagPos = {center.x - 8, center.y - hexRadius - 20};
                         
@@ -428,10 +377,11 @@ void DrawPlayers(void)
             }
             
             // Highlight local player
-            if (p->isLocal) {
+            if (p->isLocal && !p->isBot) {
                 // Animated ring around local player
                 float pulseRadius = hexRadius + 8 + sinf(GetTime() * 4) * 3;
-                for (int ring = 0; ring < 3; ring++) {
+                int rings = view->effectQuality >= QUALITY_GLOW_LEVEL ? 3 : 1;
+                for (int ring = 0; ring < rings; ring++) {
                     DrawCircleLines(center.x, center.y, pulseRadius + ring, 
                                   (Color){255, 255, 0, 100 - ring * 30});
                 }
@@ -446,7 +396,7 @@ void DrawPlayers(void)
                                0.3f, 8, (Color){0, 0, 0, 150});
             
             // Name text with outline
-            Color nameColor = p->isLocal ? YELLOW : WHITE;
+            Color nameColor = p->isLocal && !p->isBot ? YELLOW : WHITE;
             DrawText(p->name, namePos.x + 1, namePos.y + 1, 12, BLACK); // Shadow
             DrawText(p->name, namePos.x, namePos.y, 12, nameColor);
         }
@@ -0,0 +1,59 @@
+#include "../include/common.h"
+#include "../include/quality.h"
+
+static float quality = 1.0f;
+static float smoothedFrameTime = 0;
+static float cooldown = 0;
+
+// Called once per frame with the time spent before presenting, the wall
+// time since the last frame and the rate the pacer aims for (0 = uncapped)
+void UpdateEffectQuality(float frameWorkTime, float frameDelta, int targetFPS)
+{
+    // Adjustments are spaced in real time, whatever the frames cost
+    cooldown -= frameDelta;
+    
+    // Loading hitches and window drags say nothing about effect cost
+    if (frameWorkTime <= 0 || frameWorkTime > 0.25f) {
+        return;
+    }
+    
+    if (smoothedFrameTime == 0) {
+        smoothedFrameTime = frameWorkTime;
+    }
+    smoothedFrameTime += (frameWorkTime - smoothedFrameTime) * QUALITY_SMOOTHING;
+    
+    if (cooldown > 0) {
+        return;
+    }
+    
+    float budget = QUALITY_BUDGET_SHARE / (targetFPS > 0 ? targetFPS : QUALITY_FALLBACK_FPS);
+    if (smoothedFrameTime > budget && quality > QUALITY_MIN) {
+        quality = fmaxf(quality - QUALITY_STEP_DOWN, QUALITY_MIN);
+        cooldown = QUALITY_COOLDOWN;
+    } else if (smoothedFrameTime < budget * 0.6f && quality < 1.0f) {
+        quality = fminf(quality + QUALITY_STEP_UP, 1.0f);
+        cooldown = QUALITY_COOLDOWN;
+    }
+}
+
+float GetEffectQuality(void)
+{
+    return quality;
+}
+
+int ScaleEffectCount(int count)
+{
+    int scaled = (int)roundf(count * game.effectQuality);
+    return scaled < 1 && count > 0 ? 1 : scaled;
+}
+
+// Lifetimes shrink by at most half so effects still read at low quality
+float ScaleEffectLifetime(float lifetime)
+{
+    return lifetime * (0.5f + 0.5f * game.effectQuality);
+}
+
+int GetParticleBudget(void)
+{
+    return (int)(MAX_PARTICLES * game.effectQuality);
+}
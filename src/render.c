@@ -0,0 +1,253 @@
+#include "../include/common.h"
+#include "../include/render.h"
+#include "../include/spatial.h"
+#include "../include/map.h"
+#include "../include/player.h"
+#include "../include/visibility.h"
+#include "../include/weapons.h"
+
+#ifndef _WIN32
+    #define RENDER_BUFFER_LOCKING 1
+    #include <pthread.h>
+#endif
+
+static RenderSnapshot buffers[3];
+static int writeIndex = 0;      // Owned by the simulation
+static int readyIndex = 1;      // Newest complete snapshot
+static int readIndex = 2;       // Owned by the renderer
+static bool hasNewSnapshot = false;
+
+#ifdef RENDER_BUFFER_LOCKING
+// Only guards the index swaps, never the copies
+static pthread_mutex_t swapLock = PTHREAD_MUTEX_INITIALIZER;
+#define LockSwap() pthread_mutex_lock(&swapLock)
+#define UnlockSwap() pthread_mutex_unlock(&swapLock)
+#else
+#define LockSwap()
+#define UnlockSwap()
+#endif
+
+static Camera2D viewCamera = { {SCREEN_WIDTH/2, SCREEN_HEIGHT/2}, {SCREEN_WIDTH/2, SCREEN_HEIGHT/2}, 0, 1 };
+
+// Keep the camera inside the map; a map smaller than the screen stays centred
+static Vector2 ClampCameraTarget(Vector2 target, Vector2 mapSize)
+{
+    float halfWidth = SCREEN_WIDTH / 2.0f;
+    float halfHeight = SCREEN_HEIGHT / 2.0f;
+    
+    if (mapSize.x <= SCREEN_WIDTH) {
+        target.x = mapSize.x / 2;
+    } else {
+        target.x = Clamp(target.x, halfWidth, mapSize.x - halfWidth);
+    }
+    if (mapSize.y <= SCREEN_HEIGHT) {
+        target.y = mapSize.y / 2;
+    } else {
+        target.y = Clamp(target.y, halfHeight, mapSize.y - halfHeight);
+    }
+    return target;
+}
+
+static Rectangle GetCameraBounds(Vector2 target, float margin)
+{
+    return (Rectangle){
+        target.x - SCREEN_WIDTH / 2.0f - margin,
+        target.y - SCREEN_HEIGHT / 2.0f - margin,
+        SCREEN_WIDTH + margin * 2,
+        SCREEN_HEIGHT + margin * 2
+    };
+}
+
+// Where the camera looks: the local player, or the middle of the map
+static Vector2 GetCameraFocus(const Player* players, const char* localPlayerId, float alpha)
+{
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (players[i].active && strcmp(players[i].id, localPlayerId) == 0) {
+            return Vector2Lerp(players[i].prevPosition, players[i].position, alpha);
+        }
+    }
+    Vector2 size = GetMapSize();
+    return (Vector2){ size.x / 2, size.y / 2 };
+}
+
+// Copy the entries of a game array that lie inside area into a compacted array
+static int CopyVisible(SpatialLayer layer, Rectangle area, const void* source, void* dest, size_t elementSize, int capacity)
+{
+    static int indices[MAX_PARTICLES];
+    int found = QuerySpatialLayer(layer, area, indices, capacity);
+    
+    for (int n = 0; n < found; n++) {
+        memcpy((char*)dest + n * elementSize, (const char*)source + indices[n] * elementSize, elementSize);
+    }
+    return found;
+}
+
+// Under fog of war, drop enemies the local player can't see and keep the
+// outline of what they can
+static void ApplyFogOfWar(RenderSnapshot* view)
+{
+    view->fogPointCount = 0;
+    Player* local = FindPlayer(game.localPlayerId);
+    if (!game.fogOfWarEnabled || !local || !local->active) {
+        return;
+    }
+    
+    int localSlot = (int)(local - game.players);
+    int kept = 0;
+    for (int v = 0; v < view->visiblePlayerCount; v++) {
+        int i = view->visiblePlayers[v];
+        if (AreTeammates(local, &game.players[i]) || IsInSight(localSlot, i)) {
+            view->visiblePlayers[kept++] = i;
+        }
+    }
+    view->visiblePlayerCount = kept;
+    
+    int count;
+    const Vector2* polygon = GetVisibilityPolygon(localSlot, &count);
+    memcpy(view->fogPolygon, polygon, sizeof(Vector2) * count);
+    view->fogPointCount = count;
+    view->fogOrigin = local->position;
+}
+
+// Called from the simulation with the game lock held
+void PublishRenderSnapshot(void)
+{
+    RenderSnapshot* view = &buffers[writeIndex];
+    
+    view->state = game.state;
+    view->mode = game.mode;
+    strcpy(view->localPlayerId, game.localPlayerId);
+    view->map = &game.map;
+    view->tickTime = GetTime() - game.simAccumulator;
+    view->tick = game.tick;
+    
+    // Cull against where the camera will be this tick; the margin absorbs the
+    // reader's interpolation and shake
+    Vector2 target = ClampCameraTarget(GetCameraFocus(game.players, game.localPlayerId, 1.0f), GetMapSize());
+    view->cullBounds = GetCameraBounds(target, CULL_MARGIN);
+    
+    memcpy(view->players, game.players, sizeof(game.players));
+    view->playerCount = game.playerCount;
+    view->weaponCount = GetWeaponCount();
+    for (int i = 0; i < view->weaponCount; i++) {
+        view->weapons[i] = *GetWeaponStats(i);
+    }
+    view->flags[0] = game.flags[0];
+    view->flags[1] = game.flags[1];
+    view->teamScores[0] = game.teamScores[0];
+    view->teamScores[1] = game.teamScores[1];
+    view->modeTimer = game.modeTimer;
+    view->modeMaxTime = game.modeMaxTime;
+    view->modeInstructionTimer = game.modeInstructionTimer;
+    
+    // Everything the draw passes walk comes out of the spatial index
+    RebuildSpatialLayer(SPATIAL_PLAYERS);
+    view->visiblePlayerCount = QuerySpatialLayer(SPATIAL_PLAYERS, view->cullBounds, view->visiblePlayers, MAX_PLAYERS);
+    ApplyFogOfWar(view);
+    
+    RebuildSpatialLayer(SPATIAL_BULLETS);
+    view->bulletCount = CopyVisible(SPATIAL_BULLETS, view->cullBounds, game.bullets, view->bullets, sizeof(game.bullets[0]), MAX_BULLETS);
+    
+    view->particleCount = 0;
+    view->muzzleFlashCount = 0;
+    view->hitEffectCount = 0;
+    view->tracerCount = 0;
+    view->visualEffectsEnabled = game.visualEffectsEnabled;
+    view->effectQuality = game.effectQuality;
+    if (game.visualEffectsEnabled) {
+        RebuildSpatialLayer(SPATIAL_PARTICLES);
+        RebuildSpatialLayer(SPATIAL_MUZZLE_FLASHES);
+        RebuildSpatialLayer(SPATIAL_HIT_EFFECTS);
+        view->particleCount = CopyVisible(SPATIAL_PARTICLES, view->cullBounds, game.particles, view->particles, sizeof(game.particles[0]), MAX_PARTICLES);
+        view->muzzleFlashCount = CopyVisible(SPATIAL_MUZZLE_FLASHES, view->cullBounds, game.muzzleFlashes, view->muzzleFlashes, sizeof(game.muzzleFlashes[0]), MAX_MUZZLE_FLASHES);
+        view->hitEffectCount = CopyVisible(SPATIAL_HIT_EFFECTS, view->cullBounds, game.hitEffects, view->hitEffects, sizeof(game.hitEffects[0]), MAX_HIT_EFFECTS);
+        
+        // Tracers are long, so they are culled by their whole extent
+        for (int i = 0; i < MAX_TRACERS; i++) {
+            const Tracer* t = &game.tracers[i];
+            if (t->active && CheckCollisionRecs(GetSweptBounds(t->start, t->end, 0), view->cullBounds)) {
+                view->tracers[view->tracerCount++] = *t;
+            }
+        }
+    }
+    
+    view->screenShake = game.screenShake;
+    view->screenShakeIntensity = game.screenShakeIntensity;
+    view->screenShakeEnabled = game.screenShakeEnabled;
+    view->damageFlashTimer = game.damageFlashTimer;
+    view->damageFlashColor = game.damageFlashColor;
+    
+    memcpy(view->chatMessages, game.chatMessages, sizeof(game.chatMessages));
+    view->chatMessageCount = game.chatMessageCount;
+    strcpy(view->statusMessage, game.statusMessage);
+    view->statusTimer = game.statusTimer;
+    view->isHost = game.isHost;
+    view->isConnected = game.isConnected;
+    view->ping = game.ping;
+    view->packetsSent = game.packetsSent;
+    view->packetsReceived = game.packetsReceived;
+    view->clock = game.clock;
+    
+    // Hand the finished buffer over and take the stale one back
+    LockSwap();
+    int ready = readyIndex;
+    readyIndex = writeIndex;
+    writeIndex = ready;
+    hasNewSnapshot = true;
+    UnlockSwap();
+}
+
+// Called from the render thread once per frame
+const RenderSnapshot* AcquireRenderSnapshot(void)
+{
+    LockSwap();
+    if (hasNewSnapshot) {
+        int ready = readyIndex;
+        readyIndex = readIndex;
+        readIndex = ready;
+        hasNewSnapshot = false;
+    }
+    UnlockSwap();
+    
+    // Blend between the snapshot's last two ticks by how far we are into the next one
+    RenderSnapshot* view = &buffers[readIndex];
+    float alpha = (float)((GetTime() - view->tickTime) / SIM_DT);
+    if (alpha < 0.0f) alpha = 0.0f;
+    if (alpha > 1.0f) alpha = 1.0f;
+    view->renderAlpha = alpha;
+    
+    // Follow the interpolated local player so the camera moves as smoothly as they do
+    Vector2 focus = GetCameraFocus(view->players, view->localPlayerId, alpha);
+    viewCamera.target = ClampCameraTarget(focus, GetMapSize());
+    viewCamera.offset = (Vector2){ SCREEN_WIDTH / 2.0f, SCREEN_HEIGHT / 2.0f };
+    viewCamera.rotation = 0;
+    viewCamera.zoom = 1;
+    view->camera = viewCamera;
+    view->viewBounds = GetCameraBounds(viewCamera.target, 0);
+    
+    return view;
+}
+
+const Player* FindViewPlayer(const RenderSnapshot* view, const char* playerId)
+{
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (view->players[i].active && strcmp(view->players[i].id, playerId) == 0) {
+            return &view->players[i];
+        }
+    }
+    return NULL;
+}
+
+const WeaponStats* GetViewWeaponStats(const RenderSnapshot* view, int weapon)
+{
+    if (weapon < 0 || weapon >= view->weaponCount) {
+        return NULL;
+    }
+    return &view->weapons[weapon];
+}
+
+// Camera of the last acquired snapshot, for turning mouse input into world space
+Camera2D GetViewCamera(void)
+{
+    return viewCamera;
+}
@@ -0,0 +1,166 @@
+#include "../include/common.h"
+#include "../include/rng.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RNG_USE_SSE2 1
+#endif
+
+#define RNG_LANES 4
+
+// Scalar state for single draws plus four interleaved lanes for batches,
+// stored word-major so each state word is one vector register
+typedef struct {
+    uint32_t state[4];
+    uint32_t lanes[4][RNG_LANES];
+} RandomState;
+
+static RandomState streams[RNG_STREAM_COUNT];
+
+static uint32_t RotateLeft(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+// Spreads one seed into well-mixed state words
+static uint64_t SplitMix64(uint64_t* x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static float ToUnitFloat(uint32_t x)
+{
+    // Top 24 bits fill a float mantissa exactly
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+void SeedRandomStream(RandomStream stream, uint64_t seed)
+{
+    RandomState* r = &streams[stream];
+    uint64_t x = seed;
+    
+    for (int w = 0; w < 4; w += 2) {
+        uint64_t bits = SplitMix64(&x);
+        r->state[w] = (uint32_t)bits;
+        r->state[w + 1] = (uint32_t)(bits >> 32);
+    }
+    for (int lane = 0; lane < RNG_LANES; lane++) {
+        for (int w = 0; w < 4; w += 2) {
+            uint64_t bits = SplitMix64(&x);
+            r->lanes[w][lane] = (uint32_t)bits;
+            r->lanes[w + 1][lane] = (uint32_t)(bits >> 32);
+        }
+    }
+}
+
+// Streams get distinct seeds so they never share a sequence
+void SeedRandomStreams(uint64_t seed)
+{
+    for (int s = 0; s < RNG_STREAM_COUNT; s++) {
+        SeedRandomStream((RandomStream)s, seed + (uint64_t)s * 0xD1B54A32D192ED03ull);
+    }
+}
+
+uint32_t RandomUInt(RandomStream stream)
+{
+    uint32_t* s = streams[stream].state;
+    uint32_t result = s[0] + s[3];
+    uint32_t t = s[1] << 9;
+    
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = RotateLeft(s[3], 11);
+    
+    return result;
+}
+
+float RandomFloat(RandomStream stream)
+{
+    return ToUnitFloat(RandomUInt(stream));
+}
+
+float RandomRange(RandomStream stream, float min, float max)
+{
+    return min + RandomFloat(stream) * (max - min);
+}
+
+int RandomInt(RandomStream stream, int count)
+{
+    if (count <= 0) {
+        return 0;
+    }
+    // Multiply-shift avoids the bias and the divide of a modulo
+    return (int)(((uint64_t)RandomUInt(stream) * (uint32_t)count) >> 32);
+}
+
+// One step of all four lanes: four uniforms in lane order
+static void StepLanes(RandomState* r, float* out)
+{
+#ifdef RNG_USE_SSE2
+    __m128i s0 = _mm_loadu_si128((const __m128i*)r->lanes[0]);
+    __m128i s1 = _mm_loadu_si128((const __m128i*)r->lanes[1]);
+    __m128i s2 = _mm_loadu_si128((const __m128i*)r->lanes[2]);
+    __m128i s3 = _mm_loadu_si128((const __m128i*)r->lanes[3]);
+    
+    __m128i result = _mm_add_epi32(s0, s3);
+    __m128i t = _mm_slli_epi32(s1, 9);
+    s2 = _mm_xor_si128(s2, s0);
+    s3 = _mm_xor_si128(s3, s1);
+    s1 = _mm_xor_si128(s1, s2);
+    s0 = _mm_xor_si128(s0, s3);
+    s2 = _mm_xor_si128(s2, t);
+    s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+    
+    _mm_storeu_si128((__m128i*)r->lanes[0], s0);
+    _mm_storeu_si128((__m128i*)r->lanes[1], s1);
+    _mm_storeu_si128((__m128i*)r->lanes[2], s2);
+    _mm_storeu_si128((__m128i*)r->lanes[3], s3);
+    
+    // Shifted values fit in 24 bits, so the signed convert is exact
+    __m128 values = _mm_cvtepi32_ps(_mm_srli_epi32(result, 8));
+    _mm_storeu_ps(out, _mm_mul_ps(values, _mm_set1_ps(1.0f / 16777216.0f)));
+#else
+    for (int lane = 0; lane < RNG_LANES; lane++) {
+        uint32_t s0 = r->lanes[0][lane];
+        uint32_t s1 = r->lanes[1][lane];
+        uint32_t s2 = r->lanes[2][lane];
+        uint32_t s3 = r->lanes[3][lane];
+        uint32_t t = s1 << 9;
+        
+        out[lane] = ToUnitFloat(s0 + s3);
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        
+        r->lanes[0][lane] = s0;
+        r->lanes[1][lane] = s1;
+        r->lanes[2][lane] = s2;
+        r->lanes[3][lane] = RotateLeft(s3, 11);
+    }
+#endif
+}
+
+void FillRandomFloats(RandomStream stream, float* out, int count)
+{
+    RandomState* r = &streams[stream];
+    int i = 0;
+    
+    for (; i + RNG_LANES <= count; i += RNG_LANES) {
+        StepLanes(r, out + i);
+    }
+    
+    // The tail still takes a whole step so lanes stay in lockstep
+    if (i < count) {
+        float tail[RNG_LANES];
+        StepLanes(r, tail);
+        memcpy(out + i, tail, sizeof(float) * (count - i));
+    }
+}
@@ -0,0 +1,115 @@
+#include "../include/common.h"
+#include "../include/simulation.h"
+#include "../include/core.h"
+#include "../include/render.h"
+#include "../include/quality.h"
+
+#ifndef _WIN32
+    #define SIMULATION_THREAD_SUPPORTED 1
+    #include <pthread.h>
+#endif
+
+#ifdef SIMULATION_THREAD_SUPPORTED
+
+static pthread_mutex_t gameLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t simulationThread;
+static volatile bool simulationRunning = false;
+
+static void* SimulationThread(void* arg)
+{
+    (void)arg;
+    double lastTime = GetTime();
+    
+    while (simulationRunning) {
+        double now = GetTime();
+        float frameTime = (float)(now - lastTime);
+        lastTime = now;
+        
+        LockGame();
+        UpdateGame(frameTime);
+        PublishRenderSnapshot();
+        float untilNextTick = SIM_DT - game.simAccumulator;
+        UnlockGame();
+        
+        // Sleep until the next tick is due
+        if (untilNextTick > 0) {
+            WaitTime(untilNextTick);
+        }
+    }
+    
+    return NULL;
+}
+
+void StartSimulation(void)
+{
+    LockGame();
+    PublishRenderSnapshot();
+    UnlockGame();
+    
+    simulationRunning = true;
+    if (pthread_create(&simulationThread, NULL, SimulationThread, NULL) != 0) {
+        simulationRunning = false;
+    }
+}
+
+void StopSimulation(void)
+{
+    if (simulationRunning) {
+        simulationRunning = false;
+        pthread_join(simulationThread, NULL);
+    }
+}
+
+void LockGame(void)
+{
+    pthread_mutex_lock(&gameLock);
+}
+
+void UnlockGame(void)
+{
+    pthread_mutex_unlock(&gameLock);
+}
+
+// Input has to be polled on the window thread; it only holds the lock briefly
+void UpdateFrameInput(void)
+{
+    LockGame();
+    HandleInput();
+    game.effectQuality = GetEffectQuality();
+    if (!simulationRunning) {
+        UpdateGame(GetFrameTime());
+        PublishRenderSnapshot();
+    }
+    UnlockGame();
+}
+
+#else
+
+// No threads on this platform: the main thread simulates between frames
+
+void StartSimulation(void)
+{
+    PublishRenderSnapshot();
+}
+
+void StopSimulation(void)
+{
+}
+
+void LockGame(void)
+{
+}
+
+void UnlockGame(void)
+{
+}
+
+void UpdateFrameInput(void)
+{
+    HandleInput();
+    game.effectQuality = GetEffectQuality();
+    UpdateGame(GetFrameTime());
+    PublishRenderSnapshot();
+}
+
+#endif
@@ -0,0 +1,464 @@
+#include "../include/common.h"
+#include "../include/snapshot.h"
+#include "../include/network.h"
+#include "../include/player.h"
+#include "../include/weapons.h"
+#include "../include/core.h"
+
+#define POSITION_SCALE 4.0f     // Quarter pixel
+#define TIME_SCALE 1000.0f      // Milliseconds
+
+typedef struct {
+    unsigned char* data;
+    int capacity;
+    int size;
+    bool overflow;
+} SnapshotWriter;
+
+typedef struct {
+    const unsigned char* data;
+    int size;
+    int pos;
+    bool overflow;
+} SnapshotReader;
+
+// Reassembly of the fragments of one incoming snapshot
+static struct {
+    unsigned int snapshotId;
+    int fragmentCount;
+    unsigned int receivedMask;
+    int totalSize;
+    unsigned char buffer[SNAPSHOT_MAX_SIZE];
+} incoming;
+
+static void WriteByte(SnapshotWriter* w, unsigned char value)
+{
+    if (w->size >= w->capacity) {
+        w->overflow = true;
+        return;
+    }
+    w->data[w->size++] = value;
+}
+
+static void WriteVarint(SnapshotWriter* w, unsigned int value)
+{
+    while (value >= 0x80) {
+        WriteByte(w, (unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    WriteByte(w, (unsigned char)value);
+}
+
+// Zigzag so small negative numbers stay small
+static void WriteSigned(SnapshotWriter* w, int value)
+{
+    WriteVarint(w, ((unsigned int)value << 1) ^ (unsigned int)(value >> 31));
+}
+
+static void WriteQuantized(SnapshotWriter* w, float value, float scale)
+{
+    WriteSigned(w, (int)lroundf(value * scale));
+}
+
+static void WriteVector(SnapshotWriter* w, Vector2 value)
+{
+    WriteQuantized(w, value.x, POSITION_SCALE);
+    WriteQuantized(w, value.y, POSITION_SCALE);
+}
+
+static void WriteAngle(SnapshotWriter* w, float radians)
+{
+    float turns = radians / (2.0f * (float)M_PI);
+    turns -= floorf(turns);
+    unsigned int value = (unsigned int)(turns * 65536.0f) & 0xFFFF;
+    WriteByte(w, (unsigned char)(value & 0xFF));
+    WriteByte(w, (unsigned char)(value >> 8));
+}
+
+static void WriteColor(SnapshotWriter* w, Color color)
+{
+    WriteByte(w, color.r);
+    WriteByte(w, color.g);
+    WriteByte(w, color.b);
+}
+
+static void WriteString(SnapshotWriter* w, const char* text)
+{
+    int length = 0;
+    while (length < 31 && text[length] != '\0') {
+        length++;
+    }
+    WriteByte(w, (unsigned char)length);
+    for (int i = 0; i < length; i++) {
+        WriteByte(w, (unsigned char)text[i]);
+    }
+}
+
+static unsigned char ReadByte(SnapshotReader* r)
+{
+    if (r->pos >= r->size) {
+        r->overflow = true;
+        return 0;
+    }
+    return r->data[r->pos++];
+}
+
+static unsigned int ReadVarint(SnapshotReader* r)
+{
+    unsigned int value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        unsigned char byte = ReadByte(r);
+        value |= (unsigned int)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    return value;
+}
+
+static int ReadSigned(SnapshotReader* r)
+{
+    unsigned int value = ReadVarint(r);
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+static float ReadQuantized(SnapshotReader* r, float scale)
+{
+    return (float)ReadSigned(r) / scale;
+}
+
+static Vector2 ReadVector(SnapshotReader* r)
+{
+    Vector2 value;
+    value.x = ReadQuantized(r, POSITION_SCALE);
+    value.y = ReadQuantized(r, POSITION_SCALE);
+    return value;
+}
+
+static float ReadAngle(SnapshotReader* r)
+{
+    unsigned int value = ReadByte(r);
+    value |= (unsigned int)ReadByte(r) << 8;
+    return (float)value / 65536.0f * 2.0f * (float)M_PI;
+}
+
+static Color ReadColor(SnapshotReader* r)
+{
+    Color color;
+    color.r = ReadByte(r);
+    color.g = ReadByte(r);
+    color.b = ReadByte(r);
+    color.a = 255;
+    return color;
+}
+
+static void ReadString(SnapshotReader* r, char* text)
+{
+    int length = ReadByte(r);
+    if (length > 31) {
+        r->overflow = true;
+        length = 0;
+    }
+    for (int i = 0; i < length; i++) {
+        text[i] = (char)ReadByte(r);
+    }
+    text[length] = '\0';
+}
+
+int EncodeGameState(unsigned char* buffer, int capacity)
+{
+    SnapshotWriter w = { buffer, capacity, 0, false };
+    
+    WriteByte(&w, SNAPSHOT_VERSION);
+    WriteVarint(&w, game.tick);
+    WriteVarint(&w, game.eventSequence);
+    
+    // Mode and scores
+    WriteByte(&w, (unsigned char)game.mode);
+    WriteQuantized(&w, game.modeTimer, TIME_SCALE);
+    WriteQuantized(&w, game.modeMaxTime, TIME_SCALE);
+    WriteSigned(&w, game.teamScores[0]);
+    WriteSigned(&w, game.teamScores[1]);
+    
+    // Players; bullets refer to their owner by index in this list
+    int playerSlots[MAX_PLAYERS];
+    int playerCount = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (game.players[i].active) {
+            playerSlots[playerCount++] = i;
+        }
+    }
+    
+    WriteByte(&w, (unsigned char)playerCount);
+    for (int i = 0; i < playerCount; i++) {
+        Player* player = &game.players[playerSlots[i]];
+        WriteString(&w, player->id);
+        WriteString(&w, player->name);
+        WriteVector(&w, player->position);
+        WriteVector(&w, player->velocity);
+        WriteAngle(&w, player->rotation);
+        WriteQuantized(&w, player->health, 1.0f);
+        WriteQuantized(&w, player->maxHealth, 1.0f);
+        WriteColor(&w, player->color);
+        WriteByte(&w, (unsigned char)(player->team | (player->isReloading ? 0x80 : 0)));
+        WriteSigned(&w, player->score);
+        WriteVarint(&w, (unsigned int)player->kills);
+        WriteVarint(&w, (unsigned int)player->deaths);
+        WriteByte(&w, (unsigned char)player->currentWeapon);
+        WriteByte(&w, (unsigned char)GetWeaponCount());
+        for (int weapon = 0; weapon < GetWeaponCount(); weapon++) {
+            WriteVarint(&w, (unsigned int)player->ammo[weapon]);
+            WriteVarint(&w, (unsigned int)player->magazineAmmo[weapon]);
+        }
+        WriteQuantized(&w, player->reloadTimer, TIME_SCALE);
+    }
+    
+    // Bullets in flight
+    WriteVarint(&w, (unsigned int)game.bulletCount);
+    int bulletsWritten = 0;
+    for (int i = 0; i < MAX_BULLETS && bulletsWritten < game.bulletCount; i++) {
+        Bullet* bullet = &game.bullets[i];
+        if (!bullet->active) {
+            continue;
+        }
+        
+        int owner = playerCount;
+        for (int j = 0; j < playerCount; j++) {
+            if (strcmp(game.players[playerSlots[j]].id, bullet->ownerId) == 0) {
+                owner = j;
+                break;
+            }
+        }
+        
+        WriteVector(&w, bullet->position);
+        WriteVector(&w, bullet->velocity);
+        WriteAngle(&w, bullet->rotation);
+        WriteQuantized(&w, bullet->lifetime, TIME_SCALE);
+        WriteVarint(&w, (unsigned int)bullet->damage);
+        WriteByte(&w, (unsigned char)owner);
+        WriteColor(&w, bullet->color);
+        bulletsWritten++;
+    }
+    
+    // Flags
+    for (int i = 0; i < 2; i++) {
+        Flag* flag = &game.flags[i];
+        WriteVector(&w, flag->position);
+        WriteVector(&w, flag->basePosition);
+        WriteByte(&w, (unsigned char)(flag->team | (flag->isCaptured ? 0x80 : 0)));
+        WriteString(&w, flag->carrierId);
+    }
+    
+    return w.overflow ? -1 : w.size;
+}
+
+bool DecodeGameState(const unsigned char* buffer, int size)
+{
+    SnapshotReader r = { buffer, size, 0, false };
+    
+    if (ReadByte(&r) != SNAPSHOT_VERSION) {
+        return false;
+    }
+    unsigned int tick = ReadVarint(&r);
+    unsigned int eventSequence = ReadVarint(&r);
+    
+    GameMode mode = (GameMode)ReadByte(&r);
+    float modeTimer = ReadQuantized(&r, TIME_SCALE);
+    float modeMaxTime = ReadQuantized(&r, TIME_SCALE);
+    int teamScores[2];
+    teamScores[0] = ReadSigned(&r);
+    teamScores[1] = ReadSigned(&r);
+    if (mode >= MODE_TOTAL) {
+        return false;
+    }
+    
+    // Decode players into scratch space first; nothing is applied unless it all parses
+    static Player players[MAX_PLAYERS];
+    int playerCount = ReadByte(&r);
+    if (playerCount > MAX_PLAYERS) {
+        return false;
+    }
+    
+    for (int i = 0; i < playerCount; i++) {
+        Player* player = &players[i];
+        memset(player, 0, sizeof(Player));
+        ReadString(&r, player->id);
+        ReadString(&r, player->name);
+        player->position = ReadVector(&r);
+        player->velocity = ReadVector(&r);
+        player->rotation = ReadAngle(&r);
+        player->targetRotation = player->rotation;
+        player->prevRotation = player->rotation;
+        player->direction = (Vector2){ cosf(player->rotation), sinf(player->rotation) };
+        player->health = ReadQuantized(&r, 1.0f);
+        player->maxHealth = ReadQuantized(&r, 1.0f);
+        player->color = ReadColor(&r);
+        unsigned char teamBits = ReadByte(&r);
+        player->team = teamBits & 0x7F;
+        player->isReloading = (teamBits & 0x80) != 0;
+        player->score = ReadSigned(&r);
+        player->kills = (int)ReadVarint(&r);
+        player->deaths = (int)ReadVarint(&r);
+        player->currentWeapon = (WeaponType)ReadByte(&r);
+        int weaponCount = ReadByte(&r);
+        if (weaponCount > MAX_WEAPONS) {
+            return false;
+        }
+        for (int weapon = 0; weapon < weaponCount; weapon++) {
+            player->ammo[weapon] = (int)ReadVarint(&r);
+            player->magazineAmmo[weapon] = (int)ReadVarint(&r);
+        }
+        player->reloadTimer = ReadQuantized(&r, TIME_SCALE);
+        player->lastUpdateTick = tick;
+        player->prevPosition = player->position;
+        if ((int)player->currentWeapon >= weaponCount) {
+            return false;
+        }
+    }
+    
+    static Bullet bullets[MAX_BULLETS];
+    int bulletCount = (int)ReadVarint(&r);
+    if (bulletCount > MAX_BULLETS) {
+        return false;
+    }
+    
+    for (int i = 0; i < bulletCount; i++) {
+        Bullet* bullet = &bullets[i];
+        memset(bullet, 0, sizeof(Bullet));
+        bullet->position = ReadVector(&r);
+        bullet->prevPosition = bullet->position;
+        bullet->velocity = ReadVector(&r);
+        bullet->rotation = ReadAngle(&r);
+        bullet->direction = (Vector2){ cosf(bullet->rotation), sinf(bullet->rotation) };
+        bullet->lifetime = ReadQuantized(&r, TIME_SCALE);
+        bullet->damage = (int)ReadVarint(&r);
+        int owner = ReadByte(&r);
+        if (owner < playerCount) {
+            strcpy(bullet->ownerId, players[owner].id);
+        }
+        bullet->color = ReadColor(&r);
+        bullet->active = true;
+    }
+    
+    Flag flags[2];
+    for (int i = 0; i < 2; i++) {
+        flags[i].position = ReadVector(&r);
+        flags[i].basePosition = ReadVector(&r);
+        unsigned char teamBits = ReadByte(&r);
+        flags[i].team = teamBits & 0x7F;
+        flags[i].isCaptured = (teamBits & 0x80) != 0;
+        ReadString(&r, flags[i].carrierId);
+    }
+    
+    if (r.overflow) {
+        return false;
+    }
+    
+    // Apply: our own player's movement stays under local control
+    game.mode = mode;
+    game.modeTimer = modeTimer;
+    game.modeMaxTime = modeMaxTime;
+    game.teamScores[0] = teamScores[0];
+    game.teamScores[1] = teamScores[1];
+    game.flags[0] = flags[0];
+    game.flags[1] = flags[1];
+    
+    // Events up to here are part of this state
+    game.eventSequence = eventSequence;
+    
+    for (int i = 0; i < playerCount; i++) {
+        if (strcmp(players[i].id, game.localPlayerId) == 0) {
+            // Health and scores are the host's, even for our own player
+            Player* local = FindPlayer(game.localPlayerId);
+            if (local) {
+                local->health = players[i].health;
+                local->maxHealth = players[i].maxHealth;
+                local->score = players[i].score;
+                local->kills = players[i].kills;
+                local->deaths = players[i].deaths;
+            }
+            continue;
+        }
+        Player* player = CreatePlayer(players[i].id, players[i].name, false);
+        if (player) {
+            *player = players[i];
+            player->isLocal = false;
+            player->active = true;
+        }
+    }
+    
+    for (int i = 0; i < MAX_BULLETS; i++) {
+        game.bullets[i].active = false;
+    }
+    for (int i = 0; i < bulletCount; i++) {
+        game.bullets[i] = bullets[i];
+    }
+    game.bulletCount = bulletCount;
+    
+    return true;
+}
+
+void SendStateSnapshot(struct sockaddr_in* destAddr)
+{
+    static unsigned char buffer[SNAPSHOT_MAX_SIZE];
+    static unsigned int nextSnapshotId = 1;
+    
+    int size = EncodeGameState(buffer, sizeof(buffer));
+    if (size < 0) {
+        SetStatusMessage("State snapshot too large");
+        return;
+    }
+    
+    NetworkMessage fragmentMsg;
+    fragmentMsg.type = MSG_STATE_SNAPSHOT;
+    strcpy(fragmentMsg.playerId, game.localPlayerId);
+    fragmentMsg.data.snapshot.snapshotId = nextSnapshotId++;
+    fragmentMsg.data.snapshot.fragmentCount = (unsigned char)((size + SNAPSHOT_FRAGMENT_SIZE - 1) / SNAPSHOT_FRAGMENT_SIZE);
+    
+    for (int i = 0; i < fragmentMsg.data.snapshot.fragmentCount; i++) {
+        int offset = i * SNAPSHOT_FRAGMENT_SIZE;
+        int fragmentSize = size - offset < SNAPSHOT_FRAGMENT_SIZE ? size - offset : SNAPSHOT_FRAGMENT_SIZE;
+        fragmentMsg.data.snapshot.fragmentIndex = (unsigned char)i;
+        fragmentMsg.data.snapshot.fragmentSize = (unsigned short)fragmentSize;
+        memcpy(fragmentMsg.data.snapshot.bytes, buffer + offset, fragmentSize);
+        SendMessage(&fragmentMsg, destAddr);
+    }
+}
+
+void ReceiveSnapshotFragment(NetworkMessage* message)
+{
+    int index = message->data.snapshot.fragmentIndex;
+    int count = message->data.snapshot.fragmentCount;
+    int fragmentSize = message->data.snapshot.fragmentSize;
+    
+    if (count < 1 || count > SNAPSHOT_MAX_FRAGMENTS || index >= count ||
+        fragmentSize > SNAPSHOT_FRAGMENT_SIZE || (index < count - 1 && fragmentSize != SNAPSHOT_FRAGMENT_SIZE)) {
+        return;
+    }
+    
+    // A newer snapshot replaces whatever was partially received
+    if (message->data.snapshot.snapshotId != incoming.snapshotId || count != incoming.fragmentCount) {
+        incoming.snapshotId = message->data.snapshot.snapshotId;
+        incoming.fragmentCount = count;
+        incoming.receivedMask = 0;
+        incoming.totalSize = 0;
+    }
+    
+    if (incoming.receivedMask & (1u << index)) {
+        return;
+    }
+    
+    memcpy(incoming.buffer + index * SNAPSHOT_FRAGMENT_SIZE, message->data.snapshot.bytes, fragmentSize);
+    incoming.receivedMask |= 1u << index;
+    if (index == count - 1) {
+        incoming.totalSize = index * SNAPSHOT_FRAGMENT_SIZE + fragmentSize;
+    }
+    
+    if (incoming.receivedMask == (1u << count) - 1) {
+        if (DecodeGameState(incoming.buffer, incoming.totalSize)) {
+            game.hasInitialState = true;
+            SetStatusMessage("Received game state (%d bytes)", incoming.totalSize);
+        }
+        incoming.receivedMask = 0;
+    }
+}
@@ -0,0 +1,149 @@
+#include "../include/common.h"
+#include "../include/spatial.h"
+#include "../include/map.h"
+
+// Entities bucketed by cell with a counting sort: cellStart[c] is the first
+// entry for cell c, entries for one cell are contiguous
+typedef struct {
+    int cellStart[SPATIAL_MAX_CELLS + 1];
+    int entries[MAX_PARTICLES];
+    int columns;
+    int rows;
+    float cellWidth;
+    float cellHeight;
+} SpatialGrid;
+
+static SpatialGrid grids[SPATIAL_LAYER_COUNT];
+static int entryCells[MAX_PARTICLES];
+static int cellCursor[SPATIAL_MAX_CELLS];
+
+static int GetLayerCapacity(SpatialLayer layer)
+{
+    switch (layer) {
+        case SPATIAL_PLAYERS: return MAX_PLAYERS;
+        case SPATIAL_BULLETS: return MAX_BULLETS;
+        case SPATIAL_PARTICLES: return MAX_PARTICLES;
+        case SPATIAL_MUZZLE_FLASHES: return MAX_MUZZLE_FLASHES;
+        case SPATIAL_HIT_EFFECTS: return MAX_HIT_EFFECTS;
+        default: return 0;
+    }
+}
+
+// Position of entry i, or false if the slot is unused
+static bool GetLayerPosition(SpatialLayer layer, int i, Vector2* position)
+{
+    switch (layer) {
+        case SPATIAL_PLAYERS:
+            *position = game.players[i].position;
+            return game.players[i].active;
+        case SPATIAL_BULLETS:
+            *position = game.bullets[i].position;
+            return game.bullets[i].active;
+        case SPATIAL_PARTICLES:
+            *position = game.particles[i].position;
+            return game.particles[i].active;
+        case SPATIAL_MUZZLE_FLASHES:
+            *position = game.muzzleFlashes[i].position;
+            return game.muzzleFlashes[i].active;
+        case SPATIAL_HIT_EFFECTS:
+            *position = game.hitEffects[i].position;
+            return game.hitEffects[i].active;
+        default:
+            return false;
+    }
+}
+
+static int ClampCell(int value, int count)
+{
+    if (value < 0) return 0;
+    if (value >= count) return count - 1;
+    return value;
+}
+
+// Anything outside the map is filed under the nearest edge cell
+static int GetCellIndex(const SpatialGrid* grid, Vector2 position)
+{
+    int column = ClampCell((int)floorf(position.x / grid->cellWidth), grid->columns);
+    int row = ClampCell((int)floorf(position.y / grid->cellHeight), grid->rows);
+    return row * grid->columns + column;
+}
+
+void RebuildSpatialLayer(SpatialLayer layer)
+{
+    SpatialGrid* grid = &grids[layer];
+    int capacity = GetLayerCapacity(layer);
+    Vector2 size = GetMapSize();
+    
+    // Large maps get coarser cells rather than more of them
+    grid->columns = (int)ceilf(size.x / SPATIAL_CELL_SIZE);
+    grid->rows = (int)ceilf(size.y / SPATIAL_CELL_SIZE);
+    if (grid->columns < 1) grid->columns = 1;
+    if (grid->rows < 1) grid->rows = 1;
+    if (grid->columns > SPATIAL_MAX_COLUMNS) grid->columns = SPATIAL_MAX_COLUMNS;
+    if (grid->rows > SPATIAL_MAX_COLUMNS) grid->rows = SPATIAL_MAX_COLUMNS;
+    grid->cellWidth = size.x / grid->columns;
+    grid->cellHeight = size.y / grid->rows;
+    
+    int cellCount = grid->columns * grid->rows;
+    memset(grid->cellStart, 0, sizeof(int) * (cellCount + 1));
+    
+    // Count per cell, then turn the counts into start offsets
+    for (int i = 0; i < capacity; i++) {
+        Vector2 position;
+        if (GetLayerPosition(layer, i, &position)) {
+            entryCells[i] = GetCellIndex(grid, position);
+            grid->cellStart[entryCells[i] + 1]++;
+        } else {
+            entryCells[i] = -1;
+        }
+    }
+    for (int c = 0; c < cellCount; c++) {
+        grid->cellStart[c + 1] += grid->cellStart[c];
+    }
+    
+    // Entries land in index order within each cell
+    memcpy(cellCursor, grid->cellStart, sizeof(int) * cellCount);
+    for (int i = 0; i < capacity; i++) {
+        if (entryCells[i] >= 0) {
+            grid->entries[cellCursor[entryCells[i]]++] = i;
+        }
+    }
+}
+
+int QuerySpatialLayer(SpatialLayer layer, Rectangle area, int* results, int maxResults)
+{
+    const SpatialGrid* grid = &grids[layer];
+    if (grid->columns == 0) {
+        return 0;
+    }
+    
+    int minColumn = ClampCell((int)floorf(area.x / grid->cellWidth), grid->columns);
+    int maxColumn = ClampCell((int)floorf((area.x + area.width) / grid->cellWidth), grid->columns);
+    int minRow = ClampCell((int)floorf(area.y / grid->cellHeight), grid->rows);
+    int maxRow = ClampCell((int)floorf((area.y + area.height) / grid->cellHeight), grid->rows);
+    
+    int count = 0;
+    for (int row = minRow; row <= maxRow; row++) {
+        for (int column = minColumn; column <= maxColumn; column++) {
+            int cell = row * grid->columns + column;
+            for (int e = grid->cellStart[cell]; e < grid->cellStart[cell + 1]; e++) {
+                if (count >= maxResults) {
+                    return count;
+                }
+                results[count++] = grid->entries[e];
+            }
+        }
+    }
+    
+    return count;
+}
+
+// Box around a moving circle's path
+Rectangle GetSweptBounds(Vector2 from, Vector2 to, float radius)
+{
+    float minX = fminf(from.x, to.x) - radius;
+    float minY = fminf(from.y, to.y) - radius;
+    float maxX = fmaxf(from.x, to.x) + radius;
+    float maxY = fmaxf(from.y, to.y) + radius;
+    return (Rectangle){ minX, minY, maxX - minX, maxY - minY };
+}
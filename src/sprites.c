@@ -0,0 +1,212 @@
+#include "../include/common.h"
+#include "../include/sprites.h"
+#include "../include/render.h"
+
+#define ATLAS_COLUMNS WEAPON_TOTAL
+#define ATLAS_ROWS (MAX_PLAYERS + 1)
+#define BADGE_ROW MAX_PLAYERS
+
+typedef struct {
+    Color body;
+    Color outline;
+    bool baked;
+} SpriteRowKey;
+
+static RenderTexture2D atlas;
+static bool atlasLoaded = false;
+static bool badgesBaked = false;
+static SpriteRowKey rowKeys[MAX_PLAYERS];
+
+static bool SameColor(Color a, Color b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+// Centre of a cell in atlas drawing coordinates
+static Vector2 GetCellCenter(int row, int column)
+{
+    return (Vector2){
+        column * SPRITE_CELL_SIZE + SPRITE_CELL_SIZE / 2.0f,
+        row * SPRITE_CELL_SIZE + SPRITE_CELL_SIZE / 2.0f
+    };
+}
+
+// Source rectangle for a cell; render textures are stored upside down
+static Rectangle GetCellSource(int row, int column)
+{
+    return (Rectangle){
+        column * SPRITE_CELL_SIZE,
+        atlas.texture.height - (row + 1) * SPRITE_CELL_SIZE,
+        SPRITE_CELL_SIZE,
+        -SPRITE_CELL_SIZE
+    };
+}
+
+// Body, direction marker and weapon, facing +x
+static void BakePlayerCell(Vector2 center, WeaponType weapon, Color playerColor, Color outlineColor)
+{
+    // Draw shadow
+    DrawCircle(center.x, center.y, PLAYER_SIZE/2 + 2, (Color){0, 0, 0, 60});
+    
+    // Draw player body as hexagon for better look
+    Vector2 hexPoints[6];
+    float hexRadius = PLAYER_SIZE/2;
+    for (int h = 0; h < 6; h++) {
+        float angle = (h * 60.0f) * DEG2RAD;
+        hexPoints[h] = (Vector2){
+            center.x + cosf(angle) * hexRadius,
+            center.y + sinf(angle) * hexRadius
+        };
+    }
+    
+    // Draw hexagon body
+    for (int h = 0; h < 6; h++) {
+        DrawTriangle(hexPoints[h], hexPoints[(h + 1) % 6], center, playerColor);
+    }
+    
+    // Draw hexagon outline
+    for (int h = 0; h < 6; h++) {
+        DrawLineEx(hexPoints[h], hexPoints[(h + 1) % 6], 2.0f, outlineColor);
+    }
+    
+    // Draw directional indicator (front of player)
+    DrawCircle(center.x + hexRadius + 3, center.y, 3, outlineColor);
+    
+    // Weapon rendering
+    Vector2 gunStart = { center.x + hexRadius - 2, center.y };
+    Vector2 gunEnd = { center.x + GUN_LENGTH + hexRadius, center.y };
+    Color weaponColor = LIGHTGRAY;
+    float weaponWidth = 4.0f;
+    
+    switch (weapon) {
+        case WEAPON_PISTOL:
+            weaponColor = GRAY;
+            weaponWidth = 3.0f;
+            break;
+        case WEAPON_RIFLE:
+            weaponColor = DARKGRAY;
+            weaponWidth = 5.0f;
+            break;
+        case WEAPON_SHOTGUN:
+            weaponColor = BROWN;
+            weaponWidth = 6.0f;
+            break;
+        case WEAPON_SMG:
+            weaponColor = DARKBLUE;
+            weaponWidth = 4.0f;
+            break;
+        case WEAPON_SNIPER:
+            weaponColor = BLACK;
+            weaponWidth = 4.0f;
+            // Draw scope
+            DrawRectanglePro((Rectangle){gunStart.x + 8, gunStart.y, 6, 3}, (Vector2){3, 1.5f}, 0, DARKGRAY);
+            break;
+        default:
+            break;
+    }
+    
+    DrawLineEx(gunStart, gunEnd, weaponWidth, weaponColor);
+    DrawLineEx(gunStart, gunEnd, 1.0f, WHITE); // Highlight line
+}
+
+static void BakeTeamBadge(Vector2 center, int team)
+{
+    Color teamIndicatorColor = team == 0 ? RED : BLUE;
+    
+    DrawRectanglePro((Rectangle){center.x, center.y, 12, 8}, (Vector2){6, 4}, 0, teamIndicatorColor);
+    DrawRectangleLinesEx((Rectangle){center.x - 6, center.y - 4, 12, 8}, 1, WHITE);
+    DrawText(team == 0 ? "R" : "B", center.x - 3, center.y - 3, 8, WHITE);
+}
+
+// Colours a player is drawn with in the snapshot's mode
+void GetPlayerColors(const RenderSnapshot* view, const Player* player, Color* body, Color* outline)
+{
+    *body = player->color;
+    *outline = WHITE;
+    if (view->mode == MODE_TEAM_DEATHMATCH || view->mode == MODE_CAPTURE_FLAG) {
+        *body = player->team == 0 ? (Color){220, 50, 50, 255} : (Color){50, 120, 220, 255};
+        *outline = player->team == 0 ? (Color){255, 100, 100, 255} : (Color){100, 160, 255, 255};
+    }
+}
+
+// Re-bake the atlas if any visible player's colours changed. Must run outside
+// camera mode: texture mode resets the transform.
+void UpdatePlayerSprites(const RenderSnapshot* view)
+{
+    bool dirty = !badgesBaked;
+    
+    for (int v = 0; v < view->visiblePlayerCount; v++) {
+        int i = view->visiblePlayers[v];
+        Color body, outline;
+        GetPlayerColors(view, &view->players[i], &body, &outline);
+        
+        if (!rowKeys[i].baked || !SameColor(rowKeys[i].body, body) || !SameColor(rowKeys[i].outline, outline)) {
+            rowKeys[i].body = body;
+            rowKeys[i].outline = outline;
+            rowKeys[i].baked = true;
+            dirty = true;
+        }
+    }
+    
+    if (!dirty) {
+        return;
+    }
+    
+    if (!atlasLoaded) {
+        atlas = LoadRenderTexture(ATLAS_COLUMNS * SPRITE_CELL_SIZE, ATLAS_ROWS * SPRITE_CELL_SIZE);
+        SetTextureFilter(atlas.texture, TEXTURE_FILTER_BILINEAR);
+        atlasLoaded = true;
+    }
+    
+    // Rows are tiny, so a colour change simply redraws the whole atlas
+    BeginTextureMode(atlas);
+    ClearBackground(BLANK);
+    for (int row = 0; row < MAX_PLAYERS; row++) {
+        if (!rowKeys[row].baked) {
+            continue;
+        }
+        for (int weapon = 0; weapon < WEAPON_TOTAL; weapon++) {
+            BakePlayerCell(GetCellCenter(row, weapon), (WeaponType)weapon, rowKeys[row].body, rowKeys[row].outline);
+        }
+    }
+    BakeTeamBadge(GetCellCenter(BADGE_ROW, 0), 0);
+    BakeTeamBadge(GetCellCenter(BADGE_ROW, 1), 1);
+    EndTextureMode();
+    
+    badgesBaked = true;
+}
+
+void DrawPlayerSprite(const RenderSnapshot* view, int slot, WeaponType weapon, Vector2 center, float rotation)
+{
+    const WeaponStats* stats = GetViewWeaponStats(view, weapon);
+    if (!atlasLoaded || slot < 0 || slot >= MAX_PLAYERS || !stats) {
+        return;
+    }
+    
+    // Weapons from the weapons file borrow a built-in's cell
+    weapon = stats->style;
+    
+    Rectangle dest = { center.x, center.y, SPRITE_CELL_SIZE, SPRITE_CELL_SIZE };
+    Vector2 origin = { SPRITE_CELL_SIZE / 2.0f, SPRITE_CELL_SIZE / 2.0f };
+    DrawTexturePro(atlas.texture, GetCellSource(slot, weapon), dest, origin, rotation * RAD2DEG, WHITE);
+}
+
+void DrawTeamBadge(int team, Vector2 center)
+{
+    if (!atlasLoaded) {
+        return;
+    }
+    
+    Vector2 position = { center.x - SPRITE_CELL_SIZE / 2.0f, center.y - SPRITE_CELL_SIZE / 2.0f };
+    DrawTextureRec(atlas.texture, GetCellSource(BADGE_ROW, team == 0 ? 0 : 1), position, WHITE);
+}
+
+void UnloadPlayerSprites(void)
+{
+    if (atlasLoaded) {
+        UnloadRenderTexture(atlas);
+        atlasLoaded = false;
+    }
+    badgesBaked = false;
+    memset(rowKeys, 0, sizeof(rowKeys));
+}
@@ -0,0 +1,98 @@
+#include "../include/common.h"
+#include "../include/timesync.h"
+
+void ResetClockSync(void)
+{
+    memset(&game.clock, 0, sizeof(ClockSync));
+    game.tick = 0;
+}
+
+// Fit drift over the samples whose delay is close to the best one;
+// queued packets would otherwise skew the slope
+static double EstimateDrift(int bestSample)
+{
+    ClockSync* clock = &game.clock;
+    double delayLimit = clock->sampleDelay[bestSample] * 2.0 + 0.002;
+    double sumT = 0, sumO = 0, sumTT = 0, sumTO = 0;
+    int n = 0;
+    
+    for (int i = 0; i < clock->sampleCount; i++) {
+        if (clock->sampleDelay[i] > delayLimit) {
+            continue;
+        }
+        // Relative to the best sample to keep the sums well conditioned
+        double t = clock->sampleTime[i] - clock->sampleTime[bestSample];
+        double o = clock->sampleOffset[i] - clock->sampleOffset[bestSample];
+        sumT += t;
+        sumO += o;
+        sumTT += t * t;
+        sumTO += t * o;
+        n++;
+    }
+    
+    double denominator = n * sumTT - sumT * sumT;
+    if (n < 4 || denominator < 1.0) {
+        return clock->drift;
+    }
+    
+    double drift = (n * sumTO - sumT * sumO) / denominator;
+    if (drift > CLOCK_MAX_DRIFT) drift = CLOCK_MAX_DRIFT;
+    if (drift < -CLOCK_MAX_DRIFT) drift = -CLOCK_MAX_DRIFT;
+    return drift;
+}
+
+void AddClockSample(double sentTime, double receiveTime, double replyTime, double arrivalTime)
+{
+    ClockSync* clock = &game.clock;
+    
+    double delay = (arrivalTime - sentTime) - (replyTime - receiveTime);
+    if (delay < 0) delay = 0;
+    
+    int index = clock->nextSample;
+    clock->sampleTime[index] = arrivalTime;
+    clock->sampleOffset[index] = ((receiveTime - sentTime) + (replyTime - arrivalTime)) * 0.5;
+    clock->sampleDelay[index] = delay;
+    clock->nextSample = (index + 1) % CLOCK_SAMPLE_COUNT;
+    if (clock->sampleCount < CLOCK_SAMPLE_COUNT) {
+        clock->sampleCount++;
+    }
+    
+    // The exchange with the shortest round trip has the least asymmetry error
+    int best = 0;
+    for (int i = 1; i < clock->sampleCount; i++) {
+        if (clock->sampleDelay[i] < clock->sampleDelay[best]) {
+            best = i;
+        }
+    }
+    
+    clock->drift = EstimateDrift(best);
+    clock->offset = clock->sampleOffset[best];
+    clock->baseTime = clock->sampleTime[best];
+    clock->synced = true;
+}
+
+double GetServerTime(void)
+{
+    double now = GetTime();
+    if (game.isHost || !game.clock.synced) {
+        return now;
+    }
+    return now + game.clock.offset + game.clock.drift * (now - game.clock.baseTime);
+}
+
+unsigned int GetServerTick(void)
+{
+    return (unsigned int)(GetServerTime() * TICK_RATE);
+}
+
+// One tick per simulation step; re-anchor to host time after dropped
+// steps or when the clock estimate moves
+void AdvanceTick(void)
+{
+    game.tick++;
+    
+    int error = (int)(GetServerTick() - game.tick);
+    if (error > TICK_RESYNC_THRESHOLD || error < -TICK_RESYNC_THRESHOLD) {
+        game.tick = GetServerTick();
+    }
+}
@@ -0,0 +1,151 @@
+#include "../include/common.h"
+#include "../include/visibility.h"
+#include "../include/map.h"
+
+// Pair cache: bit j of known[i] says visible[i] bit j is current. A player's
+// row and column are dropped when they are next seen somewhere else
+static unsigned int known[MAX_PLAYERS];
+static unsigned int visible[MAX_PLAYERS];
+static Vector2 cachedPositions[MAX_PLAYERS];
+static const void* cacheMap = NULL;
+
+// The one polygon kept; fog of war only ever needs the local player's
+static Vector2 polygon[VISIBILITY_RAYS];
+static Vector2 polygonOrigin;
+static int polygonViewer = -1;          // Slot the polygon was cast for
+static const void* polygonMap = NULL;
+
+static Vector2 rayDirections[VISIBILITY_RAYS];
+static bool rayDirectionsReady = false;
+
+static void ForgetPlayer(int slot)
+{
+    known[slot] = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        known[i] &= ~(1u << slot);
+    }
+    cachedPositions[slot] = game.players[slot].position;
+}
+
+// Drops whatever the player's or the map's changes made stale
+static void RefreshCachedPlayer(int slot)
+{
+    if (cacheMap != game.map.data) {
+        memset(known, 0, sizeof(known));
+        cacheMap = game.map.data;
+    }
+    
+    Vector2 position = game.players[slot].position;
+    if (position.x != cachedPositions[slot].x || position.y != cachedPositions[slot].y) {
+        ForgetPlayer(slot);
+    }
+}
+
+static bool IsValidSlot(int slot)
+{
+    return slot >= 0 && slot < MAX_PLAYERS && game.players[slot].active;
+}
+
+bool HasLineOfSight(int viewer, int target)
+{
+    if (!IsValidSlot(viewer) || !IsValidSlot(target)) {
+        return false;
+    }
+    if (viewer == target) {
+        return true;
+    }
+    
+    RefreshCachedPlayer(viewer);
+    RefreshCachedPlayer(target);
+    
+    unsigned int bit = 1u << target;
+    if (!(known[viewer] & bit)) {
+        bool clear = !MapRaycast(game.players[viewer].position, game.players[target].position, NULL, NULL);
+        
+        // The ray is the same both ways, so fill in both entries
+        unsigned int viewerBit = 1u << viewer;
+        known[viewer] |= bit;
+        known[target] |= viewerBit;
+        if (clear) {
+            visible[viewer] |= bit;
+            visible[target] |= viewerBit;
+        } else {
+            visible[viewer] &= ~bit;
+            visible[target] &= ~viewerBit;
+        }
+    }
+    return (visible[viewer] & bit) != 0;
+}
+
+bool IsInSight(int viewer, int target)
+{
+    if (!IsValidSlot(viewer) || !IsValidSlot(target)) {
+        return false;
+    }
+    
+    // Range first: it's free and rules most pairs out
+    Vector2 offset = Vector2Subtract(game.players[target].position, game.players[viewer].position);
+    if (offset.x * offset.x + offset.y * offset.y > FOV_RANGE * FOV_RANGE) {
+        return false;
+    }
+    return HasLineOfSight(viewer, target);
+}
+
+bool IsInFieldOfView(int viewer, int target)
+{
+    if (!IsInSight(viewer, target)) {
+        return false;
+    }
+    if (viewer == target) {
+        return true;
+    }
+    
+    const Player* player = &game.players[viewer];
+    Vector2 offset = Vector2Subtract(game.players[target].position, player->position);
+    float distance = Vector2Length(offset);
+    if (distance < PLAYER_SIZE) {
+        return true;
+    }
+    
+    // Compare cosines rather than angles
+    float facing = Vector2DotProduct(player->direction, offset) / distance;
+    return facing >= cosf(FOV_ANGLE * 0.5f * DEG2RAD);
+}
+
+static void InitRayDirections(void)
+{
+    for (int i = 0; i < VISIBILITY_RAYS; i++) {
+        float angle = 2.0f * (float)M_PI * i / VISIBILITY_RAYS;
+        rayDirections[i] = (Vector2){ cosf(angle), sinf(angle) };
+    }
+    rayDirectionsReady = true;
+}
+
+const Vector2* GetVisibilityPolygon(int viewer, int* count)
+{
+    *count = 0;
+    if (!IsValidSlot(viewer) || !game.map.data) {
+        return polygon;
+    }
+    if (!rayDirectionsReady) {
+        InitRayDirections();
+    }
+    
+    // Standing still means the same view as last time
+    Vector2 origin = game.players[viewer].position;
+    bool unchanged = polygonViewer == viewer && polygonMap == game.map.data &&
+                     polygonOrigin.x == origin.x && polygonOrigin.y == origin.y;
+    if (!unchanged) {
+        for (int i = 0; i < VISIBILITY_RAYS; i++) {
+            Vector2 end = Vector2Add(origin, Vector2Scale(rayDirections[i], FOV_RANGE));
+            polygon[i] = end;
+            MapRaycast(origin, end, &polygon[i], NULL);
+        }
+        polygonViewer = viewer;
+        polygonMap = game.map.data;
+        polygonOrigin = origin;
+    }
+    
+    *count = VISIBILITY_RAYS;
+    return polygon;
+}
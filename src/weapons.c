@@ -4,13 +4,19 @@
 #include "../include/network.h"
 #include "../include/player.h"
 #include "../include/core.h"
+#include "../include/render.h"
+#include "../include/map.h"
+#include "../include/spatial.h"
+#include "../include/rng.h"
+#include "../include/events.h"
 #include <math.h>
 
-// Define weapon stats for each weapon type
-static WeaponStats weaponStats[WEAPON_TOTAL] = {
+// Built-in defaults; the weapons file overrides these and can add more
+static const WeaponStats builtinWeapons[WEAPON_TOTAL] = {
     // WEAPON_PISTOL
     {
         .name = "Pistol",
+        .style = WEAPON_PISTOL,
         .damage = 25,
         .fireRate = 5.0f,  // 5 shots per second
         .reloadTime = 1.0f,
@@ -29,6 +35,7 @@ static WeaponStats weaponStats[WEAPON_TOTAL] = {
     // WEAPON_RIFLE
     {
         .name = "Rifle",
+        .style = WEAPON_RIFLE,
         .damage = 35,
         .fireRate = 8.0f,  // 8 shots per second
         .reloadTime = 1.8f,
@@ -36,6 +43,8 @@ static WeaponStats weaponStats[WEAPON_TOTAL] = {
         .maxAmmo = 150,
         .spread = 0.025f,
         .bulletSpeed = 1100.0f,
+        .hitscan = true,
+        .range = 1200.0f,
         .bulletsPerShot = 1,
         .screenShakeIntensity = 0.8f,
         .particlesPerShot = 7,
@@ -47,6 +56,7 @@ static WeaponStats weaponStats[WEAPON_TOTAL] = {
     // WEAPON_SHOTGUN
     {
         .name = "Shotgun",
+        .style = WEAPON_SHOTGUN,
         .damage = 18,
         .fireRate = 1.5f,  // 1.5 shots per second
         .reloadTime = 2.0f,
@@ -65,6 +75,7 @@ static WeaponStats weaponStats[WEAPON_TOTAL] = {
     // WEAPON_SMG
     {
         .name = "SMG",
+        .style = WEAPON_SMG,
         .damage = 18,
         .fireRate = 15.0f,  // 15 shots per second
         .reloadTime = 1.6f,
@@ -83,6 +94,7 @@ static WeaponStats weaponStats[WEAPON_TOTAL] = {
     // WEAPON_SNIPER
     {
         .name = "Sniper",
+        .style = WEAPON_SNIPER,
         .damage = 90,
         .fireRate = 1.0f,  // 1 shot per second
         .reloadTime = 2.0f,
@@ -90,6 +102,8 @@ static WeaponStats weaponStats[WEAPON_TOTAL] = {
         .maxAmmo = 40,
         .spread = 0.002f,
         .bulletSpeed = 1500.0f,
+        .hitscan = true,
+        .range = 2400.0f,
         .bulletsPerShot = 1,
         .screenShakeIntensity = 1.0f,
         .particlesPerShot = 8,
@@ -100,18 +114,255 @@ static WeaponStats weaponStats[WEAPON_TOTAL] = {
     }
 };
 
-WeaponStats* GetCurrentWeaponStats(Player* player)
+// Names the "style" key accepts, in WeaponType order
+static const char* styleNames[WEAPON_TOTAL] = { "pistol", "rifle", "shotgun", "smg", "sniper" };
+
+// Live table. A slot keeps its index once assigned, so players and snapshots
+// can refer to weapons by index across reloads.
+static WeaponStats weaponStats[MAX_WEAPONS];
+static int weaponCount = 0;
+
+static char weaponsPath[256] = "";
+static long weaponsModTime = 0;
+static double nextReloadCheck = 0;
+
+static void DeriveWeaponStats(WeaponStats* stats)
+{
+    if (stats->fireRate <= 0) {
+        stats->fireRate = 1.0f;
+    }
+    if (stats->bulletsPerShot < 1) {
+        stats->bulletsPerShot = 1;
+    }
+    if (stats->bulletsPerShot > MAX_SHOT_PELLETS) {
+        stats->bulletsPerShot = MAX_SHOT_PELLETS;
+    }
+    if (stats->magazineSize < 1) {
+        stats->magazineSize = 1;
+    }
+    if (stats->maxAmmo < 0) {
+        stats->maxAmmo = 0;
+    }
+    if (stats->bulletSpeed <= 0) {
+        stats->bulletSpeed = BULLET_SPEED;
+    }
+    stats->fireInterval = 1.0f / stats->fireRate;
+}
+
+static bool ParseBool(const char* value)
+{
+    return strcmp(value, "true") == 0 || strcmp(value, "yes") == 0 || strcmp(value, "1") == 0;
+}
+
+static bool SetWeaponField(WeaponStats* stats, const char* key, const char* value)
+{
+    if (strcmp(key, "damage") == 0) {
+        stats->damage = atoi(value);
+    } else if (strcmp(key, "fire_rate") == 0) {
+        stats->fireRate = (float)atof(value);
+    } else if (strcmp(key, "reload_time") == 0) {
+        stats->reloadTime = (float)atof(value);
+    } else if (strcmp(key, "magazine") == 0) {
+        stats->magazineSize = atoi(value);
+    } else if (strcmp(key, "max_ammo") == 0) {
+        stats->maxAmmo = atoi(value);
+    } else if (strcmp(key, "spread") == 0) {
+        stats->spread = (float)atof(value);
+    } else if (strcmp(key, "bullet_speed") == 0) {
+        stats->bulletSpeed = (float)atof(value);
+    } else if (strcmp(key, "hitscan") == 0) {
+        stats->hitscan = ParseBool(value);
+    } else if (strcmp(key, "range") == 0) {
+        stats->range = (float)atof(value);
+    } else if (strcmp(key, "pellets") == 0) {
+        stats->bulletsPerShot = atoi(value);
+    } else if (strcmp(key, "shake") == 0) {
+        stats->screenShakeIntensity = (float)atof(value);
+    } else if (strcmp(key, "particles") == 0) {
+        stats->particlesPerShot = atoi(value);
+    } else if (strcmp(key, "flash_size") == 0) {
+        stats->muzzleFlashSize = (float)atof(value);
+    } else if (strcmp(key, "flash_color") == 0) {
+        int r, g, b;
+        if (sscanf(value, "%d %d %d", &r, &g, &b) != 3) {
+            return false;
+        }
+        stats->muzzleFlashColor = (Color){ (unsigned char)r, (unsigned char)g, (unsigned char)b, 255 };
+    } else if (strcmp(key, "automatic") == 0) {
+        stats->automatic = ParseBool(value);
+    } else if (strcmp(key, "enabled") == 0) {
+        stats->enabled = ParseBool(value);
+    } else if (strcmp(key, "style") == 0) {
+        for (int i = 0; i < WEAPON_TOTAL; i++) {
+            if (strcmp(value, styleNames[i]) == 0) {
+                stats->style = (WeaponType)i;
+                return true;
+            }
+        }
+        return false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static int FindWeaponSlot(const WeaponStats* table, int count, const char* name)
+{
+    for (int i = 0; i < count; i++) {
+        if (strcmp(table[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Fits live players to a freshly loaded table
+static void RefreshPlayerWeapons(int previousCount)
+{
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        Player* player = &game.players[i];
+        if (!player->active) {
+            continue;
+        }
+        
+        // Weapons added at runtime start with the same allowance as a spawn
+        for (int weapon = previousCount; weapon < weaponCount; weapon++) {
+            player->ammo[weapon] = weaponStats[weapon].maxAmmo;
+            player->magazineAmmo[weapon] = weaponStats[weapon].magazineSize;
+        }
+        for (int weapon = 0; weapon < weaponCount; weapon++) {
+            if (player->magazineAmmo[weapon] > weaponStats[weapon].magazineSize) {
+                player->magazineAmmo[weapon] = weaponStats[weapon].magazineSize;
+            }
+            if (player->ammo[weapon] > weaponStats[weapon].maxAmmo) {
+                player->ammo[weapon] = weaponStats[weapon].maxAmmo;
+            }
+        }
+        
+        if ((int)player->currentWeapon >= weaponCount || !weaponStats[player->currentWeapon].enabled) {
+            player->currentWeapon = WEAPON_PISTOL;
+            player->isReloading = false;
+        }
+    }
+}
+
+bool LoadWeapons(const char* path)
+{
+    // Start from the built-ins so a missing or partial file still plays
+    WeaponStats table[MAX_WEAPONS];
+    int count = weaponCount > WEAPON_TOTAL ? weaponCount : WEAPON_TOTAL;
+    memcpy(table, builtinWeapons, sizeof(builtinWeapons));
+    for (int i = WEAPON_TOTAL; i < count; i++) {
+        // Extra weapons dropped from the file keep their slot, disabled
+        table[i] = weaponStats[i];
+        table[i].enabled = false;
+    }
+    
+    if (path != weaponsPath) {
+        snprintf(weaponsPath, sizeof(weaponsPath), "%s", path);
+    }
+    weaponsModTime = GetFileModTime(path);
+    
+    FILE* file = fopen(path, "r");
+    if (file) {
+        WeaponStats* current = NULL;
+        char line[128];
+        int lineNumber = 0;
+        while (fgets(line, sizeof(line), file)) {
+            lineNumber++;
+            
+            char first;
+            char name[32];
+            char key[32];
+            char value[64];
+            if (sscanf(line, " %c", &first) != 1 || first == '#') {
+                continue;
+            }
+            
+            if (sscanf(line, " [%31[^]]]", name) == 1) {
+                int slot = FindWeaponSlot(table, count, name);
+                if (slot < 0 && count < MAX_WEAPONS) {
+                    slot = count++;
+                }
+                if (slot < 0) {
+                    TraceLog(LOG_WARNING, "%s:%d: more than %d weapons", path, lineNumber, MAX_WEAPONS);
+                    current = NULL;
+                    continue;
+                }
+                if (slot >= WEAPON_TOTAL) {
+                    // New types start from the pistol and pick a look with "style"
+                    table[slot] = builtinWeapons[WEAPON_PISTOL];
+                    snprintf(table[slot].name, sizeof(table[slot].name), "%s", name);
+                }
+                current = &table[slot];
+            } else if (sscanf(line, " %31[a-z_] = %63[^\r\n#]", key, value) == 2) {
+                // Drop the padding before a trailing comment
+                for (int end = (int)strlen(value) - 1; end >= 0 && value[end] == ' '; end--) {
+                    value[end] = '\0';
+                }
+                if (!current || !SetWeaponField(current, key, value)) {
+                    TraceLog(LOG_WARNING, "%s:%d: ignored \"%s\"", path, lineNumber, key);
+                }
+            } else {
+                TraceLog(LOG_WARNING, "%s:%d: could not parse line", path, lineNumber);
+            }
+        }
+        fclose(file);
+    }
+    
+    for (int i = 0; i < count; i++) {
+        DeriveWeaponStats(&table[i]);
+    }
+    
+    int previousCount = weaponCount;
+    memcpy(weaponStats, table, sizeof(WeaponStats) * count);
+    weaponCount = count;
+    RefreshPlayerWeapons(previousCount);
+    
+    return file != NULL;
+}
+
+// Polls the file's timestamp now and then; cheap enough to call every frame
+void CheckWeaponsReload(void)
+{
+    double now = GetTime();
+    if (weaponsPath[0] == '\0' || now < nextReloadCheck) {
+        return;
+    }
+    nextReloadCheck = now + WEAPONS_RELOAD_INTERVAL;
+    
+    long modTime = GetFileModTime(weaponsPath);
+    if (modTime != 0 && modTime != weaponsModTime && LoadWeapons(weaponsPath)) {
+        SetStatusMessage("Reloaded weapons from %s", weaponsPath);
+    }
+}
+
+int GetWeaponCount(void)
+{
+    return weaponCount;
+}
+
+WeaponStats* GetWeaponStats(int weapon)
+{
+    if (weapon < 0 || weapon >= weaponCount) {
+        return NULL;
+    }
+    
+    return &weaponStats[weapon];
+}
+
+WeaponStats* GetCurrentWeaponStats(const Player* player)
 {
-    if (!player || player->currentWeapon < 0 || player->currentWeapon >= WEAPON_TOTAL) {
+    if (!player) {
         return NULL;
     }
     
-    return &weaponStats[player->currentWeapon];
+    return GetWeaponStats(player->currentWeapon);
 }
 
 void SwitchWeapon(Player* player, WeaponType weapon)
 {
-    if (!player || weapon < 0 || weapon >= WEAPON_TOTAL) {
+    if (!player || weapon < 0 || (int)weapon >= weaponCount) {
         return;
     }
     
@@ -155,6 +406,16 @@ bool CanShoot(Player* player)
     return player->fireTimer <= 0 && player->magazineAmmo[player->currentWeapon] > 0;
 }
 
+// Fast weapons resolve on the spot instead of taking a bullet slot
+static void FirePellet(const Player* player, const WeaponStats* stats, Vector2 origin, float angle)
+{
+    if (stats->hitscan) {
+        FireHitscan(player->id, origin, angle, stats->damage, stats->range, player->color);
+    } else {
+        CreateBullet(player->id, origin, angle, stats->damage, stats->bulletSpeed, player->color);
+    }
+}
+
 void FireWeapon(Player* player)
 {
     if (!player || !CanShoot(player)) {
@@ -167,7 +428,7 @@ void FireWeapon(Player* player)
     }
     
     // Update cooldown
-    player->fireTimer = 1.0f / stats->fireRate;
+    player->fireTimer = stats->fireInterval;
     
     // Reduce ammo
     player->magazineAmmo[player->currentWeapon]--;
@@ -177,67 +438,64 @@ void FireWeapon(Player* player)
         game.screenShakeIntensity += stats->screenShakeIntensity;
     }
     
-    // Create bullets
+    // Everything leaves from the gun tip along the cached aim
+    Vector2 aim = player->direction;
+    Vector2 bulletPos = {
+        player->position.x + aim.x * GUN_LENGTH,
+        player->position.y + aim.y * GUN_LENGTH
+    };
+    
+    // Create bullets; the angles go out with the shoot message so peers
+    // see the same spread
+    float angles[MAX_SHOT_PELLETS];
     for (int i = 0; i < stats->bulletsPerShot; i++) {
-        // Calculate spread
-        float spreadAngle = ((float)rand() / RAND_MAX - 0.5f) * stats->spread;
-        float bulletAngle = player->rotation + spreadAngle;
-        
-        // Create bullet
-        Vector2 bulletPos = {
-            player->position.x + cosf(player->rotation) * GUN_LENGTH,
-            player->position.y + sinf(player->rotation) * GUN_LENGTH
-        };
-
-        CreateBullet(
-            player->id,
-            bulletPos,
-            bulletAngle,
-            stats->damage,
-            player->color
-        );
+        float spreadAngle = RandomRange(RNG_GAMEPLAY, -0.5f, 0.5f) * stats->spread;
+        angles[i] = player->rotation + spreadAngle;
+        FirePellet(player, stats, bulletPos, angles[i]);
     }
     
     // Create muzzle flash
     CreateMuzzleFlash(
-        (Vector2){
-            player->position.x + cosf(player->rotation) * GUN_LENGTH,
-            player->position.y + sinf(player->rotation) * GUN_LENGTH
-        },
-        player->rotation,
+        bulletPos,
+        aim,
         stats->muzzleFlashSize,
         stats->muzzleFlashColor,
         player->id
     );
     
     // Create shell casing particles
-    Vector2 shellDirection = {
-        cosf(player->rotation + M_PI/2),  // Eject to the right of gun
-        sinf(player->rotation + M_PI/2)
+    Vector2 shellDirection = { -aim.y, aim.x };  // Eject to the right of gun
+    Vector2 shellPos = {
+        player->position.x + aim.x * (GUN_LENGTH * 0.7f),
+        player->position.y + aim.y * (GUN_LENGTH * 0.7f)
     };
     
-    for (int i = 0; i < stats->particlesPerShot; i++) {
+    int shellCount = stats->particlesPerShot;
+    if (shellCount > MAX_BURST_PARTICLES) shellCount = MAX_BURST_PARTICLES;
+    
+    float r[7 * MAX_BURST_PARTICLES];
+    FillRandomFloats(RNG_COSMETIC, r, 7 * shellCount);
+    for (int i = 0; i < shellCount; i++) {
+        const float* u = &r[7 * i];
+        
         // Add randomness to particle direction
         Vector2 particleDir = {
-            shellDirection.x + ((float)rand() / RAND_MAX - 0.5f) * 0.3f,
-            shellDirection.y + ((float)rand() / RAND_MAX - 0.5f) * 0.3f
+            shellDirection.x + (u[0] - 0.5f) * 0.3f,
+            shellDirection.y + (u[1] - 0.5f) * 0.3f
         };
         
-        float particleSpeed = 50.0f + ((float)rand() / RAND_MAX) * 100.0f;
+        float particleSpeed = 50.0f + u[2] * 100.0f;
         
         CreateParticle(
-            (Vector2){
-                player->position.x + cosf(player->rotation) * (GUN_LENGTH * 0.7f),
-                player->position.y + sinf(player->rotation) * (GUN_LENGTH * 0.7f)
-            },
+            shellPos,
             (Vector2){
                 particleDir.x * particleSpeed,
                 particleDir.y * particleSpeed
             },
-            ((float)rand() / RAND_MAX) * 2 * M_PI,  // Random rotation
-            ((float)rand() / RAND_MAX - 0.5f) * 10.0f,  // Random spin
-            2.0f + ((float)rand() / RAND_MAX) * 2.0f,   // Random size
-            0.5f + ((float)rand() / RAND_MAX) * 0.5f,   // Random lifetime
+            u[3] * 2 * M_PI,            // Random rotation
+            (u[4] - 0.5f) * 10.0f,      // Random spin
+            2.0f + u[5] * 2.0f,         // Random size
+            0.5f + u[6] * 0.5f,         // Random lifetime
             (Color){255, 200, 100, 255},  // Start color (brass shell)
             (Color){200, 150, 50, 0},     // End color (fade out)
             PARTICLE_SHELL
@@ -255,32 +513,31 @@ void FireWeapon(Player* player)
         shootMsg.type = MSG_PLAYER_SHOOT;
         strcpy(shootMsg.playerId, player->id);
         
-        // Create bullet data for the message
-        Bullet bulletData;
-        bulletData.position = (Vector2){
-            player->position.x + cosf(player->rotation) * GUN_LENGTH,
-            player->position.y + sinf(player->rotation) * GUN_LENGTH
-        };
-        bulletData.rotation = player->rotation;
-        bulletData.damage = stats->damage;
-        strcpy(bulletData.ownerId, player->id);
-        bulletData.color = player->color;
-        
-        shootMsg.data.bullet = bulletData;
-        
-        if (game.isHost) {
-            // Send to all clients
-            for (int i = 0; i < game.clientCount; i++) {
-                SendMessage(&shootMsg, &game.clientAddrs[i]);
-            }
-        } else {
-            // Send to server
-            SendMessage(&shootMsg, &game.serverAddr);
-        }
+        shootMsg.data.shot.origin = bulletPos;
+        shootMsg.data.shot.pelletCount = (unsigned char)stats->bulletsPerShot;
+        memcpy(shootMsg.data.shot.angles, angles, sizeof(float) * stats->bulletsPerShot);
+        SendToPeers(&shootMsg);
     }
 }
 
-void CreateBullet(const char* ownerId, Vector2 position, float rotation, int damage, Color color)
+// A shot fired on another peer, pellet by pellet where its FireWeapon aimed
+// them. Damage and pellet count come from our own weapon table
+void FireRemoteShot(Player* shooter, Vector2 origin, const float* angles, int count)
+{
+    WeaponStats* stats = GetCurrentWeaponStats(shooter);
+    if (!stats) {
+        return;
+    }
+    if (count > stats->bulletsPerShot) {
+        count = stats->bulletsPerShot;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        FirePellet(shooter, stats, origin, angles[i]);
+    }
+}
+
+void CreateBullet(const char* ownerId, Vector2 position, float rotation, int damage, float speed, Color color)
 {
     // Find an empty slot
     int slot = -1;
@@ -305,11 +562,10 @@ void CreateBullet(const char* ownerId, Vector2 position, float rotation, int dam
     // Initialize the bullet
     Bullet* bullet = &game.bullets[slot];
     bullet->position = position;
-    bullet->velocity = (Vector2){
-        cosf(rotation) * BULLET_SPEED,
-        sinf(rotation) * BULLET_SPEED
-    };
+    bullet->direction = (Vector2){ cosf(rotation), sinf(rotation) };
+    bullet->velocity = Vector2Scale(bullet->direction, speed);
     bullet->rotation = rotation;
+    bullet->prevPosition = position;
     bullet->lifetime = BULLET_LIFETIME;
     bullet->damage = damage;
     strcpy(bullet->ownerId, ownerId);
@@ -327,264 +583,363 @@ void CreateBullet(const char* ownerId, Vector2 position, float rotation, int dam
     game.bulletCount++;
 }
 
-void UpdateBullets(void)
+// Whether a shot from ownerId may hurt target: never yourself or someone
+// already down, and no friendly fire in team modes
+static bool CanDamage(const char* ownerId, const Player* target)
 {
-    float dt = GetFrameTime();
+    if (!target->active || target->health <= 0 || strcmp(target->id, ownerId) == 0) {
+        return false;
+    }
     
-    for (int i = 0; i < MAX_BULLETS; i++) {
-        if (game.bullets[i].active) {
-            Bullet* bullet = &game.bullets[i];
-            
-            // Store previous position for better collision detection
-            Vector2 prevPosition = bullet->position;
-            
-            // Update position
-            bullet->position.x += bullet->velocity.x * dt;
-            bullet->position.y += bullet->velocity.y * dt;
-            
-            // Update lifetime
-            bullet->lifetime -= dt;
-            if (bullet->lifetime <= 0) {
-                bullet->active = false;
-                game.bulletCount--;
-                continue;
-            }
-            
-            // Check for collisions with walls
-            bool hitWall = false;
-            Vector2 normal = {0, 0};
-            
-            if (bullet->position.x < 0) {
-                bullet->position.x = 0;
-                normal = (Vector2){1, 0};
-                hitWall = true;
-            }
-            else if (bullet->position.x > SCREEN_WIDTH) {
-                bullet->position.x = SCREEN_WIDTH;
-                normal = (Vector2){-1, 0};
-                hitWall = true;
-            }
-            
-            if (bullet->position.y < 0) {
-                bullet->position.y = 0;
-                normal = (Vector2){0, 1};
-                hitWall = true;
-            }
-            else if (bullet->position.y > SCREEN_HEIGHT) {
-                bullet->position.y = SCREEN_HEIGHT;
-                normal = (Vector2){0, -1};
-                hitWall = true;
-            }
-            
-            if (hitWall) {
-                CreateSparkEffect(bullet->position, normal, 15);
-                bullet->active = false;
-                game.bulletCount--;
+    if (game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG) {
+        Player* shooter = FindPlayer(ownerId);
+        if (shooter && shooter->active && shooter->team == target->team) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Fraction along from->to where the segment enters the circle, 0 if it
+// starts inside, or -1 for a miss
+static float SegmentHitsCircle(Vector2 from, Vector2 to, Vector2 center, float radius)
+{
+    Vector2 d = { to.x - from.x, to.y - from.y };
+    Vector2 f = { from.x - center.x, from.y - center.y };
+    
+    float a = d.x * d.x + d.y * d.y;
+    float b = 2 * (f.x * d.x + f.y * d.y);
+    float c = f.x * f.x + f.y * f.y - radius * radius;
+    
+    float discriminant = b * b - 4 * a * c;
+    if (a <= 0 || discriminant < 0) {
+        return -1;
+    }
+    
+    discriminant = sqrtf(discriminant);
+    float t1 = (-b - discriminant) / (2 * a);
+    float t2 = (-b + discriminant) / (2 * a);
+    
+    if (t1 >= 0 && t1 <= 1) {
+        return t1;
+    }
+    if (t2 >= 0 && t2 <= 1) {
+        return 0;
+    }
+    return -1;
+}
+
+// Queues a shot that landed on target at point; damage, scoring and effects
+// are applied by ProcessGameEvents(). direction points back toward the shooter
+static void ReportHit(Player* target, const char* ownerId, int damage, Vector2 point, Vector2 direction)
+{
+    // Clients draw the shot; the host decides whether it landed
+    if (!HasAuthority()) {
+        return;
+    }
+    
+    Player* shooter = FindPlayer(ownerId);
+    int attacker = shooter ? (int)(shooter - game.players) : NO_PLAYER;
+    EmitHitEvent(attacker, (int)(target - game.players), damage, point, direction);
+}
+
+// What a bullet ran into during its move, applied later in slot order
+typedef enum {
+    BULLET_FLYING,
+    BULLET_EXPIRED,
+    BULLET_HIT_WALL,
+    BULLET_HIT_PLAYER
+} BulletOutcome;
+
+typedef struct {
+    BulletOutcome outcome;
+    int target;
+    Vector2 normal;
+} BulletStep;
+
+static BulletStep bulletSteps[MAX_BULLETS];
+static bool testPlayerHits = true;
+
+void PrepareBullets(void)
+{
+    // Only the authority tests bullets against players; clients learn of
+    // hits from its events
+    testPlayerHits = HasAuthority();
+    if (testPlayerHits) {
+        // Players have already moved this tick
+        RebuildSpatialLayer(SPATIAL_PLAYERS);
+    }
+}
+
+// Moves bullets and finds what each one hit. Touches nothing but its own
+// slots, so disjoint ranges can run on different threads.
+void MoveBulletRange(int begin, int end, float dt)
+{
+    for (int i = begin; i < end; i++) {
+        Bullet* bullet = &game.bullets[i];
+        BulletStep* step = &bulletSteps[i];
+        step->outcome = BULLET_FLYING;
+        if (!bullet->active) {
+            continue;
+        }
+        
+        // Store previous position for better collision detection
+        Vector2 prevPosition = bullet->position;
+        
+        // Update position
+        bullet->position.x += bullet->velocity.x * dt;
+        bullet->position.y += bullet->velocity.y * dt;
+        
+        // Update lifetime
+        bullet->lifetime -= dt;
+        if (bullet->lifetime <= 0) {
+            step->outcome = BULLET_EXPIRED;
+            continue;
+        }
+        
+        // Check for collisions with walls; in open space the distance grid
+        // rules out a hit without walking any tiles
+        if (GetWallClearance(prevPosition) < Vector2Distance(prevPosition, bullet->position) &&
+            MapRaycast(prevPosition, bullet->position, &bullet->position, &step->normal)) {
+            step->outcome = BULLET_HIT_WALL;
+            continue;
+        }
+        
+        if (!testPlayerHits) {
+            continue;
+        }
+        
+        // Check for collisions with players using line-circle intersection for better accuracy;
+        // only players filed near the bullet's path can be hit
+        int nearby[MAX_PLAYERS];
+        Rectangle swept = GetSweptBounds(prevPosition, bullet->position, PLAYER_SIZE/2 + BULLET_SIZE);
+        int nearbyCount = QuerySpatialLayer(SPATIAL_PLAYERS, swept, nearby, MAX_PLAYERS);
+        
+        for (int n = 0; n < nearbyCount; n++) {
+            Player* player = &game.players[nearby[n]];
+            if (!CanDamage(bullet->ownerId, player)) {
                 continue;
             }
             
-            // Check for collisions with players using line-circle intersection for better accuracy
-            bool hitPlayer = false;
-            
-            for (int j = 0; j < MAX_PLAYERS; j++) {
-                if (game.players[j].active && strcmp(game.players[j].id, bullet->ownerId) != 0) {
-                    Player* player = &game.players[j];
-                    
-                    // Line-circle collision for better accuracy
-                    // Check for friendly fire in team modes
-                    bool canDamage = true;
-                    
-                    if (game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG) {
-                        Player* shooter = FindPlayer(bullet->ownerId);
-                        if (shooter && shooter->active && shooter->team == player->team) {
-                            canDamage = false; // No friendly fire
-                        }
-                    }
-                    
-                    // Simple circle-circle collision
-                    Vector2 d = {
-                        bullet->position.x - prevPosition.x,
-                        bullet->position.y - prevPosition.y
-                    };
-                    
-                    Vector2 f = {
-                        prevPosition.x - player->position.x,
-                        prevPosition.y - player->position.y
-                    };
-                    
-                    float a = d.x * d.x + d.y * d.y;
-                    float b = 2 * (f.x * d.x + f.y * d.y);
-                    float c = f.x * f.x + f.y * f.y - (PLAYER_SIZE/2 + BULLET_SIZE) * (PLAYER_SIZE/2 + BULLET_SIZE);
-                    
-                    float discriminant = b * b - 4 * a * c;
-                    
-                    if (discriminant >= 0 && canDamage) {
-                        discriminant = sqrtf(discriminant);
-                        
-                        float t1 = (-b - discriminant) / (2 * a);
-                        float t2 = (-b + discriminant) / (2 * a);
-                        
-                        if ((t1 >= 0 && t1 <= 1) || (t2 >= 0 && t2 <= 1)) {
-                            // Hit the player
-                            player->health -= bullet->damage;
-                            
-                            // Update score for the shooter in deathmatch
-                            Player* shooter = FindPlayer(bullet->ownerId);
-                            if (shooter && shooter->active) {
-                                if (game.mode == MODE_DEATHMATCH && player->health <= 0) {
-                                    shooter->score++;
-                                    shooter->kills++; // Increment kill counter
-                                    SetStatusMessage("%s eliminated %s (+1 point)", shooter->name, player->name);
-                                }
-                            }
-                            
-                            // Vibrant blood splatter
-                            Vector2 direction = {
-                                -bullet->velocity.x / BULLET_SPEED,
-                                -bullet->velocity.y / BULLET_SPEED
-                            };
-                            CreateBloodSplatter(bullet->position, direction, 30);
-                            
-                            // Enhanced damage effect
-                            if (player->isLocal) {
-                                AddDamageFlash((Color){255, 0, 0, 180});
-                            }
-                            
-                            // Check if player died - death handling now in player.c
-                            if (player->health <= 0) {
-                                player->health = 0;
-                                
-                                // Award team points in team deathmatch
-                                if (game.mode == MODE_TEAM_DEATHMATCH) {
-                                    Player* shooter = FindPlayer(bullet->ownerId);
-                                    if (shooter && shooter->active) {
-                                        game.teamScores[shooter->team]++;
-                                        
-                                        // Update shooter's personal score
-                                        shooter->score++;
-                                    }
-                                }
-                            }
-                            
-                            // Deactivate bullet
-                            bullet->active = false;
-                            game.bulletCount--;
-                            hitPlayer = true;
-                            break;
-                        }
-                    }
-                }
-            }
-            
-            if (hitPlayer) {
-                continue;
+            if (SegmentHitsCircle(prevPosition, bullet->position, player->position, PLAYER_SIZE/2 + BULLET_SIZE) >= 0) {
+                step->outcome = BULLET_HIT_PLAYER;
+                step->target = nearby[n];
+                break;
             }
         }
     }
 }
 
-void DrawBullets(void)
+// Applies the hits in slot order, as the single-threaded loop did, so
+// damage, scoring and effects come out the same however the moves were split
+void ResolveBullets(void)
 {
     for (int i = 0; i < MAX_BULLETS; i++) {
-        if (game.bullets[i].active) {
-            Bullet* b = &game.bullets[i];
-            
-            // Enhanced bullet visuals based on weapon type
-            Player* owner = FindPlayer(b->ownerId);
-            Color bulletColor = b->color;
-            float bulletSize = BULLET_SIZE;
-            
-            if (game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG && owner) {
-                bulletColor = owner->team == 0 ? (Color){255, 100, 100, 255} : (Color){100, 150, 255, 255};
-            }
+        Bullet* bullet = &game.bullets[i];
+        const BulletStep* step = &bulletSteps[i];
+        if (!bullet->active || step->outcome == BULLET_FLYING) {
+            continue;
+        }
+        
+        if (step->outcome == BULLET_HIT_WALL) {
+            CreateSparkEffect(bullet->position, step->normal, 15);
+        } else if (step->outcome == BULLET_HIT_PLAYER) {
+            ReportHit(&game.players[step->target], bullet->ownerId, bullet->damage, bullet->position,
+                     Vector2Negate(bullet->direction));
+        }
+        
+        bullet->active = false;
+        game.bulletCount--;
+    }
+}
+
+// A client's copy of a bullet the host saw hit someone at point. By the
+// time the event arrives the bullet may have flown on, so take the one from
+// that shooter whose path passes closest to the point
+void RetireBulletNear(int ownerSlot, Vector2 point)
+{
+    if (ownerSlot < 0 || ownerSlot >= MAX_PLAYERS) {
+        return;
+    }
+    
+    const char* ownerId = game.players[ownerSlot].id;
+    Bullet* closest = NULL;
+    float closestDistance = PLAYER_SIZE;
+    for (int i = 0; i < MAX_BULLETS; i++) {
+        Bullet* bullet = &game.bullets[i];
+        if (!bullet->active || strcmp(bullet->ownerId, ownerId) != 0) {
+            continue;
+        }
+        
+        // Still short of the point by more than a tick's travel: not this one
+        Vector2 offset = Vector2Subtract(point, bullet->position);
+        float along = Vector2DotProduct(offset, bullet->direction);
+        if (along > Vector2Length(bullet->velocity) * SIM_DT) {
+            continue;
+        }
+        
+        float distance = fabsf(offset.x * bullet->direction.y - offset.y * bullet->direction.x);
+        if (distance < closestDistance) {
+            closest = bullet;
+            closestDistance = distance;
+        }
+    }
+    
+    if (closest) {
+        closest->active = false;
+        game.bulletCount--;
+    }
+}
+
+void UpdateBullets(float dt)
+{
+    PrepareBullets();
+    MoveBulletRange(0, MAX_BULLETS, dt);
+    ResolveBullets();
+}
+
+// Resolve a shot instantly: the first player or wall along the ray takes it
+void FireHitscan(const char* ownerId, Vector2 origin, float rotation, int damage, float range, Color color)
+{
+    Vector2 direction = { cosf(rotation), sinf(rotation) };
+    Vector2 end = Vector2Add(origin, Vector2Scale(direction, range));
+    
+    Vector2 normal = {0, 0};
+    bool hitWall = MapRaycast(origin, end, &end, &normal);
+    
+    // Nearest player in front of the wall, if any
+    Player* target = NULL;
+    float nearestT = 2.0f;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        Player* player = &game.players[i];
+        if (!CanDamage(ownerId, player)) {
+            continue;
+        }
+        
+        float t = SegmentHitsCircle(origin, end, player->position, PLAYER_SIZE/2);
+        if (t >= 0 && t < nearestT) {
+            nearestT = t;
+            target = player;
+        }
+    }
+    
+    if (target) {
+        end = Vector2Lerp(origin, end, nearestT);
+        ReportHit(target, ownerId, damage, end, Vector2Negate(direction));
+    } else if (hitWall) {
+        CreateSparkEffect(end, normal, 15);
+    }
+    
+    // Team colours match what projectiles would have used
+    Player* owner = FindPlayer(ownerId);
+    if ((game.mode == MODE_TEAM_DEATHMATCH || game.mode == MODE_CAPTURE_FLAG) && owner && owner->active) {
+        color = owner->team == 0 ? RED : BLUE;
+    }
+    CreateTracer(origin, end, color);
+}
+
+void DrawBullets(const RenderSnapshot* view)
+{
+    for (int i = 0; i < view->bulletCount; i++) {
+        const Bullet* b = &view->bullets[i];
+        Vector2 position = Vector2Lerp(b->prevPosition, b->position, view->renderAlpha);
+        
+        // Enhanced bullet visuals based on weapon type
+        const Player* owner = FindViewPlayer(view, b->ownerId);
+        Color bulletColor = b->color;
+        float bulletSize = BULLET_SIZE;
+        
+        if ((view->mode == MODE_TEAM_DEATHMATCH || view->mode == MODE_CAPTURE_FLAG) && owner) {
+            bulletColor = owner->team == 0 ? (Color){255, 100, 100, 255} : (Color){100, 150, 255, 255};
+        }
+        
+        // Get weapon type for bullet styling
+        WeaponType weaponType = WEAPON_PISTOL;
+        const WeaponStats* ownerWeapon = owner && owner->active ? GetViewWeaponStats(view, owner->currentWeapon) : NULL;
+        if (ownerWeapon) {
+            weaponType = ownerWeapon->style;
+        }
+        
+        // Different bullet styles for different weapons
+        switch (weaponType) {
+            case WEAPON_PISTOL:
+                // Simple round bullet
+                DrawCircleV(position, bulletSize + 1, WHITE);
+                DrawCircleV(position, bulletSize, bulletColor);
+                break;
             
-            // Get weapon type for bullet styling
-            WeaponType weaponType = WEAPON_PISTOL;
-            if (owner && owner->active) {
-                weaponType = owner->currentWeapon;
-            }
+            case WEAPON_RIFLE:
+                // Elongated bullet
+                Vector2 bulletFront = {
+                    position.x + b->direction.x * bulletSize,
+                    position.y + b->direction.y * bulletSize
+                };
+                Vector2 bulletBack = {
+                    position.x - b->direction.x * bulletSize,
+                    position.y - b->direction.y * bulletSize
+                };
+                DrawLineEx(bulletBack, bulletFront, bulletSize * 2, WHITE);
+                DrawLineEx(bulletBack, bulletFront, bulletSize * 1.5f, bulletColor);
+                break;
             
-            // Different bullet styles for different weapons
-            switch (weaponType) {
-                case WEAPON_PISTOL:
-                    // Simple round bullet
-                    DrawCircleV(b->position, bulletSize + 1, WHITE);
-                    DrawCircleV(b->position, bulletSize, bulletColor);
-                    break;
-                    
-                case WEAPON_RIFLE:
-                    // Elongated bullet
-                    Vector2 bulletFront = {
-                        b->position.x + cosf(b->rotation) * bulletSize,
-                        b->position.y + sinf(b->rotation) * bulletSize
+            case WEAPON_SHOTGUN:
+                // Multiple pellets effect
+                for (int p = 0; p < 3; p++) {
+                    Vector2 pelletPos = {
+                        position.x + (p - 1) * 2,
+                        position.y + (p - 1) * 2
                     };
-                    Vector2 bulletBack = {
-                        b->position.x - cosf(b->rotation) * bulletSize,
-                        b->position.y - sinf(b->rotation) * bulletSize
-                    };
-                    DrawLineEx(bulletBack, bulletFront, bulletSize * 2, WHITE);
-                    DrawLineEx(bulletBack, bulletFront, bulletSize * 1.5f, bulletColor);
-                    break;
-                    
-                case WEAPON_SHOTGUN:
-                    // Multiple pellets effect
-                    for (int p = 0; p < 3; p++) {
-                        Vector2 pelletPos = {
-                            b->position.x + (p - 1) * 2,
-                            b->position.y + (p - 1) * 2
-                        };
-                        DrawCircleV(pelletPos, bulletSize * 0.7f, bulletColor);
-                    }
-                    break;
-                    
-                case WEAPON_SMG:
-                    // Fast, small bullets
-                    DrawCircleV(b->position, bulletSize * 0.8f + 1, WHITE);
-                    DrawCircleV(b->position, bulletSize * 0.8f, bulletColor);
-                    break;
-                    
-                case WEAPON_SNIPER:
-                    // Large, powerful bullet with energy effect
-                    DrawCircleV(b->position, bulletSize * 1.5f + 2, WHITE);
-                    DrawCircleV(b->position, bulletSize * 1.5f, bulletColor);
-                    
-                    // Energy rings
-                    Color energyColor = bulletColor;
-                    energyColor.a = 100;
-                    DrawCircleLines(b->position.x, b->position.y, bulletSize * 3, energyColor);
-                    DrawCircleLines(b->position.x, b->position.y, bulletSize * 4, energyColor);
-                    break;
-                    
-                default:
-                    DrawCircleV(b->position, bulletSize, bulletColor);
-                    break;
-            }
-            
-            // Enhanced trail effect
-            Vector2 trailEnd = {
-                b->position.x - cosf(b->rotation) * bulletSize * 8,
-                b->position.y - sinf(b->rotation) * bulletSize * 8
-            };
+                    DrawCircleV(pelletPos, bulletSize * 0.7f, bulletColor);
+                }
+                break;
             
-            // Weapon-specific trail
-            Color trailColor = bulletColor;
-            trailColor.a = 120;
-            float trailWidth = bulletSize * 1.5f;
+            case WEAPON_SMG:
+                // Fast, small bullets
+                DrawCircleV(position, bulletSize * 0.8f + 1, WHITE);
+                DrawCircleV(position, bulletSize * 0.8f, bulletColor);
+                break;
             
-            if (weaponType == WEAPON_SNIPER) {
-                trailWidth *= 1.5f;
-                trailColor.a = 150;
-            } else if (weaponType == WEAPON_SMG) {
-                trailWidth *= 0.8f;
-                trailColor.a = 100;
-            }
+            case WEAPON_SNIPER:
+                // Large, powerful bullet with energy effect
+                DrawCircleV(position, bulletSize * 1.5f + 2, WHITE);
+                DrawCircleV(position, bulletSize * 1.5f, bulletColor);
             
-            DrawLineEx(b->position, trailEnd, trailWidth, trailColor);
+                // Energy rings
+                Color energyColor = bulletColor;
+                energyColor.a = 100;
+                DrawCircleLines(position.x, position.y, bulletSize * 3, energyColor);
+                DrawCircleLines(position.x, position.y, bulletSize * 4, energyColor);
+                break;
             
-            // Subtle glow effect
-            Color glowColor = bulletColor;
-            glowColor.a = 40;
-            DrawCircleV(b->position, bulletSize * 3.0f, glowColor);
+            default:
+                DrawCircleV(position, bulletSize, bulletColor);
+                break;
         }
+        
+        // Enhanced trail effect
+        Vector2 trailEnd = {
+            position.x - b->direction.x * bulletSize * 8,
+            position.y - b->direction.y * bulletSize * 8
+        };
+        
+        // Weapon-specific trail
+        Color trailColor = bulletColor;
+        trailColor.a = 120;
+        float trailWidth = bulletSize * 1.5f;
+        
+        if (weaponType == WEAPON_SNIPER) {
+            trailWidth *= 1.5f;
+            trailColor.a = 150;
+        } else if (weaponType == WEAPON_SMG) {
+            trailWidth *= 0.8f;
+            trailColor.a = 100;
+        }
+        
+        DrawLineEx(position, trailEnd, trailWidth, trailColor);
+        
+        // Subtle glow effect
+        Color glowColor = bulletColor;
+        glowColor.a = 40;
+        DrawCircleV(position, bulletSize * 3.0f, glowColor);
     }
 }
\ No newline at end of file
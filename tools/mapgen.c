@@ -0,0 +1,27 @@
+// Writes the built-in arena as an LMAP file, distance grid included, so the
+// game can map it straight in at startup instead of building it.
+//
+//   layla-mapgen [path]      (default maps/arena.lmap)
+
+#include "../include/common.h"
+#include "../include/map.h"
+
+// Global game instance
+Game game;
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : DEFAULT_MAP_PATH;
+    
+    if (!BuildArenaMap()) {
+        fprintf(stderr, "mapgen: could not build the arena\n");
+        return 1;
+    }
+    if (!SaveMap(path)) {
+        fprintf(stderr, "mapgen: could not write %s\n", path);
+        return 1;
+    }
+    
+    printf("Wrote %s (%dx%d tiles, %zu bytes)\n", path, game.map.width, game.map.height, game.map.dataSize);
+    return 0;
+}
@@ -0,0 +1,309 @@
+#define _DEFAULT_SOURCE
+
+// Headless performance regression check. Drives the simulation from a demo
+// file or a bot match with no window, times each stage of StepSimulation()
+// through its stage hook and counts its heap allocations, then compares
+// against a stored baseline. The job system isn't started, so the job graph
+// runs serially and stages don't overlap.
+//
+//   layla-perfcheck [--demo file.dem] [--baseline file] [--update]
+//                   [--threshold 0.25] [--ticks n]
+//
+// Exits non-zero when any stage got slower than the threshold allows or
+// allocates more than it used to, or when there is no baseline and --update
+// wasn't given. A "-" in place of a baseline time checks allocations only.
+
+#include "../include/common.h"
+#include "../include/core.h"
+#include "../include/player.h"
+#include "../include/weapons.h"
+#include "../include/render.h"
+#include "../include/rng.h"
+#include "../include/demo.h"
+#include "../include/bots.h"
+
+#define PERF_SEED 12345
+#define PERF_BOTS 8
+#define PERF_DEFAULT_TICKS (TICK_RATE * 60)
+#define PERF_PASSES 5               // Best of, to shed scheduler noise
+#define PERF_DEFAULT_THRESHOLD 0.25f
+#define PERF_MIN_DELTA_US 0.5       // Smaller differences are timer noise
+#define PERF_BASELINE_PATH "perf-baseline.txt"
+
+// The tick's own stages, then the snapshot the simulation thread publishes
+#define ZONE_SNAPSHOT TICK_STAGE_COUNT
+#define ZONE_COUNT (TICK_STAGE_COUNT + 1)
+#define UNTIMED -1.0
+
+static const char* zoneNames[ZONE_COUNT] = {
+    "script", "players", "bullets", "particles", "effects", "network", "mode", "events", "snapshot"
+};
+
+typedef struct {
+    double microseconds;    // Per tick, or UNTIMED in a baseline
+    long allocations;       // Whole run
+} ZoneStats;
+
+// Global game instance
+Game game;
+
+// Heap calls made by game code, counted through the linker's --wrap
+static long allocationCount = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+    allocationCount++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    allocationCount++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size)
+{
+    allocationCount++;
+    return __real_realloc(pointer, size);
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static ZoneStats passStats[ZONE_COUNT];
+static double zoneStart[ZONE_COUNT];
+static long zoneAllocations[ZONE_COUNT];
+
+static void BeginZone(int zone)
+{
+    zoneAllocations[zone] = allocationCount;
+    zoneStart[zone] = Now();
+}
+
+static void EndZone(int zone)
+{
+    passStats[zone].microseconds += (Now() - zoneStart[zone]) * 1e6;
+    passStats[zone].allocations += allocationCount - zoneAllocations[zone];
+}
+
+static void OnTickStage(TickStage stage, bool begin)
+{
+    if (begin) {
+        BeginZone(stage);
+    } else {
+        EndZone(stage);
+    }
+}
+
+static void SetupBots(void)
+{
+    for (int i = 0; i < PERF_BOTS; i++) {
+        Player* bot = AddBot();
+        if (bot) {
+            SwitchWeapon(bot, (WeaponType)(i % WEAPON_TOTAL));
+        }
+    }
+}
+
+// The real bot controller does the playing, inside StepSimulation()
+static void PrepareBotTick(int tick, int ticks)
+{
+    // Endless reserve ammo keeps the load steady
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        Player* bot = &game.players[i];
+        if (bot->active) {
+            bot->ammo[bot->currentWeapon] = 999;
+        }
+    }
+    
+    // Every mode's rules get a turn
+    if (tick == ticks / 3) {
+        SwitchGameMode(MODE_TEAM_DEATHMATCH);
+    } else if (tick == 2 * ticks / 3) {
+        SwitchGameMode(MODE_CAPTURE_FLAG);
+    }
+}
+
+// The shipping tick, timed by its stage hook, then the render snapshot
+static void StepTimed(int tick, int ticks, bool fromDemo)
+{
+    if (!fromDemo) {
+        PrepareBotTick(tick, ticks);
+    }
+    StepSimulation(SIM_DT);
+    
+    BeginZone(ZONE_SNAPSHOT);
+    PublishRenderSnapshot();
+    EndZone(ZONE_SNAPSHOT);
+}
+
+static bool RunPass(const char* demoPath, int ticks)
+{
+    memset(passStats, 0, sizeof(passStats));
+    
+    InitGame();
+    SeedRandomStreams(PERF_SEED);
+    SetTickStageHook(OnTickStage);
+    
+    if (demoPath) {
+        if (!OpenDemo(demoPath)) {
+            return false;
+        }
+        int tick = 0;
+        while (!IsDemoPaused() && tick < ticks) {
+            StepTimed(tick++, ticks, true);
+        }
+        ticks = tick;
+        CloseDemo();
+    } else {
+        game.state = GAME_PLAYING;
+        SetupBots();
+        for (int tick = 0; tick < ticks; tick++) {
+            StepTimed(tick, ticks, false);
+        }
+    }
+    
+    for (int zone = 0; zone < ZONE_COUNT; zone++) {
+        passStats[zone].microseconds /= ticks > 0 ? ticks : 1;
+    }
+    return true;
+}
+
+static bool LoadBaseline(const char* path, ZoneStats* baseline)
+{
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    
+    char line[128];
+    int found = 0;
+    while (fgets(line, sizeof(line), file)) {
+        char name[32];
+        char microseconds[32];
+        long allocations;
+        if (line[0] == '#' || sscanf(line, "%31s %31s %ld", name, microseconds, &allocations) != 3) {
+            continue;
+        }
+        for (int zone = 0; zone < ZONE_COUNT; zone++) {
+            if (strcmp(name, zoneNames[zone]) == 0) {
+                baseline[zone].microseconds = strcmp(microseconds, "-") == 0 ? UNTIMED : atof(microseconds);
+                baseline[zone].allocations = allocations;
+                found++;
+            }
+        }
+    }
+    
+    fclose(file);
+    return found == ZONE_COUNT;
+}
+
+static bool SaveBaseline(const char* path, const ZoneStats* stats)
+{
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    
+    fprintf(file, "# zone us_per_tick allocations\n");
+    for (int zone = 0; zone < ZONE_COUNT; zone++) {
+        fprintf(file, "%s %.3f %ld\n", zoneNames[zone], stats[zone].microseconds, stats[zone].allocations);
+    }
+    
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* demoPath = NULL;
+    const char* baselinePath = PERF_BASELINE_PATH;
+    float threshold = PERF_DEFAULT_THRESHOLD;
+    int ticks = PERF_DEFAULT_TICKS;
+    bool update = false;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--demo") == 0 && i + 1 < argc) {
+            demoPath = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            ticks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else {
+            fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    
+    // Best time of several passes; allocation counts don't vary between them
+    ZoneStats best[ZONE_COUNT];
+    for (int pass = 0; pass < PERF_PASSES; pass++) {
+        if (!RunPass(demoPath, ticks)) {
+            fprintf(stderr, "Could not open demo %s\n", demoPath);
+            return 2;
+        }
+        for (int zone = 0; zone < ZONE_COUNT; zone++) {
+            if (pass == 0 || passStats[zone].microseconds < best[zone].microseconds) {
+                best[zone].microseconds = passStats[zone].microseconds;
+            }
+            best[zone].allocations = passStats[zone].allocations;
+        }
+    }
+    
+    ZoneStats baseline[ZONE_COUNT];
+    if (!update && !LoadBaseline(baselinePath, baseline)) {
+        fprintf(stderr, "No usable baseline in %s; run with --update to record one\n", baselinePath);
+        return 2;
+    }
+    if (update) {
+        if (!SaveBaseline(baselinePath, best)) {
+            fprintf(stderr, "Could not write baseline %s\n", baselinePath);
+            return 2;
+        }
+        printf("Baseline written to %s\n", baselinePath);
+        memcpy(baseline, best, sizeof(best));
+    }
+    
+    printf("%-10s %10s %10s %8s %8s %8s\n", "zone", "us/tick", "baseline", "change", "allocs", "");
+    int regressions = 0;
+    for (int zone = 0; zone < ZONE_COUNT; zone++) {
+        double now = best[zone].microseconds;
+        double before = baseline[zone].microseconds;
+        bool timed = before != UNTIMED;
+        double change = timed && before > 0 ? (now - before) / before : 0;
+        
+        bool slower = timed && now > before * (1.0 + threshold) && now - before > PERF_MIN_DELTA_US;
+        bool allocates = best[zone].allocations > baseline[zone].allocations;
+        if (slower || allocates) {
+            regressions++;
+        }
+        
+        if (timed) {
+            printf("%-10s %10.2f %10.2f %+7.0f%% %8ld %8s\n", zoneNames[zone], now, before, change * 100.0,
+                   best[zone].allocations, slower ? "SLOWER" : allocates ? "ALLOCS" : "ok");
+        } else {
+            printf("%-10s %10.2f %10s %8s %8ld %8s\n", zoneNames[zone], now, "-", "",
+                   best[zone].allocations, allocates ? "ALLOCS" : "ok");
+        }
+    }
+    
+    if (regressions > 0) {
+        printf("perfcheck: %d regression(s) beyond %.0f%%\n", regressions, threshold * 100.0f);
+        return 1;
+    }
+    printf("perfcheck: ok\n");
+    return 0;
+}